@@ -0,0 +1,296 @@
+// ClipLogic.h
+// The per-tick clip decision of the poll loop, separated from the Win32 calls it depends on
+//  - Tick(state, world): asks `world` the questions the loop needs answered (is a window being dragged,
+//    what is in front, is it the target, is it visible, where is it) and returns what to do about it.
+//    Nothing here touches the system; the caller carries out the Decision (ClipCursor, logging, event log).
+//  - ObservingWorld: wraps a live world and remembers every answer of a tick, for the trace recorder
+//  - ReplayWorld:    answers from a recorded tick instead, for the trace replay (Trace.h)
+
+#pragma once
+#include <windows.h>
+#include <cstdint>
+#include <cstdlib>
+#include "EventLog.h"
+#include "FlightRecorder.h"
+
+namespace ClipLogic
+{
+
+	// Carried between ticks
+	struct State
+	{
+		HWND lastActive = nullptr;
+		bool lastClipped = false;
+		bool needsClipUpdate = false; // Next usable rect is applied even if the cursor already has it
+		bool moving = false;          // A window drag was in progress last tick
+		RECT appliedClip{};           // What we last passed to ClipCursor, while lastClipped
+		RECT effectiveClip{};         // What GetClipCursor reported after that (see ClipReadBack); verification compares to it
+	};
+
+	enum class ClipOp : uint8_t
+	{
+		None,
+		Release, // ClipCursor(nullptr)
+		Apply,   // ClipCursor(&clip)
+	};
+
+	struct Decision
+	{
+		FlightRecorder::Action action = FlightRecorder::Action::None;
+		ClipOp op = ClipOp::None;
+		bool released = false;        // A clip we had was dropped; `reason` says why
+		EventLog::ReleaseReason reason = EventLog::ReleaseReason::NotActive;
+		bool changed = false;         // Apply of a new rect (or forced), as opposed to re-asserting the same one
+		bool externalReset = false;   // The clip was verified and found reset by someone else; Apply re-asserts it
+		bool verified = false;        // The clip was checked this tick (and found intact unless externalReset)
+		bool moveStarted = false;
+		bool moveEnded = false;
+		bool focusChanged = false;
+		bool targetActivated = false;
+		HWND foreground = nullptr;
+		bool isTarget = false;
+		bool evaluated = false;       // Got past the moving/disabled checks, so the verdict below is meaningful
+		bool eligible = false;        // Verdict for the keyboard hook: recentering to `clip` is allowed
+		RECT clip{};                  // Usable clip rect, when eligible
+	};
+
+	// Rects within this many pixels per edge count as unchanged
+	constexpr LONG CLIP_TOLERANCE = 2;
+
+	inline bool RectChanged(const RECT& a, const RECT& b)
+	{
+		return abs(a.left - b.left) > CLIP_TOLERANCE || abs(a.top - b.top) > CLIP_TOLERANCE ||
+			abs(a.right - b.right) > CLIP_TOLERANCE || abs(a.bottom - b.bottom) > CLIP_TOLERANCE;
+	}
+
+	inline void Release(State& state, Decision& d, EventLog::ReleaseReason reason)
+	{
+		d.op = ClipOp::Release;
+		if (state.lastClipped)
+		{
+			d.released = true;
+			d.reason = reason;
+			state.lastClipped = false;
+		}
+	}
+
+	// World is anything with these members (see ObservingWorld for the full list):
+	//   IsMoving(), Enabled(), Foreground(), IsTarget(hwnd), IsVisible(hwnd), ClipRect(hwnd, rect), VerifyDue(), CurrentClip(rect)
+	// Questions are asked lazily and always in the same order, so a replay asks exactly what was recorded.
+	template <class World>
+	Decision Tick(State& state, World& world)
+	{
+		Decision d;
+
+		// If a window is being moved/resized, don't clip
+		bool moving = world.IsMoving();
+		if (moving != state.moving)
+		{
+			state.moving = moving;
+			if (moving)
+			{
+				d.moveStarted = true;
+				Release(state, d, EventLog::ReleaseReason::MoveResize);
+			}
+			else
+			{
+				d.moveEnded = true;
+				state.needsClipUpdate = true; // Force update clip rect after window change
+			}
+		}
+		if (moving)
+		{
+			if (state.lastClipped)
+				Release(state, d, EventLog::ReleaseReason::MoveResize);
+			d.action = FlightRecorder::Action::SkippedMoving;
+			return d;
+		}
+
+		HWND fg = world.Foreground();
+		d.foreground = fg;
+
+		// If clipping is disabled, always release
+		if (!world.Enabled())
+		{
+			if (state.lastClipped)
+				Release(state, d, EventLog::ReleaseReason::Disabled);
+			d.action = FlightRecorder::Action::SkippedDisabled;
+			return d;
+		}
+
+		d.evaluated = true;
+		d.isTarget = fg && world.IsTarget(fg);
+		if (fg != state.lastActive)
+		{
+			// Foreground changed - FORCE clip rect refresh
+			if (d.isTarget)
+			{
+				d.targetActivated = true;
+				state.needsClipUpdate = true;
+			}
+			else if (state.lastClipped)
+			{
+				Release(state, d, EventLog::ReleaseReason::NotActive);
+				d.action = FlightRecorder::Action::Released;
+			}
+			state.lastActive = fg;
+			d.focusChanged = true;
+		}
+
+		// Target in front AND actually visible
+		if (!d.isTarget || !world.IsVisible(fg))
+		{
+			if (state.lastClipped)
+			{
+				Release(state, d, EventLog::ReleaseReason::NotVisible);
+				d.action = FlightRecorder::Action::Released;
+			}
+			return d;
+		}
+
+		// ALWAYS get a fresh clip rect - never trust old values
+		RECT clip{};
+		if (!world.ClipRect(fg, clip))
+			return d;
+
+		if (clip.right <= clip.left || clip.bottom <= clip.top)
+		{
+			if (state.lastClipped)
+			{
+				Release(state, d, EventLog::ReleaseReason::InvalidRect);
+				d.action = FlightRecorder::Action::Released;
+			}
+			return d;
+		}
+
+		d.eligible = true;
+		d.clip = clip;
+		d.op = ClipOp::Apply;
+
+		// Apply on first clip, forced update, or when the window's rect has moved
+		if (state.needsClipUpdate || !state.lastClipped || RectChanged(state.appliedClip, clip))
+		{
+			d.changed = true;
+			d.action = FlightRecorder::Action::Applied;
+			state.lastClipped = true;
+			state.needsClipUpdate = false;
+			state.appliedClip = clip;
+			state.effectiveClip = clip;
+			return d;
+		}
+
+		// Otherwise the clip should still be ours. It is checked now and then (or right after an event that
+		// tends to reset it) and only re-asserted if someone else changed it.
+		d.op = ClipOp::None;
+		d.action = FlightRecorder::Action::Held;
+		if (world.VerifyDue())
+		{
+			d.verified = true;
+			RECT currentClip{};
+			if (!world.CurrentClip(currentClip) || RectChanged(currentClip, state.effectiveClip))
+			{
+				d.externalReset = true;
+				d.op = ClipOp::Apply;
+				d.action = FlightRecorder::Action::Reapplied;
+				state.appliedClip = clip;
+				state.effectiveClip = clip;
+			}
+		}
+		return d;
+	}
+
+	// The caller read GetClipCursor back right after carrying out an Apply. The system confines the rect to the
+	// screen and scales it when this process isn't DPI aware, so that is what an intact clip looks like from
+	// now on, not the rect we asked for.
+	inline void ClipReadBack(State& state, const RECT& effective)
+	{
+		if (state.lastClipped)
+			state.effectiveClip = effective;
+	}
+
+	// The safety hotkey turned clipping off between ticks. Returns true if a clip was dropped.
+	inline bool Disable(State& state)
+	{
+		bool wasClipped = state.lastClipped;
+		state.lastClipped = false;
+		return wasClipped;
+	}
+
+	// One bit per question Tick() can ask; a trace stores which were asked and the yes/no answers
+	enum Question : uint8_t
+	{
+		MOVING = 1,
+		ENABLED = 2,
+		FOREGROUND = 4,
+		IS_TARGET = 8,
+		VISIBLE = 16,
+		CLIP_RECT = 32,
+		CURRENT_CLIP = 64,
+		VERIFY_DUE = 128,
+	};
+
+	// Everything a world answered during one tick
+	struct Observations
+	{
+		uint8_t asked = 0;
+		uint8_t answers = 0;      // For the bool questions (and whether ClipRect/CurrentClip succeeded)
+		HWND foreground = nullptr;
+		RECT clip{};
+		RECT currentClip{};
+		uint8_t visiblePercent = FlightRecorder::VISIBLE_UNKNOWN;
+
+		void Answer(Question q, bool yes)
+		{
+			asked |= q;
+			if (yes) answers |= q;
+		}
+	};
+
+	// Forwards to a live world and notes the answers. Costs a few stores per question.
+	template <class World>
+	struct ObservingWorld
+	{
+		World& world;
+		Observations seen;
+
+		bool IsMoving() { bool v = world.IsMoving(); seen.Answer(MOVING, v); return v; }
+		bool Enabled() { bool v = world.Enabled(); seen.Answer(ENABLED, v); return v; }
+		HWND Foreground() { seen.foreground = world.Foreground(); seen.Answer(FOREGROUND, seen.foreground != nullptr); return seen.foreground; }
+		bool IsTarget(HWND hwnd) { bool v = world.IsTarget(hwnd); seen.Answer(IS_TARGET, v); return v; }
+
+		bool IsVisible(HWND hwnd)
+		{
+			bool v = world.IsVisible(hwnd, &seen.visiblePercent);
+			seen.Answer(VISIBLE, v);
+			return v;
+		}
+
+		bool ClipRect(HWND hwnd, RECT& rc) { bool v = world.ClipRect(hwnd, rc); seen.clip = rc; seen.Answer(CLIP_RECT, v); return v; }
+		bool VerifyDue() { bool v = world.VerifyDue(); seen.Answer(VERIFY_DUE, v); return v; }
+		bool CurrentClip(RECT& rc) { bool v = world.CurrentClip(rc); seen.currentClip = rc; seen.Answer(CURRENT_CLIP, v); return v; }
+	};
+
+	// Answers from a recorded tick. If `asked` ends up different from `seen.asked`, the replayed logic took
+	// a different path than the recorded one (questions the recording never asked are answered "no").
+	struct ReplayWorld
+	{
+		const Observations& seen;
+		uint8_t asked = 0;
+
+		bool Answer(Question q)
+		{
+			asked |= q;
+			return (seen.answers & q) != 0;
+		}
+
+		bool IsMoving() { return Answer(MOVING); }
+		bool Enabled() { return Answer(ENABLED); }
+		HWND Foreground() { Answer(FOREGROUND); return seen.foreground; }
+		bool IsTarget(HWND) { return Answer(IS_TARGET); }
+		bool IsVisible(HWND) { return Answer(VISIBLE); }
+		bool ClipRect(HWND, RECT& rc) { rc = seen.clip; return Answer(CLIP_RECT); }
+		bool VerifyDue() { return Answer(VERIFY_DUE); }
+		bool CurrentClip(RECT& rc) { rc = seen.currentClip; return Answer(CURRENT_CLIP); }
+	};
+
+}
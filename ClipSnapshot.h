@@ -0,0 +1,80 @@
+// ClipSnapshot.h
+// Seqlock-published verdict of the poll loop ("is the target clip-eligible, and where is its centre")
+// Written once per tick by the main loop, read by the keyboard hook without any Win32 calls
+
+#pragma once
+#include <windows.h>
+#include <atomic>
+#include <cstdint>
+
+// Plain copy of a snapshot as seen by a reader
+struct ClipTargetState
+{
+	HWND target = nullptr;
+	bool eligible = false;
+	POINT center{};
+	uint32_t generation = 0; // Bumped whenever target/eligibility/centre changes
+};
+
+// Single writer, any number of readers. The whole thing fits in one cache line so a read
+// touches exactly one line; readers retry only if they overlap a publish.
+class alignas(64) ClipSnapshot
+{
+public:
+	// Writer side (poll loop only). Cheap no-op when nothing changed, so readers rarely retry.
+	void Publish(HWND newTarget, bool newEligible, POINT newCenter)
+	{
+		if (target.load(std::memory_order_relaxed) == newTarget &&
+			eligible.load(std::memory_order_relaxed) == newEligible &&
+			centerX.load(std::memory_order_relaxed) == newCenter.x &&
+			centerY.load(std::memory_order_relaxed) == newCenter.y)
+			return;
+
+		uint32_t seq = sequence.load(std::memory_order_relaxed);
+		sequence.store(seq + 1, std::memory_order_relaxed); // odd: write in progress
+		std::atomic_thread_fence(std::memory_order_release);
+
+		target.store(newTarget, std::memory_order_relaxed);
+		eligible.store(newEligible, std::memory_order_relaxed);
+		centerX.store(newCenter.x, std::memory_order_relaxed);
+		centerY.store(newCenter.y, std::memory_order_relaxed);
+		generation.store(generation.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+
+		sequence.store(seq + 2, std::memory_order_release); // even: stable
+	}
+
+	// Reader side. Never blocks on the writer; spins only across an in-flight publish.
+	ClipTargetState Read() const
+	{
+		ClipTargetState out;
+		for (;;)
+		{
+			uint32_t before = sequence.load(std::memory_order_acquire);
+			if (before & 1)
+			{
+				YieldProcessor();
+				continue;
+			}
+
+			out.target = target.load(std::memory_order_relaxed);
+			out.eligible = eligible.load(std::memory_order_relaxed);
+			out.center.x = centerX.load(std::memory_order_relaxed);
+			out.center.y = centerY.load(std::memory_order_relaxed);
+			out.generation = generation.load(std::memory_order_relaxed);
+
+			std::atomic_thread_fence(std::memory_order_acquire);
+			if (sequence.load(std::memory_order_relaxed) == before)
+				return out;
+		}
+	}
+
+private:
+	std::atomic<uint32_t> sequence{ 0 };
+	std::atomic<uint32_t> generation{ 0 };
+	std::atomic<HWND> target{ nullptr };
+	std::atomic<LONG> centerX{ 0 };
+	std::atomic<LONG> centerY{ 0 };
+	std::atomic<bool> eligible{ false };
+};
+
+static_assert(sizeof(ClipSnapshot) == 64, "ClipSnapshot should occupy exactly one cache line");
@@ -0,0 +1,159 @@
+// ClipWatch.h
+// Catches other programs resetting our clip (overlays, the game itself on focus changes, remote desktop tools)
+// without re-applying it every tick
+//  - Notify(trigger): from event callbacks (foreground change, target moved, cursor seen outside); makes the
+//    next tick verify the clip at once instead of waiting for the low-rate check
+//  - VerifyDue(): asked by ClipLogic::Tick while clipped; true when an event came in or verifyMs passed
+//  - Intact()/Reset(): the outcome of a verification. Reset() returns whether this is a new reset (the
+//    same one is not counted again while its re-assertion is held back by the rate limit).
+//  - AllowReassert(): token bucket bounding ClipCursor calls when something keeps fighting over the clip
+// Main thread only. Counters are single-writer atomics, readable from anywhere for the metrics export.
+
+#pragma once
+#include <windows.h>
+#include <atomic>
+#include <cstdint>
+
+namespace ClipWatch
+{
+
+	enum class Trigger : uint8_t
+	{
+		Poll,          // No event: found by the low-rate check
+		Foreground,    // EVENT_SYSTEM_FOREGROUND
+		TargetMoved,   // EVENT_OBJECT_LOCATIONCHANGE on the target window
+		CursorOutside, // The escape detector saw the cursor outside the clip rect
+		Count
+	};
+
+	inline const char* TriggerName(uint8_t trigger)
+	{
+		static const char* names[] = { "Poll", "Foreground", "TargetMoved", "CursorOutside" };
+		return trigger < (uint8_t)Trigger::Count ? names[trigger] : "?";
+	}
+
+	constexpr uint32_t REASSERTS_PER_SEC = 20;
+	constexpr uint32_t REASSERT_BURST = 5;
+
+	struct Stats
+	{
+		std::atomic<uint64_t> resets{ 0 };
+		std::atomic<uint64_t> resetsByTrigger[(size_t)Trigger::Count] = {};
+		std::atomic<uint64_t> unclippedQpc{ 0 };      // Upper bound: from the last good check (or the event) to re-assertion
+		std::atomic<uint64_t> reassertsDeferred{ 0 }; // Re-assertions held back by the rate limit
+		std::atomic<uint64_t> verifications{ 0 };
+	};
+
+	// What preceded a reset, for the log
+	struct ResetInfo
+	{
+		Trigger trigger;
+		uint64_t sinceTriggerQpc; // 0 for Poll
+	};
+
+	class Watch
+	{
+	public:
+		Watch()
+		{
+			LARGE_INTEGER freq;
+			QueryPerformanceFrequency(&freq);
+			qpcPerMs = (uint64_t)freq.QuadPart / 1000;
+		}
+
+		const Stats& GetStats() const { return stats; }
+		bool Pending() const { return pending; }
+
+		void Notify(Trigger trigger, uint64_t qpc)
+		{
+			pending = true;
+			lastTrigger = trigger;
+			lastTriggerQpc = qpc;
+		}
+
+		bool VerifyDue(uint32_t verifyMs, uint64_t qpc)
+		{
+			if (!pending && !outstanding && qpc - lastVerifyQpc < verifyMs * qpcPerMs)
+				return false;
+			pending = false;
+			lastVerifyQpc = qpc;
+			Bump(stats.verifications, 1);
+			return true;
+		}
+
+		// The clip was (re)applied by us or verified in place
+		void Intact(uint64_t qpc)
+		{
+			lastGoodQpc = qpc;
+			lastTrigger = Trigger::Poll;
+		}
+
+		// Verification found the clip gone or changed. False if this reset was already counted.
+		bool Reset(uint64_t qpc, ResetInfo& info)
+		{
+			info.trigger = lastTrigger;
+			info.sinceTriggerQpc = lastTrigger != Trigger::Poll ? qpc - lastTriggerQpc : 0;
+			if (outstanding)
+				return false;
+			outstanding = true;
+			resetSince = lastTrigger != Trigger::Poll && lastTriggerQpc > lastGoodQpc ? lastTriggerQpc : lastGoodQpc;
+			Bump(stats.resets, 1);
+			Bump(stats.resetsByTrigger[(size_t)lastTrigger], 1);
+			return true;
+		}
+
+		// Before re-applying after a reset; false means wait (the next tick verifies again)
+		bool AllowReassert(uint64_t qpc)
+		{
+			uint64_t refill = lastRefillQpc ? (qpc - lastRefillQpc) * REASSERTS_PER_SEC / (qpcPerMs * 1000) : REASSERT_BURST;
+			if (refill > 0)
+			{
+				tokens = tokens + refill < REASSERT_BURST ? (uint32_t)(tokens + refill) : REASSERT_BURST;
+				lastRefillQpc = qpc;
+			}
+			if (tokens == 0)
+			{
+				Bump(stats.reassertsDeferred, 1);
+				return false;
+			}
+			tokens--;
+			return true;
+		}
+
+		// The re-assertion went out; closes the unclipped interval
+		void Reasserted(uint64_t qpc)
+		{
+			if (outstanding && resetSince)
+				Bump(stats.unclippedQpc, qpc - resetSince);
+			outstanding = false;
+			Intact(qpc);
+		}
+
+		// Target no longer clipped: nothing to watch until the next apply
+		void Clear()
+		{
+			pending = false;
+			outstanding = false;
+			lastTrigger = Trigger::Poll;
+		}
+
+	private:
+		static void Bump(std::atomic<uint64_t>& counter, uint64_t by)
+		{
+			counter.store(counter.load(std::memory_order_relaxed) + by, std::memory_order_relaxed);
+		}
+
+		Stats stats;
+		bool pending = false;
+		bool outstanding = false;   // A counted reset whose re-assertion hasn't gone out yet
+		Trigger lastTrigger = Trigger::Poll;
+		uint64_t lastTriggerQpc = 0;
+		uint64_t lastVerifyQpc = 0;
+		uint64_t lastGoodQpc = 0;
+		uint64_t resetSince = 0;
+		uint32_t tokens = REASSERT_BURST;
+		uint64_t lastRefillQpc = 0;
+		uint64_t qpcPerMs = 1;
+	};
+
+}
@@ -0,0 +1,529 @@
+// Config.h
+// config.txt settings: INI-style "name=value" lines parsed in one pass over a string_view
+//  - No per-line allocation: lines, names and values are views into the file text; only path values are copied out
+//  - Backward compatible: a first line without '=' (the original single-key file, e.g. "E") is the recenter key
+//  - Blank lines and lines starting with ';' or '#' are ignored
+//  - A "[name.exe]" line starts a profile section for that executable; settings below it apply only there
+// Parse() fills an immutable Settings value; problems are collected in a ParseReport for the caller to log.
+// Command-line overrides are "name=value" lines applied after the file's top-level settings (line 0 in reports).
+// Store holds the current Settings and lets a reload swap in a whole new snapshot without locks.
+
+#pragma once
+#include <windows.h>
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <climits>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "Logger.h"
+#include "VirtualKeyParser.h"
+
+namespace Config
+{
+
+	// target_exe= default; the "Bedrock" window class only identifies this exe
+	static const wchar_t DEFAULT_TARGET_EXE[] = L"Minecraft.Windows.exe";
+
+	enum class InputBackend : uint8_t
+	{
+		Hook,     // WH_KEYBOARD_LL
+		RawInput,
+		None,     // No keyboard input at all: clipping only, no recenter key
+	};
+
+	enum class ClipArea : uint8_t
+	{
+		Client, // Client area only (excludes title bar and borders)
+		Window, // Whole window rect
+	};
+
+	// Per-target behaviour. Top-level lines fill Settings::defaults; a "[name.exe]" section fills its own
+	// Profile, and whatever the section leaves out is copied from the defaults once parsing is done.
+	struct Profile
+	{
+		enum Field : uint8_t
+		{
+			RECENTER_KEY = 1,
+			POLL_MS = 2,
+			OCCLUSION = 4,
+			CLIP_AREA = 8,
+		};
+
+		std::wstring exe;                                       // Empty for the defaults
+		VirtualKeyParser::KeyChord recenterChord{ { 'E' }, 1 }; // recenter_key=
+		DWORD pollMs = 10;                                      // poll_ms=
+		uint8_t occlusionThresholdPercent = 90; // occlusion_threshold= share of sampled points that must be the target
+		ClipArea clipArea = ClipArea::Client;                   // clip_area=client|window
+		uint8_t overridden = 0; // Field bits set by the section itself
+	};
+
+	struct Settings
+	{
+		Profile defaults;
+		std::vector<Profile> profiles;                                       // [name.exe] sections
+		VirtualKeyParser::KeyChord toggleChord{ { VK_CONTROL, VK_SHIFT, 'C' }, 3 }; // toggle_hotkey=
+		DWORD recenterIntervalMs = 100;                                      // recenter_interval_ms=
+		std::wstring targetExe = DEFAULT_TARGET_EXE;                         // target_exe=
+		InputBackend inputBackend = InputBackend::Hook;                      // input_backend=hook|rawinput
+		LogLevel logLevel = LogLevel::Info;                                  // log_level=
+		std::wstring logFile;                                                // log_file=
+		DWORD logFileSizeMb = 4;                                             // log_file_size_mb=
+		DWORD logFileCount = 3;                                              // log_file_count=
+		std::wstring eventLog;                                               // event_log=
+		std::wstring flightRecorderPath = L"flight_recorder.bin";            // flight_recorder=
+		std::wstring zoneTracePath = L"zones.json";                          // zone_trace= (builds with PROFILE_ZONES=1)
+		std::wstring trace;                                                  // trace=
+		bool controlPipe = true;                                             // control_pipe=on|off
+		bool statsPage = true;                                               // stats_page=on|off
+		bool escapeDetector = true;                                          // escape_detector=on|off
+		DWORD clipVerifyMs = 100;                                            // clip_verify_ms=
+		std::wstring metricsFile;                                            // metrics_file=
+		DWORD metricsIntervalMs = 15000;                                     // metrics_interval_ms=
+
+		// Profile section for an executable name (case-insensitive), or nullptr
+		const Profile* FindProfile(const wchar_t* exe) const
+		{
+			for (const Profile& profile : profiles)
+			{
+				if (_wcsicmp(profile.exe.c_str(), exe) == 0)
+					return &profile;
+			}
+			return nullptr;
+		}
+
+		// What applies to the main target: its own section if it has one, else the defaults
+		const Profile& TargetProfile() const
+		{
+			const Profile* profile = FindProfile(targetExe.c_str());
+			return profile ? *profile : defaults;
+		}
+	};
+
+	struct ParseReport
+	{
+		static const size_t MAX_ISSUES = 16;
+
+		struct Issue
+		{
+			unsigned line;
+			char text[120];
+		};
+
+		Issue issues[MAX_ISSUES];
+		size_t issueCount = 0;
+		bool legacyKeyLine = false; // First line was a bare key name
+
+		void Add(unsigned line, const char* problem, std::string_view subject)
+		{
+			if (issueCount == MAX_ISSUES) return;
+			Issue& issue = issues[issueCount++];
+			issue.line = line;
+			snprintf(issue.text, sizeof(issue.text), "%s ('%.*s')", problem, (int)(subject.size() < 60 ? subject.size() : 60), subject.data());
+		}
+	};
+
+	inline bool SameChord(const VirtualKeyParser::KeyChord& a, const VirtualKeyParser::KeyChord& b)
+	{
+		return a.count == b.count && std::equal(a.keys, a.keys + a.count, b.keys);
+	}
+
+	inline std::string_view Trim(std::string_view s)
+	{
+		while (!s.empty() && (s.front() == ' ' || s.front() == '\t'))
+			s.remove_prefix(1);
+		while (!s.empty() && (s.back() == ' ' || s.back() == '\t' || s.back() == '\r'))
+			s.remove_suffix(1);
+		return s;
+	}
+
+	inline bool ParseNumber(std::string_view text, DWORD minValue, DWORD maxValue, DWORD& out)
+	{
+		DWORD value = 0;
+		std::from_chars_result result = std::from_chars(text.data(), text.data() + text.size(), value);
+		if (result.ec != std::errc() || result.ptr != text.data() + text.size() || value < minValue || value > maxValue)
+			return false;
+		out = value;
+		return true;
+	}
+
+	// The chord's modifiers become MOD_* flags; exactly one non-modifier key is required
+	inline bool HotkeyFromChord(const VirtualKeyParser::KeyChord& chord, UINT& modifiers, UINT& vk)
+	{
+		modifiers = 0;
+		vk = 0;
+		for (size_t i = 0; i < chord.count; i++)
+		{
+			switch (chord.keys[i])
+			{
+				case VK_CONTROL: case VK_LCONTROL: case VK_RCONTROL: modifiers |= MOD_CONTROL; break;
+				case VK_SHIFT: case VK_LSHIFT: case VK_RSHIFT: modifiers |= MOD_SHIFT; break;
+				case VK_MENU: case VK_LMENU: case VK_RMENU: modifiers |= MOD_ALT; break;
+				case VK_LWIN: case VK_RWIN: modifiers |= MOD_WIN; break;
+				default:
+					if (vk) return false;
+					vk = chord.keys[i];
+					break;
+			}
+		}
+		return vk != 0;
+	}
+
+	// Config text is UTF-8 (what current editors save); a file that isn't valid UTF-8 is taken to be in the
+	// ANSI code page, as older Notepad saved it
+	inline std::wstring WidenPath(std::string_view value)
+	{
+		if (value.empty())
+			return std::wstring();
+		UINT codePage = CP_UTF8;
+		int length = MultiByteToWideChar(codePage, MB_ERR_INVALID_CHARS, value.data(), (int)value.size(), nullptr, 0);
+		if (length <= 0)
+		{
+			codePage = CP_ACP;
+			length = MultiByteToWideChar(codePage, 0, value.data(), (int)value.size(), nullptr, 0);
+			if (length <= 0)
+				return std::wstring();
+		}
+		std::wstring out((size_t)length, L'\0');
+		MultiByteToWideChar(codePage, 0, value.data(), (int)value.size(), &out[0], length);
+		return out;
+	}
+
+	// Back to UTF-8, for printing settings in config.txt syntax and for command-line values
+	inline std::string NarrowPath(const std::wstring& value)
+	{
+		if (value.empty())
+			return std::string();
+		int length = WideCharToMultiByte(CP_UTF8, 0, value.data(), (int)value.size(), nullptr, 0, nullptr, nullptr);
+		if (length <= 0)
+			return std::string();
+		std::string out((size_t)length, '\0');
+		WideCharToMultiByte(CP_UTF8, 0, value.data(), (int)value.size(), &out[0], length, nullptr, nullptr);
+		return out;
+	}
+
+	// The settings a profile section may override. Returns false if `name` is not one of them.
+	inline bool ApplyProfileSetting(std::string_view name, std::string_view value, Profile& out, bool& ok)
+	{
+		if (name == "recenter_key")
+		{
+			VirtualKeyParser::KeyChord chord;
+			ok = VirtualKeyParser::ParseChord(value, chord);
+			if (ok) out.recenterChord = chord;
+			out.overridden |= ok ? Profile::RECENTER_KEY : 0;
+		}
+		else if (name == "poll_ms")
+		{
+			ok = ParseNumber(value, 1, 1000, out.pollMs);
+			out.overridden |= ok ? Profile::POLL_MS : 0;
+		}
+		else if (name == "occlusion_threshold")
+		{
+			DWORD percent;
+			ok = ParseNumber(value, 0, 100, percent);
+			if (ok) out.occlusionThresholdPercent = (uint8_t)percent;
+			out.overridden |= ok ? Profile::OCCLUSION : 0;
+		}
+		else if (name == "clip_area")
+		{
+			if (value == "client") out.clipArea = ClipArea::Client;
+			else if (value == "window") out.clipArea = ClipArea::Window;
+			else ok = false;
+			out.overridden |= ok ? Profile::CLIP_AREA : 0;
+		}
+		else
+		{
+			return false;
+		}
+		return true;
+	}
+
+	// Top-level-only settings. Returns false if `name` is not one of them.
+	inline bool ApplyGlobalSetting(std::string_view name, std::string_view value, Settings& out, bool& ok)
+	{
+		if (name == "toggle_hotkey")
+		{
+			VirtualKeyParser::KeyChord chord;
+			UINT modifiers, vk;
+			ok = VirtualKeyParser::ParseChord(value, chord) && HotkeyFromChord(chord, modifiers, vk);
+			if (ok) out.toggleChord = chord;
+		}
+		else if (name == "recenter_interval_ms") ok = ParseNumber(value, 0, 10000, out.recenterIntervalMs);
+		else if (name == "target_exe")
+		{
+			ok = !value.empty();
+			if (ok) out.targetExe = WidenPath(value);
+		}
+		else if (name == "input_backend")
+		{
+			if (value == "hook") out.inputBackend = InputBackend::Hook;
+			else if (value == "rawinput") out.inputBackend = InputBackend::RawInput;
+			else if (value == "none") out.inputBackend = InputBackend::None;
+			else ok = false;
+		}
+		else if (name == "log_level")
+		{
+			// ParseLevel wants a terminated string; level names are short
+			char text[8] = {};
+			ok = value.size() < sizeof(text);
+			if (ok)
+			{
+				value.copy(text, value.size());
+				ok = LogConfig::ParseLevel(text, out.logLevel);
+			}
+		}
+		else if (name == "log_file") out.logFile = WidenPath(value);
+		else if (name == "log_file_size_mb") ok = ParseNumber(value, 1, 1024, out.logFileSizeMb);
+		else if (name == "log_file_count") ok = ParseNumber(value, 1, 100, out.logFileCount);
+		else if (name == "event_log") out.eventLog = WidenPath(value);
+		else if (name == "flight_recorder")
+		{
+			ok = !value.empty();
+			if (ok) out.flightRecorderPath = WidenPath(value);
+		}
+		else if (name == "zone_trace")
+		{
+			ok = !value.empty();
+			if (ok) out.zoneTracePath = WidenPath(value);
+		}
+		else if (name == "trace") out.trace = WidenPath(value);
+		else if (name == "control_pipe")
+		{
+			if (value == "on") out.controlPipe = true;
+			else if (value == "off") out.controlPipe = false;
+			else ok = false;
+		}
+		else if (name == "metrics_file") out.metricsFile = WidenPath(value);
+		else if (name == "metrics_interval_ms") ok = ParseNumber(value, 1000, 3600000, out.metricsIntervalMs);
+		else if (name == "clip_verify_ms") ok = ParseNumber(value, 10, 10000, out.clipVerifyMs);
+		else if (name == "escape_detector")
+		{
+			if (value == "on") out.escapeDetector = true;
+			else if (value == "off") out.escapeDetector = false;
+			else ok = false;
+		}
+		else if (name == "stats_page")
+		{
+			if (value == "on") out.statsPage = true;
+			else if (value == "off") out.statsPage = false;
+			else ok = false;
+		}
+		else
+		{
+			return false;
+		}
+		return true;
+	}
+
+	// `section` is the profile being filled, or nullptr at top level.
+	// Returns false if the value was rejected (the setting keeps its default).
+	inline bool ApplySetting(std::string_view name, std::string_view value, Settings& out, Profile* section, unsigned line, ParseReport& report)
+	{
+		bool ok = true;
+		if (!ApplyProfileSetting(name, value, section ? *section : out.defaults, ok))
+		{
+			if (section)
+			{
+				report.Add(line, "Only recenter_key, poll_ms, occlusion_threshold and clip_area can be set per profile", name);
+				return false;
+			}
+			if (!ApplyGlobalSetting(name, value, out, ok))
+			{
+				report.Add(line, "Unknown setting", name);
+				return false;
+			}
+		}
+
+		if (!ok)
+			report.Add(line, "Invalid value, using the default", value);
+		return ok;
+	}
+
+	// One pass over the whole file. `out` starts from defaults; every recognised line overrides one field.
+	// `overrides` ("name=value" lines, from the command line) are applied at top level after the file.
+	inline void Parse(std::string_view text, Settings& out, ParseReport& report, std::string_view overrides = {})
+	{
+		out = Settings{};
+		report = ParseReport{};
+
+		// UTF-8 BOM from editors like Notepad
+		if (text.size() >= 3 && text.substr(0, 3) == "\xEF\xBB\xBF")
+			text.remove_prefix(3);
+
+		unsigned lineNumber = 0;
+		bool firstSetting = true;
+		size_t section = SIZE_MAX; // Index into out.profiles while inside a [name.exe] section
+		while (!text.empty())
+		{
+			size_t end = text.find('\n');
+			std::string_view line = Trim(text.substr(0, end));
+			text.remove_prefix(end == std::string_view::npos ? text.size() : end + 1);
+			lineNumber++;
+
+			if (line.empty() || line.front() == ';' || line.front() == '#')
+				continue;
+
+			Profile* sectionProfile = section == SIZE_MAX ? nullptr : &out.profiles[section];
+			size_t equals = line.find('=');
+			if (line.front() == '[')
+			{
+				std::string_view exe = line.back() == ']' ? Trim(line.substr(1, line.size() - 2)) : std::string_view();
+				if (exe.empty())
+				{
+					report.Add(lineNumber, "Expected [name.exe]", line);
+					section = SIZE_MAX;
+				}
+				else
+				{
+					// A repeated section continues the earlier one
+					std::wstring wideExe = WidenPath(exe);
+					const Profile* existing = out.FindProfile(wideExe.c_str());
+					section = existing ? (size_t)(existing - out.profiles.data()) : out.profiles.size();
+					if (!existing)
+					{
+						out.profiles.emplace_back();
+						out.profiles.back().exe = std::move(wideExe);
+					}
+				}
+			}
+			else if (equals == std::string_view::npos)
+			{
+				// The original format: the whole file is just the recenter key
+				if (firstSetting)
+				{
+					report.legacyKeyLine = true;
+					ApplySetting("recenter_key", line, out, nullptr, lineNumber, report);
+				}
+				else
+				{
+					report.Add(lineNumber, "Expected name=value", line);
+				}
+			}
+			else
+			{
+				ApplySetting(Trim(line.substr(0, equals)), Trim(line.substr(equals + 1)), out, sectionProfile, lineNumber, report);
+			}
+			firstSetting = false;
+		}
+
+		while (!overrides.empty())
+		{
+			size_t end = overrides.find('\n');
+			std::string_view line = Trim(overrides.substr(0, end));
+			overrides.remove_prefix(end == std::string_view::npos ? overrides.size() : end + 1);
+			size_t equals = line.find('=');
+			if (equals == std::string_view::npos)
+				report.Add(0, "Expected name=value", line);
+			else
+				ApplySetting(Trim(line.substr(0, equals)), Trim(line.substr(equals + 1)), out, nullptr, 0, report);
+		}
+
+		// Resolve inheritance now so lookups at run time return complete profiles
+		for (Profile& profile : out.profiles)
+		{
+			if (!(profile.overridden & Profile::RECENTER_KEY)) profile.recenterChord = out.defaults.recenterChord;
+			if (!(profile.overridden & Profile::POLL_MS)) profile.pollMs = out.defaults.pollMs;
+			if (!(profile.overridden & Profile::OCCLUSION)) profile.occlusionThresholdPercent = out.defaults.occlusionThresholdPercent;
+			if (!(profile.overridden & Profile::CLIP_AREA)) profile.clipArea = out.defaults.clipArea;
+		}
+	}
+
+	inline const char* ClipAreaName(ClipArea area) { return area == ClipArea::Window ? "window" : "client"; }
+
+	inline const char* InputBackendName(InputBackend backend)
+	{
+		static const char* names[] = { "hook", "rawinput", "none" };
+		return (uint8_t)backend <= (uint8_t)InputBackend::None ? names[(uint8_t)backend] : "?";
+	}
+
+	// Every effective value in config.txt syntax, so the output can be saved and loaded back
+	inline void Print(const Settings& settings, FILE* out)
+	{
+		auto printProfile = [out](const Profile& profile)
+		{
+			fprintf(out, "recenter_key=%s\n", VirtualKeyParser::GetChordName(profile.recenterChord).c_str());
+			fprintf(out, "poll_ms=%lu\n", (unsigned long)profile.pollMs);
+			fprintf(out, "occlusion_threshold=%u\n", profile.occlusionThresholdPercent);
+			fprintf(out, "clip_area=%s\n", ClipAreaName(profile.clipArea));
+		};
+
+		printProfile(settings.defaults);
+		fprintf(out, "toggle_hotkey=%s\n", VirtualKeyParser::GetChordName(settings.toggleChord).c_str());
+		fprintf(out, "recenter_interval_ms=%lu\n", (unsigned long)settings.recenterIntervalMs);
+		fprintf(out, "target_exe=%s\n", NarrowPath(settings.targetExe).c_str());
+		fprintf(out, "input_backend=%s\n", InputBackendName(settings.inputBackend));
+		fprintf(out, "log_level=%s\n", LogConfig::LevelName(settings.logLevel));
+		fprintf(out, "log_file=%s\n", NarrowPath(settings.logFile).c_str());
+		fprintf(out, "log_file_size_mb=%lu\n", (unsigned long)settings.logFileSizeMb);
+		fprintf(out, "log_file_count=%lu\n", (unsigned long)settings.logFileCount);
+		fprintf(out, "event_log=%s\n", NarrowPath(settings.eventLog).c_str());
+		fprintf(out, "flight_recorder=%s\n", NarrowPath(settings.flightRecorderPath).c_str());
+		fprintf(out, "zone_trace=%s\n", NarrowPath(settings.zoneTracePath).c_str());
+		fprintf(out, "trace=%s\n", NarrowPath(settings.trace).c_str());
+		fprintf(out, "control_pipe=%s\n", settings.controlPipe ? "on" : "off");
+		fprintf(out, "stats_page=%s\n", settings.statsPage ? "on" : "off");
+		fprintf(out, "escape_detector=%s\n", settings.escapeDetector ? "on" : "off");
+		fprintf(out, "clip_verify_ms=%lu\n", (unsigned long)settings.clipVerifyMs);
+		fprintf(out, "metrics_file=%s\n", NarrowPath(settings.metricsFile).c_str());
+		fprintf(out, "metrics_interval_ms=%lu\n", (unsigned long)settings.metricsIntervalMs);
+		for (const Profile& profile : settings.profiles)
+		{
+			fprintf(out, "\n[%s]\n", NarrowPath(profile.exe).c_str());
+			printProfile(profile);
+		}
+	}
+
+	// A parsed file plus what the parser had to say about it
+	struct Snapshot
+	{
+		Settings settings;
+		ParseReport report;
+		uint64_t detectedQpc = 0; // When the change that produced it was noticed (0 for the startup load)
+	};
+
+	// RCU-style holder with a single reader thread (the main thread: poll loop, hooks and WinEvent callbacks).
+	//  - Readers: Current() is one acquire load; references stay valid until that thread next calls Install()
+	//  - Writers: Offer() from any thread hands over a complete snapshot; it is never modified afterwards
+	//  - Install(): called by the reader thread between ticks, when it holds no references, so the replaced
+	//    snapshot has no readers left and is handed back to be compared and freed
+	class Store
+	{
+	public:
+		Store() : owned(new Snapshot())
+		{
+			current.store(owned.get(), std::memory_order_release);
+		}
+
+		~Store() { delete pending.exchange(nullptr); }
+
+		const Settings& Current() const { return current.load(std::memory_order_acquire)->settings; }
+		const Snapshot& CurrentSnapshot() const { return *current.load(std::memory_order_acquire); }
+
+		// An older offer that was never installed has never been read, so it can be dropped here
+		void Offer(std::unique_ptr<Snapshot> next)
+		{
+			delete pending.exchange(next.release(), std::memory_order_acq_rel);
+		}
+
+		// Returns the replaced snapshot, or nullptr if nothing was pending
+		std::unique_ptr<const Snapshot> Install()
+		{
+			std::unique_ptr<const Snapshot> next(pending.exchange(nullptr, std::memory_order_acq_rel));
+			if (!next)
+				return nullptr;
+			current.store(next.get(), std::memory_order_release);
+			owned.swap(next);
+			return next;
+		}
+
+	private:
+		std::unique_ptr<const Snapshot> owned; // Reader thread only
+		std::atomic<const Snapshot*> current{ nullptr };
+		std::atomic<Snapshot*> pending{ nullptr };
+	};
+
+}
@@ -0,0 +1,271 @@
+// ControlPipe.h
+// Local control endpoint on a named pipe (\\.\pipe\SwimMouseCursor), plus the client side for the CLI
+//  - Server: its own thread with overlapped I/O, one client at a time; never touches the clip loop.
+//            Requests are answered by a handler that only reads atomics/snapshots or posts to the main thread.
+//  - Transact(): one request/reply round trip for a client
+//
+// Frames in both directions: u32 length of what follows (little endian) | u8 code | payload
+// A request's code is a Request and it has no payload. A reply's code is a Status, followed by the
+// request's fixed-size reply struct (below) on success.
+
+#pragma once
+#include <windows.h>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <thread>
+
+namespace ControlPipe
+{
+
+	static const wchar_t* PIPE_NAME = L"\\\\.\\pipe\\SwimMouseCursor";
+
+	enum class Request : uint8_t
+	{
+		Status = 1,
+		Toggle,
+		Enable,
+		Disable,
+		Reload,
+		Stats,
+		Count
+	};
+
+	enum class Status : uint8_t
+	{
+		Ok,
+		UnknownRequest,
+		Failed,
+	};
+
+	inline const char* RequestName(uint8_t request)
+	{
+		static const char* names[] = { "?", "status", "toggle", "enable", "disable", "reload", "stats" };
+		return request < (uint8_t)Request::Count ? names[request] : "?";
+	}
+
+	// Request by name, 0 if unknown
+	inline uint8_t ParseRequest(const wchar_t* name)
+	{
+		for (uint8_t i = 1; i < (uint8_t)Request::Count; i++)
+		{
+			const char* candidate = RequestName(i);
+			size_t j = 0;
+			while (candidate[j] && name[j] == (wchar_t)candidate[j]) j++;
+			if (!candidate[j] && !name[j])
+				return i;
+		}
+		return 0;
+	}
+
+	// Reply to Status, Toggle, Enable and Disable (state after the request was queued)
+	struct StatusReply
+	{
+		uint64_t target;   // HWND of the window in front as of the last tick, 0 when not evaluated
+		int32_t centerX;   // Recenter point, valid when eligible
+		int32_t centerY;
+		uint8_t enabled;   // Clipping switched on (safety hotkey / control requests)
+		uint8_t eligible;  // Target in front, visible, with a usable clip rect
+		uint8_t reserved[6];
+	};
+	static_assert(sizeof(StatusReply) == 24, "StatusReply layout is part of the protocol");
+
+	struct StatsReply
+	{
+		uint64_t ticks;
+		uint64_t recentersExecuted;
+		uint64_t recentersRepeat;
+		uint64_t recentersDebounced;
+		uint64_t recentersIneligible;
+		uint64_t keyEvents;
+	};
+	static_assert(sizeof(StatsReply) == 48, "StatsReply layout is part of the protocol");
+
+	constexpr uint32_t MAX_PAYLOAD = 64;
+	// A client that stalls mid-frame is dropped. Between frames there is no timeout: an idle client keeps the
+	// connection (and, with one instance, the pipe) until it disconnects or the server stops.
+	constexpr DWORD IO_TIMEOUT_MS = 1000;
+
+	// Runs on the server thread. Fills `reply` (up to MAX_PAYLOAD bytes) and returns its size through replySize.
+	typedef Status (*Handler)(Request request, uint8_t* reply, uint32_t& replySize);
+
+	class Server
+	{
+	public:
+		// Fails if the pipe can't be created, e.g. another instance already owns the name
+		bool Start(Handler h)
+		{
+			handler = h;
+			pipe = CreateNamedPipeW(PIPE_NAME, PIPE_ACCESS_DUPLEX | FILE_FLAG_OVERLAPPED | FILE_FLAG_FIRST_PIPE_INSTANCE,
+				PIPE_TYPE_BYTE | PIPE_READMODE_BYTE | PIPE_WAIT | PIPE_REJECT_REMOTE_CLIENTS, 1, 256, 256, 0, nullptr);
+			if (pipe == INVALID_HANDLE_VALUE)
+			{
+				pipe = nullptr;
+				return false;
+			}
+
+			stop = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+			io = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+			if (!stop || !io)
+			{
+				Stop();
+				return false;
+			}
+			thread = std::thread([this] { Run(); });
+			return true;
+		}
+
+		void Stop()
+		{
+			if (thread.joinable())
+			{
+				SetEvent(stop);
+				thread.join();
+			}
+			if (pipe) CloseHandle(pipe);
+			if (stop) CloseHandle(stop);
+			if (io) CloseHandle(io);
+			pipe = stop = io = nullptr;
+		}
+
+		uint64_t Served() const { return served.load(std::memory_order_relaxed); }
+
+	private:
+		// Wait for an overlapped operation that returned `started`; false on error, timeout or stop
+		bool Complete(BOOL started, OVERLAPPED& ov, DWORD timeoutMs, DWORD& transferred)
+		{
+			if (!started && GetLastError() != ERROR_IO_PENDING)
+				return GetLastError() == ERROR_PIPE_CONNECTED;
+
+			HANDLE events[] = { io, stop };
+			if (WaitForMultipleObjects(2, events, FALSE, timeoutMs) != WAIT_OBJECT_0)
+			{
+				CancelIo(pipe);
+				GetOverlappedResult(pipe, &ov, &transferred, TRUE);
+				return false;
+			}
+			return GetOverlappedResult(pipe, &ov, &transferred, FALSE) != 0;
+		}
+
+		// The first chunk may wait up to firstTimeoutMs, the rest up to IO_TIMEOUT_MS each
+		bool Transfer(bool write, uint8_t* data, DWORD size, DWORD firstTimeoutMs = IO_TIMEOUT_MS)
+		{
+			DWORD done = 0;
+			while (done < size)
+			{
+				OVERLAPPED ov{};
+				ov.hEvent = io;
+				DWORD transferred = 0;
+				BOOL started = write ? WriteFile(pipe, data + done, size - done, nullptr, &ov) : ReadFile(pipe, data + done, size - done, nullptr, &ov);
+				if (!Complete(started, ov, done ? IO_TIMEOUT_MS : firstTimeoutMs, transferred) || transferred == 0)
+					return false;
+				done += transferred;
+			}
+			return true;
+		}
+
+		void Serve()
+		{
+			for (;;)
+			{
+				uint8_t frame[4 + 1 + MAX_PAYLOAD];
+				if (!Transfer(false, frame, 5, INFINITE)) // Idle until the next request starts
+					return;
+				uint32_t length;
+				memcpy(&length, frame, 4);
+				if (length != 1)
+					return; // Requests carry no payload; anything else is not our protocol
+
+				uint8_t code = frame[4];
+				uint32_t replySize = 0;
+				Status status = code > 0 && code < (uint8_t)Request::Count ? handler((Request)code, frame + 5, replySize) : Status::UnknownRequest;
+				if (status != Status::Ok || replySize > MAX_PAYLOAD)
+					replySize = 0;
+
+				length = 1 + replySize;
+				memcpy(frame, &length, 4);
+				frame[4] = (uint8_t)status;
+				if (!Transfer(true, frame, 5 + replySize))
+					return;
+				served.fetch_add(1, std::memory_order_relaxed);
+			}
+		}
+
+		void Run()
+		{
+			for (;;)
+			{
+				OVERLAPPED ov{};
+				ov.hEvent = io;
+				DWORD ignored = 0;
+				if (!Complete(ConnectNamedPipe(pipe, &ov), ov, INFINITE, ignored))
+				{
+					if (WaitForSingleObject(stop, 0) == WAIT_OBJECT_0)
+						return;
+					DisconnectNamedPipe(pipe);
+					continue;
+				}
+
+				Serve();
+				DisconnectNamedPipe(pipe);
+				if (WaitForSingleObject(stop, 0) == WAIT_OBJECT_0)
+					return;
+			}
+		}
+
+		Handler handler = nullptr;
+		HANDLE pipe = nullptr;
+		HANDLE stop = nullptr;
+		HANDLE io = nullptr;
+		std::thread thread;
+		std::atomic<uint64_t> served{ 0 };
+	};
+
+	// Client: connect, waiting up to timeoutMs for the pipe to be free. INVALID_HANDLE_VALUE on failure.
+	inline HANDLE Connect(DWORD timeoutMs)
+	{
+		for (;;)
+		{
+			HANDLE pipe = CreateFileW(PIPE_NAME, GENERIC_READ | GENERIC_WRITE, 0, nullptr, OPEN_EXISTING, 0, nullptr);
+			if (pipe != INVALID_HANDLE_VALUE || GetLastError() != ERROR_PIPE_BUSY)
+				return pipe;
+			if (!WaitNamedPipeW(PIPE_NAME, timeoutMs))
+				return INVALID_HANDLE_VALUE;
+		}
+	}
+
+	// Client: one round trip on a connected pipe. Returns false on an I/O or framing error.
+	inline bool Transact(HANDLE pipe, Request request, Status& status, uint8_t* reply, uint32_t& replySize)
+	{
+		uint8_t frame[4 + 1 + MAX_PAYLOAD];
+		uint32_t length = 1;
+		memcpy(frame, &length, 4);
+		frame[4] = (uint8_t)request;
+		DWORD transferred = 0;
+		if (!WriteFile(pipe, frame, 5, &transferred, nullptr) || transferred != 5)
+			return false;
+
+		DWORD done = 0;
+		while (done < 5)
+		{
+			if (!ReadFile(pipe, frame + done, 5 - done, &transferred, nullptr) || transferred == 0)
+				return false;
+			done += transferred;
+		}
+		memcpy(&length, frame, 4);
+		if (length < 1 || length > 1 + MAX_PAYLOAD)
+			return false;
+
+		replySize = length - 1;
+		done = 0;
+		while (done < replySize)
+		{
+			if (!ReadFile(pipe, reply + done, replySize - done, &transferred, nullptr) || transferred == 0)
+				return false;
+			done += transferred;
+		}
+		status = (Status)frame[4];
+		return true;
+	}
+
+}
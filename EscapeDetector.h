@@ -0,0 +1,185 @@
+// EscapeDetector.h
+// Notices the cursor outside the clip rect while the target is focused and clipped, i.e. the clip failed
+//  - ArmPendingClip(rect, target): from the foreground event, when the target comes to the front and the
+//    poll tick hasn't clipped it yet; escapes in that gap are reported with pendingClip set
+//  - Arm(clip, target)/Disarm(): from the poll tick, whenever the target is (no longer) clipped
+//  - OnCursor(pt, foreground): from a cursor location event (the caller hooks EVENT_OBJECT_LOCATIONCHANGE/OBJID_CURSOR
+//    only while armed), so there is no polling and no cost while the game isn't in front
+// An escape lasts from the first event outside the rect to the first one back inside, or until the target
+// loses the foreground (the user switched away before the next tick released the clip) or disarm.
+// Counters are single-writer atomics (main thread), readable from anywhere for the metrics export.
+
+#pragma once
+#include <windows.h>
+#include <atomic>
+#include <cstdint>
+#include "FlightRecorder.h"
+
+namespace EscapeDetector
+{
+
+	// One finished escape
+	struct Escape
+	{
+		uint64_t durationQpc;
+		POINT at;                              // First position seen outside
+		FlightRecorder::Action lastAction;     // Outcome of the tick before it started
+		uint32_t msSinceActivation;            // Since the target last came to the front (0xFFFFFFFF if longer than that fits)
+		bool pendingClip;                      // Started after the target came to the front, before the tick clipped it
+	};
+
+	// Upper bounds in milliseconds of the escape duration histogram; the last bucket is everything above
+	constexpr uint32_t DURATION_BOUNDS_MS[] = { 1, 5, 10, 25, 50, 100, 250, 1000 };
+	constexpr size_t DURATION_BUCKETS = sizeof(DURATION_BOUNDS_MS) / sizeof(DURATION_BOUNDS_MS[0]);
+
+	// A pending clip that the tick still hasn't applied after this long isn't coming (target occluded, say)
+	constexpr uint32_t PENDING_CLIP_MS = 1000;
+
+	struct Stats
+	{
+		std::atomic<uint64_t> escapes{ 0 };
+		std::atomic<uint64_t> pendingClipEscapes{ 0 }; // Of those, the ones before the clip was applied
+		std::atomic<uint64_t> escapedQpc{ 0 };  // Total time outside
+		std::atomic<uint64_t> armedQpc{ 0 };    // Total time armed with the clip applied, up to the last Disarm()/Publish()
+		std::atomic<uint64_t> longestQpc{ 0 };
+		std::atomic<uint64_t> durationBuckets[DURATION_BUCKETS + 1] = {};
+	};
+
+	class Detector
+	{
+	public:
+		Detector()
+		{
+			LARGE_INTEGER freq;
+			QueryPerformanceFrequency(&freq);
+			qpcPerMs = (uint64_t)freq.QuadPart / 1000;
+		}
+
+		bool IsArmed() const { return armed; }
+		bool IsEscaping() const { return escaping; }
+		bool IsPendingClip() const { return armed && pendingClip; }
+		bool PendingExpired(uint64_t qpc) const { return IsPendingClip() && qpc - armedSince > PENDING_CLIP_MS * qpcPerMs; }
+		const Stats& GetStats() const { return stats; }
+
+		// The target came to the front; escapes report how long after this they started
+		void TargetActivated(uint64_t qpc) { activatedQpc = qpc; }
+
+		// The target came to the front with `rect` as the clip it is about to get. No-op if already armed.
+		void ArmPendingClip(const RECT& expected, HWND window, uint64_t qpc)
+		{
+			if (armed)
+				return;
+			rect = expected;
+			target = window;
+			lastAction = FlightRecorder::Action::None;
+			armed = true;
+			pendingClip = true;
+			armedSince = qpc;
+		}
+
+		// Every tick the target is clipped to `clip`. Returns true if this armed the detector.
+		bool Arm(const RECT& clip, HWND window, FlightRecorder::Action action, uint64_t qpc)
+		{
+			rect = clip;
+			target = window;
+			lastAction = action;
+			if (armed && pendingClip)
+			{
+				// The clip arrived; armedQpc counts clipped time only
+				pendingClip = false;
+				armedSince = qpc;
+			}
+			if (armed)
+				return false;
+			armed = true;
+			armedSince = qpc;
+			return true;
+		}
+
+		// Target no longer eligible (or detection switched off). Ends an escape in progress.
+		const Escape* Disarm(uint64_t qpc)
+		{
+			if (!armed)
+				return nullptr;
+			const Escape* ended = escaping ? End(qpc) : nullptr;
+			if (!pendingClip)
+				Bump(stats.armedQpc, qpc - armedSince);
+			armed = false;
+			pendingClip = false;
+			return ended;
+		}
+
+		// Cursor moved to `pt`. Returns the escape that just ended, if any.
+		const Escape* OnCursor(POINT pt, HWND foreground, uint64_t qpc)
+		{
+			if (!armed)
+				return nullptr;
+
+			// ClipCursor keeps the cursor in [left, right) x [top, bottom)
+			bool outside = foreground == target &&
+				(pt.x < rect.left || pt.x >= rect.right || pt.y < rect.top || pt.y >= rect.bottom);
+			if (outside && !escaping)
+			{
+				escaping = true;
+				escapeStart = qpc;
+				current.at = pt;
+				current.lastAction = lastAction;
+				current.pendingClip = pendingClip;
+				uint64_t sinceActivation = activatedQpc ? (qpc - activatedQpc) / qpcPerMs : UINT32_MAX;
+				current.msSinceActivation = sinceActivation < UINT32_MAX ? (uint32_t)sinceActivation : UINT32_MAX;
+			}
+			else if (!outside && escaping)
+			{
+				return End(qpc);
+			}
+			return nullptr;
+		}
+
+		// Brings armedQpc up to date without disarming, for readers that want a current rate
+		void Publish(uint64_t qpc)
+		{
+			if (!armed || pendingClip)
+				return;
+			Bump(stats.armedQpc, qpc - armedSince);
+			armedSince = qpc;
+		}
+
+	private:
+		static void Bump(std::atomic<uint64_t>& counter, uint64_t by)
+		{
+			counter.store(counter.load(std::memory_order_relaxed) + by, std::memory_order_relaxed);
+		}
+
+		const Escape* End(uint64_t qpc)
+		{
+			escaping = false;
+			current.durationQpc = qpc - escapeStart;
+			Bump(stats.escapes, 1);
+			if (current.pendingClip)
+				Bump(stats.pendingClipEscapes, 1);
+			Bump(stats.escapedQpc, current.durationQpc);
+			if (current.durationQpc > stats.longestQpc.load(std::memory_order_relaxed))
+				stats.longestQpc.store(current.durationQpc, std::memory_order_relaxed);
+
+			uint64_t ms = current.durationQpc / qpcPerMs;
+			size_t bucket = 0;
+			while (bucket < DURATION_BUCKETS && ms > DURATION_BOUNDS_MS[bucket]) bucket++;
+			Bump(stats.durationBuckets[bucket], 1);
+			return &current;
+		}
+
+		Stats stats;
+		RECT rect{};
+		HWND target = nullptr;
+		FlightRecorder::Action lastAction = FlightRecorder::Action::None;
+		bool armed = false;
+		bool escaping = false;
+		bool pendingClip = false;
+		uint64_t armedSince = 0;
+		uint64_t escapeStart = 0;
+		uint64_t activatedQpc = 0;
+		uint64_t qpcPerMs = 1;
+		Escape current{};
+	};
+
+}
@@ -0,0 +1,389 @@
+// EventLog.h
+// Compact binary event stream of clip-loop state changes, plus the offline decoder (text or CSV)
+//
+// File layout:
+//   header:  "SMCEVT2\0" | u64 QPC frequency | u64 QPC at open          (little endian)
+//   records: u8 event id | varint QPC delta since previous record | payload (per id, below)
+// HWNDs and rect edges are zigzag varints relative to the previous record's value, so a
+// repeated clip of the same window costs a handful of bytes. Version 2 added CursorEscaped and ClipReset.
+// Writes happen only in Flush(); when the buffer is full a record is dropped rather than written from a hook.
+
+#pragma once
+#include <windows.h>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <vector>
+#include "ClipWatch.h"
+#include "FlightRecorder.h"
+
+namespace EventLog
+{
+
+	enum class EventId : uint8_t
+	{
+		Start = 1,
+		Exit,
+		ClippingToggled,  // payload: u8 enabled
+		MoveResizeStart,
+		MoveResizeEnd,
+		TargetActivated,  // payload: hwnd
+		ClipApplied,      // payload: hwnd, rect
+		ClipReleased,     // payload: u8 ReleaseReason
+		Recenter,         // payload: hwnd, x, y
+		CursorEscaped,    // payload: varint duration us, x, y, u8 FlightRecorder::Action of the tick before, varint ms since activation, u8 pending clip
+		ClipReset,        // payload: u8 ClipWatch::Trigger that preceded it, varint us since that trigger
+		Count
+	};
+
+	enum class ReleaseReason : uint8_t
+	{
+		NotActive,
+		NotVisible,
+		InvalidRect,
+		Disabled,
+		MoveResize,
+		Count
+	};
+
+	inline const char* EventName(EventId id)
+	{
+		static const char* names[] = { "?", "Start", "Exit", "ClippingToggled", "MoveResizeStart", "MoveResizeEnd",
+			"TargetActivated", "ClipApplied", "ClipReleased", "Recenter", "CursorEscaped", "ClipReset" };
+		return (uint8_t)id < (uint8_t)EventId::Count ? names[(uint8_t)id] : "?";
+	}
+
+	inline const char* ReleaseReasonName(uint8_t reason)
+	{
+		static const char* names[] = { "NotActive", "NotVisible", "InvalidRect", "Disabled", "MoveResize" };
+		return reason < (uint8_t)ReleaseReason::Count ? names[reason] : "?";
+	}
+
+	static const char FILE_MAGIC[8] = { 'S', 'M', 'C', 'E', 'V', 'T', '2', '\0' };
+
+	inline uint64_t ZigZag(int64_t v) { return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63); }
+	inline int64_t UnZigZag(uint64_t v) { return (int64_t)(v >> 1) ^ -(int64_t)(v & 1); }
+
+	// Single-threaded: the poll loop and the input callbacks all run on the main thread
+	class Writer
+	{
+	public:
+		bool Open(const wchar_t* path)
+		{
+			file = CreateFileW(path, GENERIC_WRITE, FILE_SHARE_READ, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+			if (file == INVALID_HANDLE_VALUE)
+			{
+				file = nullptr;
+				return false;
+			}
+
+			LARGE_INTEGER freq, now;
+			QueryPerformanceFrequency(&freq);
+			QueryPerformanceCounter(&now);
+			lastQpc = (uint64_t)now.QuadPart;
+			lastHwnd = 0;
+			lastRect = RECT{};
+
+			for (char c : FILE_MAGIC) buffer[used++] = (uint8_t)c;
+			PutFixed64((uint64_t)freq.QuadPart);
+			PutFixed64(lastQpc);
+			return true;
+		}
+
+		bool IsOpen() const { return file != nullptr; }
+
+		void Close()
+		{
+			if (!file) return;
+			Flush();
+			CloseHandle(file);
+			file = nullptr;
+		}
+
+		void Flush()
+		{
+			if (!file || used == 0) return;
+			DWORD written = 0;
+			WriteFile(file, buffer, (DWORD)used, &written, nullptr);
+			used = 0;
+		}
+
+		// From the poll loop between its periodic flushes, so the buffer always has room for what the hook adds
+		void FlushIfFull()
+		{
+			if (used >= BUFFER_SIZE / 2)
+				Flush();
+		}
+
+		// Records lost because the buffer was full
+		uint64_t Dropped() const { return dropped; }
+
+		void Event(EventId id) { Begin(id); }
+
+		void ClippingToggled(bool enabled)
+		{
+			if (!Begin(EventId::ClippingToggled)) return;
+			buffer[used++] = enabled ? 1 : 0;
+		}
+
+		void TargetActivated(HWND hwnd)
+		{
+			if (!Begin(EventId::TargetActivated)) return;
+			PutHwnd(hwnd);
+		}
+
+		void ClipApplied(HWND hwnd, const RECT& rect)
+		{
+			if (!Begin(EventId::ClipApplied)) return;
+			PutHwnd(hwnd);
+			PutVarint(ZigZag((int64_t)rect.left - lastRect.left));
+			PutVarint(ZigZag((int64_t)rect.top - lastRect.top));
+			PutVarint(ZigZag((int64_t)rect.right - lastRect.right));
+			PutVarint(ZigZag((int64_t)rect.bottom - lastRect.bottom));
+			lastRect = rect;
+		}
+
+		void ClipReleased(ReleaseReason reason)
+		{
+			if (!Begin(EventId::ClipReleased)) return;
+			buffer[used++] = (uint8_t)reason;
+		}
+
+		void Recenter(HWND hwnd, POINT pt)
+		{
+			if (!Begin(EventId::Recenter)) return;
+			PutHwnd(hwnd);
+			PutVarint(ZigZag(pt.x));
+			PutVarint(ZigZag(pt.y));
+		}
+
+		void CursorEscaped(uint64_t durationUs, POINT at, uint8_t lastAction, uint32_t msSinceActivation, bool pendingClip)
+		{
+			if (!Begin(EventId::CursorEscaped)) return;
+			PutVarint(durationUs);
+			PutVarint(ZigZag(at.x));
+			PutVarint(ZigZag(at.y));
+			buffer[used++] = lastAction;
+			PutVarint(msSinceActivation);
+			buffer[used++] = pendingClip ? 1 : 0;
+		}
+
+		void ClipReset(uint8_t trigger, uint64_t sinceTriggerUs)
+		{
+			if (!Begin(EventId::ClipReset)) return;
+			buffer[used++] = trigger;
+			PutVarint(sinceTriggerUs);
+		}
+
+	private:
+		// Largest record: id + timestamp + hwnd + 4 rect edges, 10 bytes per varint at worst
+		static const size_t MAX_RECORD = 1 + 10 * 6;
+		static const size_t BUFFER_SIZE = 64 * 1024;
+
+		bool Begin(EventId id)
+		{
+			if (!file) return false;
+			if (BUFFER_SIZE - used < MAX_RECORD)
+			{
+				// Never write from here: records also come from the keyboard hook, which must not wait on the disk
+				dropped++;
+				return false;
+			}
+
+			LARGE_INTEGER now;
+			QueryPerformanceCounter(&now);
+			buffer[used++] = (uint8_t)id;
+			PutVarint((uint64_t)now.QuadPart - lastQpc);
+			lastQpc = (uint64_t)now.QuadPart;
+			return true;
+		}
+
+		void PutVarint(uint64_t v)
+		{
+			while (v >= 0x80)
+			{
+				buffer[used++] = (uint8_t)(v | 0x80);
+				v >>= 7;
+			}
+			buffer[used++] = (uint8_t)v;
+		}
+
+		void PutFixed64(uint64_t v)
+		{
+			for (int i = 0; i < 8; i++)
+				buffer[used++] = (uint8_t)(v >> (i * 8));
+		}
+
+		void PutHwnd(HWND hwnd)
+		{
+			uint64_t value = (uint64_t)(uintptr_t)hwnd;
+			PutVarint(ZigZag((int64_t)(value - lastHwnd)));
+			lastHwnd = value;
+		}
+
+		HANDLE file = nullptr;
+		uint8_t buffer[BUFFER_SIZE];
+		size_t used = 0;
+		uint64_t dropped = 0;
+		uint64_t lastQpc = 0;
+		uint64_t lastHwnd = 0;
+		RECT lastRect{};
+	};
+
+	// Offline decoder: prints one line per record to `out`. Returns false on a bad or truncated file.
+	inline bool Decode(const wchar_t* path, bool csv, FILE* out)
+	{
+		std::ifstream in(path, std::ios::binary);
+		if (!in.is_open())
+			return false;
+		std::vector<uint8_t> data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+
+		size_t pos = 0;
+		bool ok = true;
+		auto getVarint = [&](uint64_t& v) -> bool
+		{
+			v = 0;
+			for (int shift = 0; shift < 64 && pos < data.size(); shift += 7)
+			{
+				uint8_t b = data[pos++];
+				v |= (uint64_t)(b & 0x7F) << shift;
+				if (!(b & 0x80)) return true;
+			}
+			return false;
+		};
+		auto getFixed64 = [&]() -> uint64_t
+		{
+			uint64_t v = 0;
+			for (int i = 0; i < 8; i++) v |= (uint64_t)data[pos++] << (i * 8);
+			return v;
+		};
+
+		if (data.size() < 24 || memcmp(data.data(), FILE_MAGIC, sizeof(FILE_MAGIC)) != 0)
+			return false;
+		pos = sizeof(FILE_MAGIC);
+		uint64_t freq = getFixed64();
+		getFixed64(); // QPC at open; timestamps below are relative to it
+		if (freq == 0)
+			return false;
+
+		if (csv)
+			fprintf(out, "time_ms,event,hwnd,left,top,right,bottom,arg\n");
+
+		uint64_t elapsed = 0;
+		uint64_t hwnd = 0;
+		int64_t rect[4] = {};
+		while (pos < data.size())
+		{
+			EventId id = (EventId)data[pos++];
+			uint64_t delta;
+			if (!getVarint(delta)) { ok = false; break; }
+			elapsed += delta;
+			double ms = elapsed * 1000.0 / freq;
+
+			uint64_t v;
+			bool hasHwnd = false, hasRect = false;
+			int64_t a = 0, b = 0;
+			const char* argText = "";
+			char argBuffer[96];
+			switch (id)
+			{
+				case EventId::ClippingToggled:
+					if (pos >= data.size()) { ok = false; break; }
+					argText = data[pos++] ? "enabled" : "disabled";
+					break;
+				case EventId::ClipReleased:
+					if (pos >= data.size()) { ok = false; break; }
+					argText = ReleaseReasonName(data[pos++]);
+					break;
+				case EventId::TargetActivated:
+				case EventId::ClipApplied:
+				case EventId::Recenter:
+					if (!getVarint(v)) { ok = false; break; }
+					hwnd += (uint64_t)UnZigZag(v);
+					hasHwnd = true;
+					if (id == EventId::ClipApplied)
+					{
+						for (int64_t& edge : rect)
+						{
+							if (!getVarint(v)) { ok = false; break; }
+							edge += UnZigZag(v);
+						}
+						hasRect = true;
+					}
+					else if (id == EventId::Recenter)
+					{
+						if (!getVarint(v)) { ok = false; break; }
+						a = UnZigZag(v);
+						if (!getVarint(v)) { ok = false; break; }
+						b = UnZigZag(v);
+					}
+					break;
+				case EventId::CursorEscaped:
+				{
+					uint64_t durationUs, sinceActivation;
+					if (!getVarint(durationUs)) { ok = false; break; }
+					if (!getVarint(v)) { ok = false; break; }
+					a = UnZigZag(v);
+					if (!getVarint(v)) { ok = false; break; }
+					b = UnZigZag(v);
+					if (pos >= data.size()) { ok = false; break; }
+					uint8_t lastAction = data[pos++];
+					if (!getVarint(sinceActivation) || pos >= data.size()) { ok = false; break; }
+					bool pendingClip = data[pos++] != 0;
+					if (pendingClip)
+						snprintf(argBuffer, sizeof(argBuffer), "%.3f ms before the clip, %llu ms after activation", durationUs / 1000.0,
+							(unsigned long long)sinceActivation);
+					else
+						snprintf(argBuffer, sizeof(argBuffer), "%.3f ms after %s, %llu ms after activation", durationUs / 1000.0,
+							FlightRecorder::ActionName(lastAction), (unsigned long long)sinceActivation);
+					argText = argBuffer;
+					break;
+				}
+				case EventId::ClipReset:
+				{
+					if (pos >= data.size()) { ok = false; break; }
+					uint8_t trigger = data[pos++];
+					if (!getVarint(v)) { ok = false; break; }
+					snprintf(argBuffer, sizeof(argBuffer), "after %s (%.3f ms earlier)", ClipWatch::TriggerName(trigger), v / 1000.0);
+					argText = argBuffer;
+					break;
+				}
+				case EventId::Start:
+				case EventId::Exit:
+				case EventId::MoveResizeStart:
+				case EventId::MoveResizeEnd:
+					break;
+				default:
+					ok = false;
+					break;
+			}
+			if (!ok) break;
+
+			if (csv)
+			{
+				fprintf(out, "%.3f,%s,", ms, EventName(id));
+				if (hasHwnd) fprintf(out, "0x%llx", (unsigned long long)hwnd);
+				if (hasRect) fprintf(out, ",%lld,%lld,%lld,%lld,", (long long)rect[0], (long long)rect[1], (long long)rect[2], (long long)rect[3]);
+				else if (id == EventId::Recenter || id == EventId::CursorEscaped) fprintf(out, ",%lld,%lld,,,", (long long)a, (long long)b);
+				else fprintf(out, ",,,,,");
+				fprintf(out, "%s\n", argText);
+			}
+			else
+			{
+				fprintf(out, "[%12.3f ms] %s", ms, EventName(id));
+				if (hasHwnd) fprintf(out, " hwnd=0x%llx", (unsigned long long)hwnd);
+				if (hasRect) fprintf(out, " rect=(%lld,%lld)-(%lld,%lld)", (long long)rect[0], (long long)rect[1], (long long)rect[2], (long long)rect[3]);
+				if (id == EventId::Recenter || id == EventId::CursorEscaped) fprintf(out, " at=(%lld,%lld)", (long long)a, (long long)b);
+				if (*argText) fprintf(out, " %s", argText);
+				fprintf(out, "\n");
+			}
+		}
+
+		if (!ok)
+			fprintf(stderr, "Truncated or corrupt event log at byte %zu.\n", pos);
+		return ok;
+	}
+
+}
@@ -0,0 +1,186 @@
+// FlightRecorder.h
+// Fixed-size in-memory ring of the last per-tick decisions of the clip loop, dumpable after the fact
+//  - Record(): a handful of plain stores plus one release store of the head index, no locks
+//  - Dump():   writes the ring straight from memory with CreateFile/WriteFile, no allocation, so it is
+//              safe to call from an unhandled-exception filter
+//  - Decode(): offline text dump (SwimMouseCursor.exe --decode-flight <file>)
+//
+// Dump file: magic | u64 QPC frequency | u32 record size | u32 count | u64 sequence before the oldest record |
+// count TickRecords, oldest first
+
+#pragma once
+#include <windows.h>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+namespace FlightRecorder
+{
+
+	enum class Classification : uint8_t
+	{
+		None,      // No foreground window / not evaluated (moving, disabled)
+		Other,
+		Minecraft,
+	};
+
+	enum class Action : uint8_t
+	{
+		None,       // Nothing to do (not Minecraft, already released)
+		Applied,    // New or changed clip rect
+		Reapplied,  // Same rect re-asserted after something else reset the clip
+		Released,
+		SkippedMoving,
+		SkippedDisabled,
+		Held,       // Clip already in place, nothing to do
+		Count
+	};
+
+	inline const char* ActionName(uint8_t action)
+	{
+		static const char* names[] = { "None", "Applied", "Reapplied", "Released", "SkippedMoving", "SkippedDisabled", "Held" };
+		return action < (uint8_t)Action::Count ? names[action] : "?";
+	}
+
+	constexpr uint8_t VISIBLE_UNKNOWN = 255;
+
+	struct TickRecord
+	{
+		uint64_t sequence;      // 1-based tick number; zeroed first and written last so a torn slot can be spotted
+		uint64_t qpc;           // Tick start
+		uint64_t foreground;    // HWND
+		RECT clip;              // Computed clip rect (zero if none)
+		uint32_t durationQpc;   // Tick duration in QPC ticks
+		Classification classification;
+		uint8_t visiblePercent; // Share of sampled points owned by the window, VISIBLE_UNKNOWN if not sampled
+		Action action;
+		uint8_t reserved;
+	};
+	static_assert(sizeof(TickRecord) == 48, "TickRecord layout is part of the dump format");
+
+	static const char FILE_MAGIC[8] = { 'S', 'M', 'C', 'F', 'L', 'T', '2', '\0' };
+	constexpr size_t FILE_HEADER_SIZE = 32;
+
+	template <size_t Capacity>
+	class Ring
+	{
+		static_assert((Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+	public:
+		// Single writer (the poll loop)
+		void Record(const TickRecord& rec)
+		{
+			uint64_t index = head.load(std::memory_order_relaxed);
+			TickRecord& slot = records[index & (Capacity - 1)];
+			slot.sequence = 0;
+			std::atomic_signal_fence(std::memory_order_release);
+			slot.qpc = rec.qpc;
+			slot.foreground = rec.foreground;
+			slot.clip = rec.clip;
+			slot.durationQpc = rec.durationQpc;
+			slot.classification = rec.classification;
+			slot.visiblePercent = rec.visiblePercent;
+			slot.action = rec.action;
+			slot.reserved = 0;
+			std::atomic_signal_fence(std::memory_order_release);
+			slot.sequence = index + 1;
+			head.store(index + 1, std::memory_order_release);
+		}
+
+		uint64_t Count() const { return head.load(std::memory_order_acquire); }
+
+		// Oldest to newest. Uses only stack memory: one header write plus one write per contiguous run.
+		bool Dump(const wchar_t* path) const
+		{
+			HANDLE file = CreateFileW(path, GENERIC_WRITE, FILE_SHARE_READ, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+			if (file == INVALID_HANDLE_VALUE)
+				return false;
+
+			uint64_t end = head.load(std::memory_order_acquire);
+			uint64_t begin = end > Capacity ? end - Capacity : 0;
+			LARGE_INTEGER freq;
+			QueryPerformanceFrequency(&freq);
+
+			uint8_t header[FILE_HEADER_SIZE];
+			memcpy(header, FILE_MAGIC, 8);
+			uint64_t frequency = (uint64_t)freq.QuadPart;
+			uint32_t recordSize = sizeof(TickRecord);
+			uint32_t count = (uint32_t)(end - begin);
+			memcpy(header + 8, &frequency, 8);
+			memcpy(header + 16, &recordSize, 4);
+			memcpy(header + 20, &count, 4);
+			memcpy(header + 24, &begin, 8);
+
+			DWORD written = 0;
+			bool ok = WriteFile(file, header, sizeof(header), &written, nullptr) != 0;
+
+			// The ring wraps at most once, so the range is one or two contiguous runs
+			size_t first = (size_t)(begin & (Capacity - 1));
+			size_t firstRun = count < Capacity - first ? count : Capacity - first;
+			if (ok && firstRun)
+				ok = WriteFile(file, &records[first], (DWORD)(firstRun * sizeof(TickRecord)), &written, nullptr) != 0;
+			if (ok && count > firstRun)
+				ok = WriteFile(file, &records[0], (DWORD)((count - firstRun) * sizeof(TickRecord)), &written, nullptr) != 0;
+
+			CloseHandle(file);
+			return ok;
+		}
+
+	private:
+		TickRecord records[Capacity] = {};
+		std::atomic<uint64_t> head{ 0 };
+	};
+
+	// Offline decoder: one line per recorded tick. Returns false on a bad file.
+	// A slot is only trusted if it holds exactly the tick the dump expected there. The dump may run on another
+	// thread (crash filter) while the loop keeps recording, and the signal fences in Record() don't order the
+	// stores for that thread, so a slot being rewritten can show 0, a stale or a newer sequence.
+	inline bool Decode(const wchar_t* path, FILE* out)
+	{
+		std::ifstream in(path, std::ios::binary);
+		if (!in.is_open())
+			return false;
+		std::vector<uint8_t> data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+		if (data.size() < FILE_HEADER_SIZE || memcmp(data.data(), FILE_MAGIC, sizeof(FILE_MAGIC)) != 0)
+			return false;
+
+		uint64_t frequency;
+		uint32_t recordSize, count;
+		uint64_t first;
+		memcpy(&frequency, &data[8], 8);
+		memcpy(&recordSize, &data[16], 4);
+		memcpy(&count, &data[20], 4);
+		memcpy(&first, &data[24], 8);
+		if (frequency == 0 || recordSize != sizeof(TickRecord) || data.size() < FILE_HEADER_SIZE + (size_t)count * recordSize)
+			return false;
+
+		const char* classNames[] = { "-", "other", "Minecraft" };
+		uint64_t firstQpc = 0;
+		for (uint32_t i = 0; i < count; i++)
+		{
+			TickRecord rec;
+			memcpy(&rec, &data[FILE_HEADER_SIZE + (size_t)i * recordSize], sizeof(rec));
+			if (rec.sequence != first + i + 1)
+			{
+				fprintf(out, "(torn record skipped)\n");
+				continue;
+			}
+			if (!firstQpc) firstQpc = rec.qpc;
+
+			fprintf(out, "#%-8llu %10.3f ms %7.1f us fg=0x%llx %-9s",
+				(unsigned long long)rec.sequence, (rec.qpc - firstQpc) * 1000.0 / frequency, rec.durationQpc * 1000000.0 / frequency,
+				(unsigned long long)rec.foreground, (uint8_t)rec.classification < 3 ? classNames[(uint8_t)rec.classification] : "?");
+			if (rec.visiblePercent != VISIBLE_UNKNOWN) fprintf(out, " visible=%3u%%", rec.visiblePercent);
+			else fprintf(out, " visible=   -");
+			if (rec.clip.right > rec.clip.left)
+				fprintf(out, " clip=(%ld,%ld)-(%ld,%ld)", (long)rec.clip.left, (long)rec.clip.top, (long)rec.clip.right, (long)rec.clip.bottom);
+			fprintf(out, " %s\n", ActionName((uint8_t)rec.action));
+		}
+		return true;
+	}
+
+}
@@ -0,0 +1,199 @@
+// InputSource.h
+// Keyboard event backends behind one interface:
+//  - LowLevelHookInput: WH_KEYBOARD_LL, sits synchronously in every keystroke's delivery path
+//  - RawInputSource:    Raw Input with RIDEV_INPUTSINK on a message-only window, delivered asynchronously as WM_INPUT
+// Both deliver events on the thread that called Start(), from inside its message pump.
+
+#pragma once
+#include <windows.h>
+#include <atomic>
+#include <cstdint>
+
+struct KeyEvent
+{
+	WORD vk;     // Sided modifier codes (VK_LSHIFT, VK_RCONTROL, ...), never the generic ones
+	bool isDown;
+	DWORD time;  // GetTickCount-based time the system stamped on the event
+};
+
+typedef void (*KeyEventCallback)(const KeyEvent& ev);
+
+// How long events took from the system timestamp to reaching us (GetTickCount resolution)
+struct InputDeliveryStats
+{
+	std::atomic<uint64_t> events{ 0 };
+	std::atomic<uint64_t> totalLatencyMs{ 0 };
+	std::atomic<uint32_t> maxLatencyMs{ 0 };
+
+	// Histogram for the metrics export: latency <= LATENCY_BOUNDS_MS[i], the last bucket is everything above
+	static constexpr uint32_t LATENCY_BOUNDS_MS[] = { 0, 1, 2, 5, 10, 20, 50, 100 };
+	static constexpr size_t LATENCY_BUCKETS = sizeof(LATENCY_BOUNDS_MS) / sizeof(LATENCY_BOUNDS_MS[0]);
+	std::atomic<uint64_t> latencyBuckets[LATENCY_BUCKETS + 1] = {};
+
+	void Record(DWORD eventTime)
+	{
+		DWORD latency = GetTickCount() - eventTime;
+		size_t bucket = 0;
+		while (bucket < LATENCY_BUCKETS && latency > LATENCY_BOUNDS_MS[bucket]) bucket++;
+		latencyBuckets[bucket].fetch_add(1, std::memory_order_relaxed);
+		events.fetch_add(1, std::memory_order_relaxed);
+		totalLatencyMs.fetch_add(latency, std::memory_order_relaxed);
+		if (latency > maxLatencyMs.load(std::memory_order_relaxed))
+			maxLatencyMs.store(latency, std::memory_order_relaxed);
+	}
+};
+
+class InputSource
+{
+public:
+	virtual ~InputSource() = default;
+
+	// Returns false on failure; GetLastError() has the reason
+	virtual bool Start(KeyEventCallback callback) = 0;
+	virtual void Stop() = 0;
+	virtual const wchar_t* Name() const = 0;
+
+	const InputDeliveryStats& Stats() const { return stats; }
+
+protected:
+	KeyEventCallback callback = nullptr;
+	InputDeliveryStats stats;
+};
+
+class LowLevelHookInput : public InputSource
+{
+public:
+	bool Start(KeyEventCallback cb) override
+	{
+		callback = cb;
+		instance = this;
+		hook = SetWindowsHookExW(WH_KEYBOARD_LL, HookProc, GetModuleHandleW(nullptr), 0);
+		return hook != nullptr;
+	}
+
+	void Stop() override
+	{
+		if (hook)
+		{
+			UnhookWindowsHookEx(hook);
+			hook = nullptr;
+		}
+		instance = nullptr;
+	}
+
+	const wchar_t* Name() const override { return L"hook"; }
+
+private:
+	// Keep this short: Windows silently removes hooks that exceed LowLevelHooksTimeout
+	static LRESULT CALLBACK HookProc(int nCode, WPARAM wParam, LPARAM lParam)
+	{
+		LowLevelHookInput* self = instance;
+		if (nCode == HC_ACTION && self)
+		{
+			const KBDLLHOOKSTRUCT* kb = (const KBDLLHOOKSTRUCT*)lParam;
+			bool isDown = (wParam == WM_KEYDOWN || wParam == WM_SYSKEYDOWN);
+			bool isUp = (wParam == WM_KEYUP || wParam == WM_SYSKEYUP);
+			if (isDown || isUp)
+			{
+				self->stats.Record(kb->time);
+				self->callback({ (WORD)kb->vkCode, isDown, kb->time });
+			}
+		}
+
+		// IMPORTANT: Return CallNextHookEx to NOT consume the key
+		return CallNextHookEx(self ? self->hook : nullptr, nCode, wParam, lParam);
+	}
+
+	HHOOK hook = nullptr;
+	static inline LowLevelHookInput* instance = nullptr;
+};
+
+class RawInputSource : public InputSource
+{
+public:
+	bool Start(KeyEventCallback cb) override
+	{
+		callback = cb;
+		instance = this;
+
+		HINSTANCE hInstance = GetModuleHandleW(nullptr);
+		WNDCLASSEXW wc = { sizeof(WNDCLASSEXW) };
+		wc.lpfnWndProc = WndProc;
+		wc.hInstance = hInstance;
+		wc.lpszClassName = CLASS_NAME;
+		RegisterClassExW(&wc); // Fails harmlessly if already registered by a previous Start()
+
+		window = CreateWindowExW(0, CLASS_NAME, L"", 0, 0, 0, 0, 0, HWND_MESSAGE, nullptr, hInstance, nullptr);
+		if (!window)
+			return false;
+
+		// Generic desktop / keyboard, delivered even while another process (the game) has focus
+		RAWINPUTDEVICE rid = { 0x01, 0x06, RIDEV_INPUTSINK, window };
+		if (!RegisterRawInputDevices(&rid, 1, sizeof(rid)))
+		{
+			DWORD error = GetLastError();
+			Stop();
+			SetLastError(error);
+			return false;
+		}
+		return true;
+	}
+
+	void Stop() override
+	{
+		if (window)
+		{
+			RAWINPUTDEVICE rid = { 0x01, 0x06, RIDEV_REMOVE, nullptr };
+			RegisterRawInputDevices(&rid, 1, sizeof(rid));
+			DestroyWindow(window);
+			window = nullptr;
+		}
+		instance = nullptr;
+	}
+
+	const wchar_t* Name() const override { return L"rawinput"; }
+
+private:
+	static constexpr const wchar_t* CLASS_NAME = L"SwimMouseCursorRawInput";
+
+	static LRESULT CALLBACK WndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
+	{
+		RawInputSource* self = instance;
+		if (msg == WM_INPUT && self)
+		{
+			RAWINPUT raw;
+			UINT size = sizeof(raw);
+			if (GetRawInputData((HRAWINPUT)lParam, RID_INPUT, &raw, &size, sizeof(RAWINPUTHEADER)) != (UINT)-1 &&
+				raw.header.dwType == RIM_TYPEKEYBOARD)
+			{
+				const RAWKEYBOARD& kb = raw.data.keyboard;
+				WORD vk = SidedVirtualKey(kb);
+				if (vk != 0 && vk != 0xFF) // 0xFF is a fake key from escaped scan code sequences
+				{
+					DWORD time = (DWORD)GetMessageTime();
+					self->stats.Record(time);
+					self->callback({ vk, (kb.Flags & RI_KEY_BREAK) == 0, time });
+				}
+			}
+		}
+
+		// DefWindowProc must see WM_INPUT so the system can free the input buffer
+		return DefWindowProcW(hwnd, msg, wParam, lParam);
+	}
+
+	// Raw input reports generic modifier codes; match what the low-level hook would report
+	static WORD SidedVirtualKey(const RAWKEYBOARD& kb)
+	{
+		bool e0 = (kb.Flags & RI_KEY_E0) != 0;
+		switch (kb.VKey)
+		{
+			case VK_SHIFT: return kb.MakeCode == 0x36 ? VK_RSHIFT : VK_LSHIFT;
+			case VK_CONTROL: return e0 ? VK_RCONTROL : VK_LCONTROL;
+			case VK_MENU: return e0 ? VK_RMENU : VK_LMENU;
+			default: return kb.VKey;
+		}
+	}
+
+	HWND window = nullptr;
+	static inline RawInputSource* instance = nullptr;
+};
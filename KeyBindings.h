@@ -0,0 +1,187 @@
+// KeyBindings.h
+// 256-bit key-state tracker fed by keyboard hook events, and a chord binding table
+// Bindings are compiled into mask/value bitsets so matching a key event is a few 64-bit ANDs per binding
+
+#pragma once
+#include <windows.h>
+#include <cstdint>
+#include <vector>
+#include "VirtualKeyParser.h"
+#include "Win32Calls.h"
+
+namespace KeyBindings
+{
+
+	// One bit per virtual key code
+	struct KeySet
+	{
+		uint64_t words[4] = {};
+
+		void Set(WORD vk) { words[(vk >> 6) & 3] |= (1ull << (vk & 63)); }
+		void Clear(WORD vk) { words[(vk >> 6) & 3] &= ~(1ull << (vk & 63)); }
+		bool Test(WORD vk) const { return (words[(vk >> 6) & 3] >> (vk & 63)) & 1; }
+	};
+
+	// Left/right modifiers also drive their generic code (VK_LSHIFT -> VK_SHIFT), so "CTRL" in a chord
+	// matches either control key. Low-level hooks only ever report the sided codes.
+	inline WORD GenericModifier(WORD vk)
+	{
+		switch (vk)
+		{
+			case VK_LSHIFT: case VK_RSHIFT: return VK_SHIFT;
+			case VK_LCONTROL: case VK_RCONTROL: return VK_CONTROL;
+			case VK_LMENU: case VK_RMENU: return VK_MENU;
+			default: return 0;
+		}
+	}
+
+	inline bool IsModifier(WORD vk)
+	{
+		return vk == VK_SHIFT || vk == VK_CONTROL || vk == VK_MENU || vk == VK_LWIN || vk == VK_RWIN ||
+			GenericModifier(vk) != 0;
+	}
+
+	class KeyStateTracker
+	{
+	public:
+		// Apply a key transition. Returns true if the key was already down (i.e. a key-down is an auto-repeat).
+		bool OnKeyEvent(WORD vk, bool isDown)
+		{
+			vk &= 0xFF;
+			bool wasDown = down.Test(vk);
+			if (isDown) down.Set(vk);
+			else down.Clear(vk);
+
+			WORD generic = GenericModifier(vk);
+			if (generic)
+				UpdateGeneric(generic);
+			return wasDown;
+		}
+
+		// Drop keys whose key-up we never saw (e.g. released while the secure desktop was up).
+		// Only visits keys we think are down, so it is cheap to call on every foreground change.
+		void Resync()
+		{
+			for (int word = 0; word < 4; word++)
+			{
+				uint64_t bits = down.words[word];
+				while (bits)
+				{
+					int bit = 0;
+					while (!((bits >> bit) & 1)) bit++;
+					bits &= ~(1ull << bit);
+
+					WORD vk = (WORD)(word * 64 + bit);
+					if (vk == VK_SHIFT || vk == VK_CONTROL || vk == VK_MENU)
+						continue; // Recomputed from their sided keys below
+					if (!(W32(GetAsyncKeyState)(vk) & 0x8000))
+						down.Clear(vk);
+				}
+			}
+			UpdateGeneric(VK_SHIFT);
+			UpdateGeneric(VK_CONTROL);
+			UpdateGeneric(VK_MENU);
+		}
+
+		const KeySet& State() const { return down; }
+
+	private:
+		void UpdateGeneric(WORD generic)
+		{
+			WORD left = generic == VK_SHIFT ? VK_LSHIFT : generic == VK_CONTROL ? VK_LCONTROL : VK_LMENU;
+			if (down.Test(left) || down.Test(left + 1)) down.Set(generic);
+			else down.Clear(generic);
+		}
+
+		KeySet down;
+	};
+
+	enum class Action : uint8_t
+	{
+		None,
+		Recenter,
+	};
+
+	// A chord compiled for matching: fires on key-down of `trigger` when (state & mask) == value
+	struct Binding
+	{
+		KeySet mask;
+		KeySet value;
+		WORD trigger = 0;
+		Action action = Action::None;
+	};
+
+	class BindingTable
+	{
+	public:
+		// Compile a chord. Plain keys match regardless of held modifiers (so a held SHIFT doesn't block
+		// the recenter key); chords with modifiers require exactly those modifiers to be down.
+		void Add(const VirtualKeyParser::KeyChord& chord, Action action)
+		{
+			if (chord.count == 0) return;
+
+			Binding b;
+			b.action = action;
+
+			bool hasModifier = false;
+			for (size_t i = 0; i < chord.count; i++)
+			{
+				WORD vk = chord.keys[i];
+				if (IsModifier(vk)) hasModifier = true;
+				else b.trigger = vk;
+
+				b.mask.Set(vk);
+				b.value.Set(vk);
+				if (WORD generic = GenericModifier(vk))
+				{
+					b.mask.Set(generic);
+					b.value.Set(generic);
+				}
+			}
+
+			// All-modifier chords (e.g. just "SHIFT") trigger on their last key
+			if (!b.trigger)
+				b.trigger = chord.keys[chord.count - 1];
+
+			if (hasModifier)
+			{
+				for (WORD vk : { (WORD)VK_SHIFT, (WORD)VK_CONTROL, (WORD)VK_MENU, (WORD)VK_LWIN, (WORD)VK_RWIN })
+					b.mask.Set(vk);
+			}
+
+			bindings.push_back(b);
+		}
+
+		void Clear() { bindings.clear(); }
+		size_t Size() const { return bindings.size(); }
+
+		// Match a key-down of `vk` against the current key state. Returns the first matching action, and its
+		// index in Add() order in `matched` if given. No allocations; the state must already include the key
+		// that just went down.
+		Action Match(const KeySet& state, WORD vk, size_t* matched = nullptr) const
+		{
+			vk &= 0xFF;
+			WORD generic = GenericModifier(vk);
+			for (size_t i = 0; i < bindings.size(); i++)
+			{
+				const Binding& b = bindings[i];
+				if (b.trigger != vk && b.trigger != generic)
+					continue;
+
+				if ((state.words[0] & b.mask.words[0]) == b.value.words[0] &&
+					(state.words[1] & b.mask.words[1]) == b.value.words[1] &&
+					(state.words[2] & b.mask.words[2]) == b.value.words[2] &&
+					(state.words[3] & b.mask.words[3]) == b.value.words[3])
+				{
+					if (matched) *matched = i;
+					return b.action;
+				}
+			}
+			return Action::None;
+		}
+
+	private:
+		std::vector<Binding> bindings;
+	};
+
+}
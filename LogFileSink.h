@@ -0,0 +1,265 @@
+// LogFileSink.h
+// Rotating log file sink backed by a memory-mapped, preallocated file region
+//  - Lines are memcpy'd into the mapped view: no write syscall per line
+//  - Size-based rotation: <path>, <path>.1 ... <path>.(count-1), oldest dropped
+//  - Mapped pages belong to the OS page cache, so lines survive a process crash; Flush() only
+//    matters for power loss and is called on a timer. Close() trims the unused preallocated tail.
+// The mapping layer has a POSIX mmap implementation so the rotation logic can be exercised on Linux
+// (Tests/LogFileSinkTests.cpp runs against whichever one the platform builds).
+
+#pragma once
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <cstdio>
+#endif
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <ctime>
+#include <string>
+
+namespace LogFileSink
+{
+
+	// UTF-16 (Windows) or UTF-32 (POSIX) wide text to UTF-8. Returns bytes written, never overruns `cap`.
+	inline size_t EncodeUtf8(const wchar_t* text, char* out, size_t cap)
+	{
+		size_t n = 0;
+		for (const wchar_t* p = text; *p; p++)
+		{
+			uint32_t c = (uint32_t)*p;
+			if (sizeof(wchar_t) == 2 && c >= 0xD800 && c <= 0xDBFF && p[1] >= 0xDC00 && p[1] <= 0xDFFF)
+			{
+				c = 0x10000 + ((c - 0xD800) << 10) + ((uint32_t)p[1] - 0xDC00);
+				p++;
+			}
+
+			char enc[4];
+			size_t len;
+			if (c < 0x80) { enc[0] = (char)c; len = 1; }
+			else if (c < 0x800) { enc[0] = (char)(0xC0 | (c >> 6)); enc[1] = (char)(0x80 | (c & 0x3F)); len = 2; }
+			else if (c < 0x10000) { enc[0] = (char)(0xE0 | (c >> 12)); enc[1] = (char)(0x80 | ((c >> 6) & 0x3F)); enc[2] = (char)(0x80 | (c & 0x3F)); len = 3; }
+			else { enc[0] = (char)(0xF0 | (c >> 18)); enc[1] = (char)(0x80 | ((c >> 12) & 0x3F)); enc[2] = (char)(0x80 | ((c >> 6) & 0x3F)); enc[3] = (char)(0x80 | (c & 0x3F)); len = 4; }
+
+			if (n + len > cap) break;
+			memcpy(out + n, enc, len);
+			n += len;
+		}
+		return n;
+	}
+
+	// A file preallocated to a fixed size and mapped read/write
+	class MappedFile
+	{
+	public:
+		bool Open(const std::wstring& path, size_t size)
+		{
+#ifdef _WIN32
+			file = CreateFileW(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+			if (file == INVALID_HANDLE_VALUE)
+			{
+				file = nullptr;
+				return false;
+			}
+			mapping = CreateFileMappingW(file, nullptr, PAGE_READWRITE, (DWORD)((uint64_t)size >> 32), (DWORD)size, nullptr);
+			view = mapping ? (char*)MapViewOfFile(mapping, FILE_MAP_WRITE, 0, 0, size) : nullptr;
+#else
+			fd = open(Narrow(path).c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+			if (fd < 0)
+				return false;
+			if (ftruncate(fd, (off_t)size) == 0)
+			{
+				void* p = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+				view = p == MAP_FAILED ? nullptr : (char*)p;
+			}
+#endif
+			capacity = size;
+			if (!view)
+			{
+				Close(0);
+				return false;
+			}
+			return true;
+		}
+
+		// Unmap and shrink the file to the bytes actually written
+		void Close(size_t used)
+		{
+#ifdef _WIN32
+			if (view) UnmapViewOfFile(view);
+			if (mapping) CloseHandle(mapping);
+			if (file)
+			{
+				LARGE_INTEGER end;
+				end.QuadPart = (LONGLONG)used;
+				SetFilePointerEx(file, end, nullptr, FILE_BEGIN);
+				SetEndOfFile(file);
+				CloseHandle(file);
+			}
+			file = nullptr;
+			mapping = nullptr;
+#else
+			if (view) munmap(view, capacity);
+			if (fd >= 0)
+			{
+				if (ftruncate(fd, (off_t)used) != 0) { /* Keep the padded file */ }
+				close(fd);
+			}
+			fd = -1;
+#endif
+			view = nullptr;
+			capacity = 0;
+		}
+
+		// Start writing dirty pages back to disk without waiting
+		void Flush(size_t used)
+		{
+			if (!view || !used) return;
+#ifdef _WIN32
+			FlushViewOfFile(view, used);
+#else
+			msync(view, used, MS_ASYNC);
+#endif
+		}
+
+		char* Data() const { return view; }
+		size_t Capacity() const { return capacity; }
+
+		static void Remove(const std::wstring& path)
+		{
+#ifdef _WIN32
+			DeleteFileW(path.c_str());
+#else
+			unlink(Narrow(path).c_str());
+#endif
+		}
+
+		static void Rename(const std::wstring& from, const std::wstring& to)
+		{
+#ifdef _WIN32
+			MoveFileExW(from.c_str(), to.c_str(), MOVEFILE_REPLACE_EXISTING);
+#else
+			rename(Narrow(from).c_str(), Narrow(to).c_str());
+#endif
+		}
+
+	private:
+#ifdef _WIN32
+		HANDLE file = nullptr;
+		HANDLE mapping = nullptr;
+#else
+		static std::string Narrow(const std::wstring& path)
+		{
+			std::string out(path.size() * 4, '\0');
+			out.resize(EncodeUtf8(path.c_str(), &out[0], out.size()));
+			return out;
+		}
+
+		int fd = -1;
+#endif
+		char* view = nullptr;
+		size_t capacity = 0;
+	};
+
+	// Single writer (the logging thread). Lines are "YYYY-MM-DD HH:MM:SS.mmm <text>\r\n" in UTF-8.
+	class RotatingSink
+	{
+	public:
+		static const size_t MAX_LINE = 2048; // Including timestamp and line break; longer text is cut
+
+		bool Open(const std::wstring& path, size_t fileSize, unsigned fileCount)
+		{
+			basePath = path;
+			size = fileSize < MAX_LINE * 2 ? MAX_LINE * 2 : fileSize;
+			count = fileCount ? fileCount : 1;
+			used = 0;
+			Rotate();
+			return current.Data() != nullptr;
+		}
+
+		bool IsOpen() const { return current.Data() != nullptr; }
+
+		void Write(const wchar_t* text)
+		{
+			if (!current.Data()) return;
+
+			char line[MAX_LINE];
+			size_t len = FormatTimestamp(line);
+			len += EncodeUtf8(text, line + len, MAX_LINE - len - 2);
+			line[len++] = '\r';
+			line[len++] = '\n';
+
+			if (used + len > size)
+			{
+				Rotate();
+				if (!current.Data()) return;
+			}
+			memcpy(current.Data() + used, line, len);
+			used += len;
+		}
+
+		void Flush() { current.Flush(used); }
+
+		void Close()
+		{
+			current.Close(used);
+			used = 0;
+		}
+
+		uint64_t Rotations() const { return rotations; }
+
+	private:
+		std::wstring NumberedPath(unsigned index) const
+		{
+			return index ? basePath + L"." + std::to_wstring(index) : basePath;
+		}
+
+		// Close the current file, shift <path>.i -> <path>.(i+1), and start a fresh <path>
+		void Rotate()
+		{
+			if (current.Data())
+			{
+				current.Close(used);
+				rotations++;
+			}
+			used = 0;
+
+			if (count > 1)
+			{
+				MappedFile::Remove(NumberedPath(count - 1));
+				for (unsigned i = count - 1; i > 0; i--)
+					MappedFile::Rename(NumberedPath(i - 1), NumberedPath(i));
+			}
+			current.Open(basePath, size);
+		}
+
+		static size_t FormatTimestamp(char* out)
+		{
+			using namespace std::chrono;
+			system_clock::time_point now = system_clock::now();
+			std::time_t t = system_clock::to_time_t(now);
+			int ms = (int)(duration_cast<milliseconds>(now.time_since_epoch()).count() % 1000);
+			std::tm local{};
+#ifdef _WIN32
+			localtime_s(&local, &t);
+#else
+			localtime_r(&t, &local);
+#endif
+			size_t n = strftime(out, 32, "%Y-%m-%d %H:%M:%S", &local);
+			n += (size_t)snprintf(out + n, 8, ".%03d ", ms);
+			return n;
+		}
+
+		MappedFile current;
+		std::wstring basePath;
+		size_t size = 0;
+		size_t used = 0;
+		unsigned count = 1;
+		uint64_t rotations = 0;
+	};
+
+}
@@ -0,0 +1,283 @@
+// Logger.h
+// Leveled console logging, with per-message rate limiting for lines that can flap every poll tick
+//  - LOG_ERROR/WARN/INFO/DEBUG/TRACE(fmt, ...): level checked before any formatting; levels above
+//    LOG_COMPILE_LEVEL compile to nothing (arguments are not evaluated)
+//  - Log():        info level, for startup/config/exit messages
+//  - LogLimited(): per-message-id limit plus a token bucket per category. Suppressed lines are never
+//                  formatted or written; they are counted and summarised as "repeated N times".
+// Only called from the main thread.
+
+#pragma once
+#include <windows.h>
+#include <atomic>
+#include <cstdarg>
+#include <cstdint>
+#include <cstdio>
+#include <cwchar>
+#include "ZoneProfiler.h"
+
+// Optional second destination for every written line (the rotating file sink, when configured)
+inline void (*logFileSink)(const wchar_t* text) = nullptr;
+
+inline void LogWrite(const wchar_t* text)
+{
+	if (logFileSink)
+		logFileSink(text);
+
+	DWORD ignored;
+	HANDLE hOut = GetStdHandle(STD_OUTPUT_HANDLE);
+	if (hOut && hOut != INVALID_HANDLE_VALUE)
+	{
+		WriteConsoleW(hOut, text, (DWORD)wcslen(text), &ignored, nullptr);
+		WriteConsoleW(hOut, L"\r\n", 2, &ignored, nullptr);
+	}
+	else
+	{
+		// Fallback
+		wprintf(L"%s\n", text);
+	}
+}
+
+enum class LogLevel : uint8_t
+{
+	Error,
+	Warn,
+	Info,
+	Debug,
+	Trace,
+};
+
+// Compile-time floor. Release builds drop trace statements entirely; override with /DLOG_COMPILE_LEVEL=n
+#ifndef LOG_COMPILE_LEVEL
+#ifdef NDEBUG
+#define LOG_COMPILE_LEVEL 3 // Debug
+#else
+#define LOG_COMPILE_LEVEL 4 // Trace
+#endif
+#endif
+
+namespace LogConfig
+{
+
+	// Runtime level (config: log_level=), capped by LOG_COMPILE_LEVEL
+	inline std::atomic<uint8_t> runtimeLevel{ (uint8_t)LogLevel::Info };
+
+	inline void SetLevel(LogLevel level) { runtimeLevel.store((uint8_t)level, std::memory_order_relaxed); }
+	inline LogLevel GetLevel() { return (LogLevel)runtimeLevel.load(std::memory_order_relaxed); }
+
+	inline const char* LevelName(LogLevel level)
+	{
+		static const char* names[] = { "error", "warn", "info", "debug", "trace" };
+		return (uint8_t)level <= (uint8_t)LogLevel::Trace ? names[(uint8_t)level] : "?";
+	}
+
+	// Case-insensitive level name. Returns false if unknown.
+	inline bool ParseLevel(const char* text, LogLevel& out)
+	{
+		for (uint8_t i = 0; i <= (uint8_t)LogLevel::Trace; i++)
+		{
+			if (_stricmp(text, LevelName((LogLevel)i)) == 0)
+			{
+				out = (LogLevel)i;
+				return true;
+			}
+		}
+		return false;
+	}
+
+}
+
+inline bool LogEnabled(LogLevel level)
+{
+	return (int)level <= LOG_COMPILE_LEVEL && (uint8_t)level <= LogConfig::runtimeLevel.load(std::memory_order_relaxed);
+}
+
+inline void LogV(const wchar_t* fmt, va_list ap)
+{
+	PROFILE_ZONE("log");
+	wchar_t buf[1024];
+	_vsnwprintf_s(buf, _TRUNCATE, fmt, ap);
+	LogWrite(buf);
+}
+
+inline void LogAt(LogLevel level, const wchar_t* fmt, ...)
+{
+	if (!LogEnabled(level))
+		return;
+
+	va_list ap;
+	va_start(ap, fmt);
+	LogV(fmt, ap);
+	va_end(ap);
+}
+
+inline void Log(const wchar_t* fmt, ...)
+{
+	if (!LogEnabled(LogLevel::Info))
+		return;
+
+	va_list ap;
+	va_start(ap, fmt);
+	LogV(fmt, ap);
+	va_end(ap);
+}
+
+enum class LogCategory : uint8_t
+{
+	ClipState,  // Clip applied / released / target (in)active
+	MoveResize, // Window drag detection
+	Count
+};
+
+namespace LogLimiter
+{
+
+	// Per category: at most BUCKET_CAPACITY lines in a burst, refilled at BUCKET_REFILL_PER_SEC
+	constexpr uint32_t BUCKET_CAPACITY = 10;
+	constexpr uint32_t BUCKET_REFILL_PER_SEC = 2;
+
+	// Per message id (its format string): at most MAX_PER_WINDOW lines every WINDOW_MS
+	constexpr uint32_t MAX_PER_WINDOW = 3;
+	constexpr DWORD WINDOW_MS = 5000;
+	constexpr size_t MAX_MESSAGE_IDS = 32;
+
+	struct Bucket
+	{
+		uint32_t tokens = BUCKET_CAPACITY;
+		DWORD lastRefill = 0;
+	};
+
+	struct MessageSlot
+	{
+		const wchar_t* fmt = nullptr; // Message id: call sites pass string literals, so the pointer is unique
+		LogCategory category = LogCategory::ClipState;
+		DWORD windowStart = 0;
+		uint32_t printedInWindow = 0;
+		uint32_t suppressed = 0; // Since the last summary
+	};
+
+	struct State
+	{
+		Bucket buckets[(size_t)LogCategory::Count];
+		MessageSlot slots[MAX_MESSAGE_IDS];
+		std::atomic<uint64_t> suppressedLines[(size_t)LogCategory::Count] = {};
+	};
+
+	inline State& GetState()
+	{
+		static State state;
+		return state;
+	}
+
+	inline MessageSlot* FindSlot(const wchar_t* fmt, LogCategory category)
+	{
+		State& state = GetState();
+		for (MessageSlot& slot : state.slots)
+		{
+			if (slot.fmt == fmt) return &slot;
+			if (!slot.fmt)
+			{
+				slot.fmt = fmt;
+				slot.category = category;
+				return &slot;
+			}
+		}
+		return nullptr; // Table full: such a message is only limited by its category bucket
+	}
+
+	// Print "<message start> repeated N times" without re-formatting anything
+	inline void WriteSummary(MessageSlot& slot)
+	{
+		if (!slot.suppressed) return;
+
+		// Format strings are quoted up to the first conversion, so no arguments are needed
+		wchar_t text[160];
+		size_t len = 0;
+		for (const wchar_t* p = slot.fmt; *p && *p != L'%' && len < 100; p++)
+			text[len++] = *p;
+		text[len] = 0;
+		_snwprintf_s(text + len, _countof(text) - len, _TRUNCATE, L"%s (repeated %u times)", slot.fmt[len] ? L"..." : L"", slot.suppressed);
+		LogWrite(text);
+		slot.suppressed = 0;
+	}
+
+	// Decide whether a line may be written now. Cheap: a table scan and a few integer ops, no formatting.
+	inline bool Allow(const wchar_t* fmt, LogCategory category, DWORD now)
+	{
+		State& state = GetState();
+		MessageSlot* slot = FindSlot(fmt, category);
+		if (slot && now - slot->windowStart >= WINDOW_MS)
+		{
+			slot->windowStart = now;
+			slot->printedInWindow = 0;
+		}
+
+		Bucket& bucket = state.buckets[(size_t)category];
+		uint64_t refill = (uint64_t)(now - bucket.lastRefill) * BUCKET_REFILL_PER_SEC / 1000;
+		if (refill > 0)
+		{
+			bucket.tokens = (uint32_t)(bucket.tokens + refill < BUCKET_CAPACITY ? bucket.tokens + refill : BUCKET_CAPACITY);
+			bucket.lastRefill = now;
+		}
+
+		if ((slot && slot->printedInWindow >= MAX_PER_WINDOW) || bucket.tokens == 0)
+		{
+			if (slot) slot->suppressed++;
+			state.suppressedLines[(size_t)category].fetch_add(1, std::memory_order_relaxed);
+			return false;
+		}
+
+		bucket.tokens--;
+		if (slot)
+		{
+			slot->printedInWindow++;
+			WriteSummary(*slot);
+		}
+		return true;
+	}
+
+	// Report messages that went quiet while suppressed. Call about once a second from the loop.
+	inline void FlushSummaries(DWORD now)
+	{
+		for (MessageSlot& slot : GetState().slots)
+		{
+			if (slot.fmt && slot.suppressed && now - slot.windowStart >= WINDOW_MS)
+				WriteSummary(slot);
+		}
+	}
+
+	inline uint64_t SuppressedLines(LogCategory category)
+	{
+		return GetState().suppressedLines[(size_t)category].load(std::memory_order_relaxed);
+	}
+
+}
+
+// Compiled out above LOG_COMPILE_LEVEL, otherwise a single relaxed load before any formatting
+#define LOG_AT(level, ...) \
+	do \
+	{ \
+		if constexpr ((int)(level) <= LOG_COMPILE_LEVEL) \
+		{ \
+			if (LogEnabled(level)) \
+				LogAt(level, __VA_ARGS__); \
+		} \
+	} while (0)
+
+#define LOG_ERROR(...) LOG_AT(LogLevel::Error, __VA_ARGS__)
+#define LOG_WARN(...) LOG_AT(LogLevel::Warn, __VA_ARGS__)
+#define LOG_INFO(...) LOG_AT(LogLevel::Info, __VA_ARGS__)
+#define LOG_DEBUG(...) LOG_AT(LogLevel::Debug, __VA_ARGS__)
+#define LOG_TRACE(...) LOG_AT(LogLevel::Trace, __VA_ARGS__)
+
+// Rate-limited Log() (info level) for messages that can repeat every poll tick
+inline void LogLimited(LogCategory category, const wchar_t* fmt, ...)
+{
+	if (!LogEnabled(LogLevel::Info) || !LogLimiter::Allow(fmt, category, GetTickCount()))
+		return;
+
+	va_list ap;
+	va_start(ap, fmt);
+	LogV(fmt, ap);
+	va_end(ap);
+}
@@ -0,0 +1,163 @@
+// MetricsExport.h
+// Periodic metrics file in the Prometheus text exposition format, for node exporter style textfile collectors
+//  - Exporter: its own housekeeping thread; every interval it asks a Collector for the text and replaces the
+//              file atomically (write <path>.tmp, then rename over <path>), so a scraper never sees half a file
+//  - Text: builder for counters, gauges and histograms; the collector only reads atomics
+// Cost is bounded by the fixed set of metrics: one formatting pass and one small file write per interval.
+
+#pragma once
+#include <windows.h>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <thread>
+
+namespace MetricsExport
+{
+
+	class Text
+	{
+	public:
+		Text() { text.reserve(16 * 1024); }
+
+		// "# HELP" and "# TYPE" lines; once per metric name, before its samples
+		void Describe(const char* name, const char* type, const char* help)
+		{
+			Append("# HELP %s %s\n# TYPE %s %s\n", name, help, name, type);
+		}
+
+		// One sample; `labels` is either empty or the inside of the braces, e.g. `action="applied"`
+		void Sample(const char* name, const char* labels, uint64_t value)
+		{
+			Append(*labels ? "%s{%s} %llu\n" : "%s%s %llu\n", name, labels, (unsigned long long)value);
+		}
+
+		void Sample(const char* name, const char* labels, double value)
+		{
+			Append(*labels ? "%s{%s} %.9g\n" : "%s%s %.9g\n", name, labels, value);
+		}
+
+		void Counter(const char* name, const char* help, uint64_t value)
+		{
+			Describe(name, "counter", help);
+			Sample(name, "", value);
+		}
+
+		// Histogram from per-bucket (non-cumulative) counts with upper bounds in `bounds`; the last count is +Inf
+		void Histogram(const char* name, const char* help, const double* bounds, const uint64_t* counts, size_t buckets, double sum)
+		{
+			Describe(name, "histogram", help);
+			uint64_t cumulative = 0;
+			for (size_t i = 0; i <= buckets; i++)
+			{
+				cumulative += counts[i];
+				char le[32];
+				if (i < buckets)
+					snprintf(le, sizeof(le), "le=\"%g\"", bounds[i]);
+				else
+					snprintf(le, sizeof(le), "le=\"+Inf\"");
+				Append("%s_bucket{%s} %llu\n", name, le, (unsigned long long)cumulative);
+			}
+			Append("%s_sum %.9g\n%s_count %llu\n", name, sum, name, (unsigned long long)cumulative);
+		}
+
+		const std::string& Str() const { return text; }
+		void Clear() { text.clear(); }
+
+	private:
+		template <class... Args>
+		void Append(const char* fmt, Args... args)
+		{
+			char line[256];
+			int n = snprintf(line, sizeof(line), fmt, args...);
+			if (n > 0)
+				text.append(line, (size_t)n < sizeof(line) ? (size_t)n : sizeof(line) - 1);
+		}
+
+		std::string text;
+	};
+
+	// Runs on the exporter thread
+	typedef void (*Collector)(Text& out);
+
+	class Exporter
+	{
+	public:
+		bool Start(const wchar_t* path, DWORD intervalMs, Collector c)
+		{
+			target = path;
+			temp = target + L".tmp";
+			interval = intervalMs;
+			collector = c;
+			stop = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+			if (!stop)
+				return false;
+			thread = std::thread([this] { Run(); });
+			return true;
+		}
+
+		// Writes a last file so the final counters aren't lost
+		void Stop()
+		{
+			if (thread.joinable())
+			{
+				SetEvent(stop);
+				thread.join();
+			}
+			if (stop) CloseHandle(stop);
+			stop = nullptr;
+		}
+
+		uint64_t Written() const { return written.load(std::memory_order_relaxed); }
+		uint64_t Failed() const { return failed.load(std::memory_order_relaxed); }
+		DWORD LastError() const { return lastError.load(std::memory_order_relaxed); }
+
+	private:
+		bool WriteOnce(Text& text)
+		{
+			text.Clear();
+			collector(text);
+
+			HANDLE file = CreateFileW(temp.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+			if (file == INVALID_HANDLE_VALUE)
+				return false;
+			DWORD size = (DWORD)text.Str().size();
+			DWORD transferred = 0;
+			BOOL ok = WriteFile(file, text.Str().data(), size, &transferred, nullptr) && transferred == size;
+			CloseHandle(file);
+			return ok && MoveFileExW(temp.c_str(), target.c_str(), MOVEFILE_REPLACE_EXISTING);
+		}
+
+		void Run()
+		{
+			Text text;
+			for (;;)
+			{
+				bool stopping = WaitForSingleObject(stop, interval) == WAIT_OBJECT_0;
+				if (WriteOnce(text))
+				{
+					written.fetch_add(1, std::memory_order_relaxed);
+				}
+				else
+				{
+					lastError.store(GetLastError(), std::memory_order_relaxed);
+					failed.fetch_add(1, std::memory_order_relaxed);
+				}
+				if (stopping)
+					return;
+			}
+		}
+
+		std::wstring target;
+		std::wstring temp;
+		DWORD interval = 15000;
+		Collector collector = nullptr;
+		HANDLE stop = nullptr;
+		std::thread thread;
+		std::atomic<uint64_t> written{ 0 };
+		std::atomic<uint64_t> failed{ 0 };
+		std::atomic<DWORD> lastError{ 0 };
+	};
+
+}
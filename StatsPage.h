@@ -0,0 +1,301 @@
+// StatsPage.h
+// Read-only shared memory page (named file mapping Local\SwimMouseCursor.Stats) for overlays and monitoring
+// tools: clip state, clip rect, target process, tick counts and tick latency percentiles
+//  - Writer: main thread only. Tick() after every poll tick, Publish() to make it visible.
+//  - Reader: for other processes; a consistent copy of the page without any call into us.
+//
+// The page is a sequence lock: the writer makes `sequence` odd, copies the data in and makes it even
+// again. A reader copies the data out between two reads of `sequence` and retries if they differ or are odd.
+
+#pragma once
+#include <windows.h>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include "FlightRecorder.h"
+
+namespace StatsPage
+{
+
+	static const wchar_t* MAPPING_NAME = L"Local\\SwimMouseCursor.Stats";
+	constexpr uint32_t MAGIC = 0x53434D53; // "SMCS"
+	constexpr uint16_t VERSION = 2;
+	constexpr size_t TICK_OUTCOMES = 8; // Room for FlightRecorder::Action to grow without a layout change
+	static_assert((size_t)FlightRecorder::Action::Count <= TICK_OUTCOMES, "Data::ticks is too small");
+
+	enum Flags : uint32_t
+	{
+		ENABLED = 1,       // Clipping switched on (safety hotkey / control pipe)
+		CLIPPED = 2,       // Cursor is clipped to `clip` right now
+		ELIGIBLE = 4,      // Target in front, visible, with a usable clip rect
+		TARGET_FRONT = 8,  // Target window in front (targetPid/targetWindow valid)
+		MOVING = 16,       // A window drag is in progress
+	};
+
+	struct Data
+	{
+		uint32_t flags;
+		uint32_t targetPid;
+		uint64_t targetWindow;
+		int32_t clipLeft;   // Last clip rect applied, valid with CLIPPED
+		int32_t clipTop;
+		int32_t clipRight;
+		int32_t clipBottom;
+		uint64_t ticks[TICK_OUTCOMES]; // Poll ticks by outcome (FlightRecorder::ActionName), unused slots 0
+		uint64_t recenters;
+		uint32_t tickP50Us;  // Tick duration percentiles over the last complete window of PERCENTILE_WINDOW_MS
+		uint32_t tickP90Us;
+		uint32_t tickP99Us;
+		uint32_t tickMaxUs;
+		uint64_t publishedQpc; // QueryPerformanceCounter at the last Publish(); stale if the writer hangs or exits
+		uint32_t writerPid;
+		uint32_t escapes;    // Cursor seen outside the clip rect while clipped (EscapeDetector.h)
+		uint32_t escapedMs;  // Total time it spent outside
+		uint32_t clipResets; // Our clip found reset by another program (ClipWatch.h)
+	};
+	static_assert(sizeof(Data) == 144, "Data layout is shared with readers");
+
+	struct Page
+	{
+		uint32_t magic;
+		uint16_t version;
+		uint16_t size;      // sizeof(Data)
+		std::atomic<uint32_t> sequence;
+		uint32_t reserved;
+		Data data;
+	};
+	static_assert(std::atomic<uint32_t>::is_always_lock_free, "Page::sequence must work across processes");
+
+	constexpr DWORD PERCENTILE_WINDOW_MS = 10000;
+
+	// Tick durations in microseconds, four buckets per power of two; a percentile reports its bucket's upper bound
+	class LatencyHistogram
+	{
+	public:
+		void Add(uint32_t us)
+		{
+			counts[Bucket(us)]++;
+			total++;
+			if (us > max) max = us;
+		}
+
+		uint32_t Percentile(unsigned percent) const
+		{
+			if (!total)
+				return 0;
+			uint64_t rank = (total * percent + 99) / 100;
+			uint64_t seen = 0;
+			for (size_t i = 0; i < BUCKETS; i++)
+			{
+				seen += counts[i];
+				if (seen >= rank)
+					return UpperBound(i) < max ? UpperBound(i) : max;
+			}
+			return max;
+		}
+
+		uint32_t Max() const { return max; }
+		void Reset() { *this = LatencyHistogram(); }
+
+	private:
+		static constexpr size_t BUCKETS = 4 + 30 * 4;
+
+		static size_t Bucket(uint32_t us)
+		{
+			if (us < 4)
+				return us;
+			unsigned e = 31;
+			while (!(us >> e)) e--;
+			return (e - 1) * 4 + ((us >> (e - 2)) & 3);
+		}
+
+		static uint32_t UpperBound(size_t bucket)
+		{
+			if (bucket < 4)
+				return (uint32_t)bucket;
+			unsigned e = (unsigned)(bucket / 4) + 1;
+			uint64_t bound = ((uint64_t)(4 + bucket % 4 + 1) << (e - 2)) - 1;
+			return bound > UINT32_MAX ? UINT32_MAX : (uint32_t)bound;
+		}
+
+		uint64_t counts[BUCKETS] = {};
+		uint64_t total = 0;
+		uint32_t max = 0;
+	};
+
+	class Writer
+	{
+	public:
+		// Fails if the mapping can't be created or another instance already publishes one
+		bool Open()
+		{
+			mapping = CreateFileMappingW(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE, 0, sizeof(Page), MAPPING_NAME);
+			if (!mapping)
+				return false;
+			if (GetLastError() == ERROR_ALREADY_EXISTS)
+			{
+				Close();
+				SetLastError(ERROR_ALREADY_EXISTS);
+				return false;
+			}
+
+			page = static_cast<Page*>(MapViewOfFile(mapping, FILE_MAP_WRITE, 0, 0, sizeof(Page)));
+			if (!page)
+			{
+				Close();
+				return false;
+			}
+
+			LARGE_INTEGER freq;
+			QueryPerformanceFrequency(&freq);
+			qpcPerUs = freq.QuadPart / 1000000.0;
+			data.writerPid = GetCurrentProcessId();
+			windowStart = GetTickCount();
+			page->size = sizeof(Data);
+			page->version = VERSION;
+			page->sequence.store(0, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_release);
+			page->magic = MAGIC; // Last, so a reader never accepts a half-initialised header
+			return true;
+		}
+
+		void Close()
+		{
+			if (page) UnmapViewOfFile(page);
+			if (mapping) CloseHandle(mapping);
+			page = nullptr;
+			mapping = nullptr;
+		}
+
+		bool IsOpen() const { return page != nullptr; }
+
+		void Tick(FlightRecorder::Action action, uint32_t durationQpc)
+		{
+			if (!page)
+				return;
+			data.ticks[(size_t)action < (size_t)FlightRecorder::Action::Count ? (size_t)action : 0]++;
+			latency.Add((uint32_t)(durationQpc / qpcPerUs));
+		}
+
+		// Clip state as of the tick just taken. targetPid is looked up by the caller only when the target changes.
+		void SetState(uint32_t flags, const RECT& clip, HWND target, DWORD targetPid)
+		{
+			data.flags = flags;
+			if (flags & CLIPPED)
+			{
+				data.clipLeft = clip.left;
+				data.clipTop = clip.top;
+				data.clipRight = clip.right;
+				data.clipBottom = clip.bottom;
+			}
+			data.targetWindow = (uint64_t)(uintptr_t)target;
+			data.targetPid = target ? targetPid : 0;
+		}
+
+		void SetRecenters(uint64_t recenters) { data.recenters = recenters; }
+
+		void SetEscapes(uint64_t escapes, uint64_t escapedMs)
+		{
+			data.escapes = (uint32_t)escapes;
+			data.escapedMs = (uint32_t)escapedMs;
+		}
+
+		void SetClipResets(uint64_t resets) { data.clipResets = (uint32_t)resets; }
+
+		// Rolls the latency window over once PERCENTILE_WINDOW_MS has passed
+		void UpdatePercentiles(DWORD now)
+		{
+			if (now - windowStart < PERCENTILE_WINDOW_MS)
+				return;
+			windowStart = now;
+			data.tickP50Us = latency.Percentile(50);
+			data.tickP90Us = latency.Percentile(90);
+			data.tickP99Us = latency.Percentile(99);
+			data.tickMaxUs = latency.Max();
+			latency.Reset();
+		}
+
+		void Publish()
+		{
+			if (!page)
+				return;
+			LARGE_INTEGER now;
+			QueryPerformanceCounter(&now);
+			data.publishedQpc = (uint64_t)now.QuadPart;
+
+			uint32_t sequence = page->sequence.load(std::memory_order_relaxed);
+			page->sequence.store(sequence + 1, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_release);
+			memcpy(&page->data, &data, sizeof(Data));
+			page->sequence.store(sequence + 2, std::memory_order_release);
+		}
+
+	private:
+		HANDLE mapping = nullptr;
+		Page* page = nullptr;
+		Data data{};
+		LatencyHistogram latency;
+		DWORD windowStart = 0;
+		double qpcPerUs = 1.0;
+	};
+
+	class Reader
+	{
+	public:
+		// Fails if SwimMouseCursor isn't running (or runs with stats_page=off)
+		bool Open()
+		{
+			mapping = OpenFileMappingW(FILE_MAP_READ, FALSE, MAPPING_NAME);
+			if (!mapping)
+				return false;
+			page = static_cast<const Page*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, sizeof(Page)));
+			if (!page)
+			{
+				Close();
+				return false;
+			}
+			return true;
+		}
+
+		void Close()
+		{
+			if (page) UnmapViewOfFile(page);
+			if (mapping) CloseHandle(mapping);
+			page = nullptr;
+			mapping = nullptr;
+		}
+
+		// Copies a consistent snapshot; false if the page isn't initialised yet, has another layout, or the
+		// writer kept it busy for maxAttempts reads (it holds it for a 144 byte copy, so that takes a stalled writer)
+		bool Read(Data& out, unsigned maxAttempts = 1000, unsigned* retries = nullptr) const
+		{
+			if (!page || page->magic != MAGIC || page->version != VERSION || page->size != sizeof(Data))
+				return false;
+
+			for (unsigned attempt = 0; attempt < maxAttempts; attempt++)
+			{
+				uint32_t before = page->sequence.load(std::memory_order_acquire);
+				if (before & 1)
+				{
+					YieldProcessor();
+					continue;
+				}
+				memcpy(&out, (const void*)&page->data, sizeof(Data));
+				std::atomic_thread_fence(std::memory_order_acquire);
+				if (page->sequence.load(std::memory_order_relaxed) == before)
+				{
+					if (retries) *retries = attempt;
+					return true;
+				}
+			}
+			return false;
+		}
+
+		~Reader() { Close(); }
+
+	private:
+		HANDLE mapping = nullptr;
+		const Page* page = nullptr;
+	};
+
+}
@@ -1,9 +1,10 @@
 // Standalone console utility to confine mouse to the Minecraft Bedrock window.
 // Notes:
-//  - Detects Bedrock by process name "Minecraft.Windows.exe". Falls back to window title contains "Minecraft".
+//  - Detects Bedrock by window class or process name "Minecraft.Windows.exe". Falls back to window title contains "Minecraft".
+//    Verdicts are cached per HWND and invalidated on rename/destroy WinEvents.
 //  - Clips cursor to window bounds whenever Minecraft is focused (fullscreen OR windowed)
 //  - Configurable hotkey to recenter cursor (default: E key, configurable via config.txt)
-//  - Uses low-level keyboard hook to NOT consume the key press
+//  - Uses low-level keyboard hook (or Raw Input, config: input_backend=rawinput) to NOT consume the key press
 
 #define WIN32_LEAN_AND_MEAN
 #include <windows.h>
@@ -17,92 +18,255 @@
 #include <cstdint>
 #include <fstream>
 #include <cctype>
+#include <cstring>
+#include <cstdlib>
+#include <unordered_map>
+#include <vector>
+#include <memory>
+#include <algorithm>
 
 #pragma comment(lib, "Shlwapi.lib")
 
+#include "Logger.h"
+#include "LogFileSink.h"
 #include "VirtualKeyParser.h"
-
-static const wchar_t* TARGET_EXE = L"Minecraft.Windows.exe";
-static const wchar_t* CONFIG_FILE = L"config.txt";
+#include "Config.h"
+#include "KeyBindings.h"
+#include "InputSource.h"
+#include "EventLog.h"
+#include "ClipSnapshot.h"
+#include "FlightRecorder.h"
+#include "ClipLogic.h"
+#include "Trace.h"
+#include "Win32Calls.h"
+#include "ControlPipe.h"
+#include "StatsPage.h"
+#include "MetricsExport.h"
+#include "EscapeDetector.h"
+#include "ClipWatch.h"
+
+static const wchar_t* CONFIG_FILE_NAME = L"config.txt";
+static std::wstring configPath = CONFIG_FILE_NAME; // Absolute once ResolveConfigPath() has run
+static Config::Store configStore; // Current settings; a reload swaps in a whole new snapshot (see ApplyConfigUpdate)
+static HANDLE configWatchStop = nullptr; // Signalled on exit to end the config watcher thread
+static std::string commandLineOverrides; // "name=value" lines from the command line, applied on every (re)load
 static std::atomic<bool> clippingEnabled{ true };
 static std::atomic<bool> running{ true };
-static std::atomic<bool> windowBeingMoved{ false };
-static WORD recenterKey = 'E'; // Default recenter key
-static HHOOK keyboardHook = nullptr;
+static HANDLE exitCleanupDone = nullptr; // Set once main() has flushed and closed everything, for ConsoleCtrlHandler
+static KeyBindings::KeyStateTracker keyState; // Hook thread only
+static KeyBindings::BindingTable keyBindings; // Built at startup and on config reload, read by the hook
+// Per recenter binding (the chord, then Escape, see BindRecenterChord), so one doesn't debounce the other
+constexpr size_t RECENTER_BINDINGS = 2;
+static DWORD lastRecenterTime[RECENTER_BINDINGS] = {}; // Hook event time of the binding's last executed recenter
+static bool recenteredBefore[RECENTER_BINDINGS] = {};
+
+// Written by the hook thread, readable from anywhere
+struct RecenterStats
+{
+	std::atomic<uint64_t> executed{ 0 };
+	std::atomic<uint64_t> suppressedRepeat{ 0 };   // Auto-repeat key-downs of an already held key
+	std::atomic<uint64_t> suppressedInterval{ 0 }; // Distinct presses inside recenter_interval_ms
+	std::atomic<uint64_t> ineligible{ 0 };         // Target not focused/visible at the time
+};
+static RecenterStats recenterStats;
+
+// Written by the main thread, readable from anywhere (metrics export). Single writer, so no locked adds.
+struct LoopCounters
+{
+	std::atomic<uint64_t> ticks[(size_t)FlightRecorder::Action::Count] = {};
+	std::atomic<uint64_t> releases[(size_t)EventLog::ReleaseReason::Count] = {};
+
+	static void Bump(std::atomic<uint64_t>& counter) { counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed); }
+};
+static LoopCounters loopCounters;
+static std::unique_ptr<InputSource> inputSource; // Keyboard backend selected by config (input_backend=)
+static EventLog::Writer eventLog; // Binary state-change stream, only open when config has event_log=<path>
+static LogFileSink::RotatingSink logFile; // Copy of the console log, only open when config has log_file=<path>
+static ClipSnapshot clipSnapshot; // Poll loop verdict published for the keyboard hook
+static FlightRecorder::Ring<4096> flightRecorder; // Last poll ticks, dumped on Ctrl+Shift+D, exit or crash
+static Trace::Writer trace; // Every observation and decision of the loop, only open when config has trace=<path>
+static ControlPipe::Server controlPipe; // Local control endpoint (config: control_pipe=off disables it)
+static StatsPage::Writer statsPage;     // Shared memory stats for overlays (config: stats_page=off disables it)
+static MetricsExport::Exporter metricsExporter; // Prometheus text file, only running when config has metrics_file=<path>
+static EscapeDetector::Detector escapeDetector; // Cursor outside the clip while clipped (config: escape_detector=off disables it)
+static ClipWatch::Watch clipWatch;              // Notices other programs resetting our clip (main thread)
+static HWINEVENTHOOK locationHook = nullptr;    // Cursor and window location events, installed only while clipped
+static HWINEVENTHOOK foregroundHook = nullptr;
+static HWND watchedTarget = nullptr;            // Target window clipped as of the last tick
+static DWORD mainThreadId = 0; // Control requests that change the loop are posted here
+static const UINT WM_CONTROL_CLIPPING = WM_APP + 1; // Thread message, wParam: 0 disable, 1 enable, 2 toggle
+
+// Window classes that identify the default target exe without asking the owning process anything
+static const wchar_t* TARGET_CLASS_NAMES[] = { L"Bedrock" };
+
+// Cached GetTargetProfile verdicts, keyed by HWND. Only touched on the main thread
+// (poll loop, keyboard hook and WinEvent callbacks all run from its message pump).
+// Profiles point into the current config snapshot, so a reload clears the cache.
+struct WindowClassEntry
+{
+	DWORD pid;
+	const Config::Profile* profile; // nullptr: not a target
+};
+static std::unordered_map<HWND, WindowClassEntry> windowClassCache;
+static const size_t WINDOW_CLASS_CACHE_MAX = 256;
+static HWINEVENTHOOK nameChangeHook = nullptr;
+static HWINEVENTHOOK destroyHook = nullptr;
+static VirtualKeyParser::KeyChord boundRecenterChord; // Chord currently in keyBindings
+
+struct ClassifierStats
+{
+	uint64_t lookups = 0;
+	uint64_t cacheHits = 0;
+	uint64_t exeQueries = 0;
+	uint64_t titleReads = 0;
+	uint64_t missTicks = 0; // QPC ticks spent in uncached classification
+	uint64_t lookupTicks = 0; // QPC ticks spent in GetTargetProfile, cache hits included
+};
+static ClassifierStats classifierStats;
+
+// Lock-free; the reference stays valid until the main thread's next ApplyConfigUpdate()
+static const Config::Settings& CurrentConfig()
+{
+	return configStore.Current();
+}
 
-static void Log(const wchar_t* fmt, ...)
+// File name of a process's executable into `name`, empty on failure. No allocation.
+static void GetProcessExeName(DWORD pid, wchar_t (&name)[MAX_PATH])
 {
-	wchar_t buf[1024];
-	va_list ap;
-	va_start(ap, fmt);
-	_vsnwprintf_s(buf, _TRUNCATE, fmt, ap);
-	va_end(ap);
-	DWORD ignored;
+	name[0] = 0;
+	if (!pid) return;
+	HANDLE h = W32(OpenProcess)(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, pid);
+	if (!h) return;
 
-	HANDLE hOut = GetStdHandle(STD_OUTPUT_HANDLE);
-	if (hOut && hOut != INVALID_HANDLE_VALUE)
+	DWORD sz = MAX_PATH;
+	if (W32(QueryFullProcessImageNameW)(h, 0, name, &sz))
 	{
-		WriteConsoleW(hOut, buf, (DWORD)wcslen(buf), &ignored, nullptr);
-		WriteConsoleW(hOut, L"\r\n", 2, &ignored, nullptr);
+		const wchar_t* fname = PathFindFileNameW(name);
+		memmove(name, fname, (wcslen(fname) + 1) * sizeof(wchar_t));
 	}
 	else
 	{
-		// Fallback
-		wprintf(L"%s\n", buf);
+		name[0] = 0;
 	}
+	W32(CloseHandle)(h);
 }
 
-static std::wstring GetProcessExeName(DWORD pid)
+// Uncached classification. Cheapest checks first: the class name lives in our own desktop heap view,
+// the exe name costs a process handle, and the title is a synchronous cross-process message.
+// Returns the profile that applies to the window, or nullptr if it is not a target.
+static const Config::Profile* ClassifyWindow(HWND hwnd, DWORD pid)
 {
-	std::wstring name;
-	if (!pid) return name;
-	HANDLE h = OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, pid);
-	if (!h) return name;
+	const Config::Settings& config = CurrentConfig();
+	// Only Minecraft's own window class is known; with another target_exe a Bedrock window is just another app
+	wchar_t className[256] = { 0 };
+	if (_wcsicmp(config.targetExe.c_str(), Config::DEFAULT_TARGET_EXE) == 0 && W32(GetClassNameW)(hwnd, className, 255) > 0)
+	{
+		for (const wchar_t* targetClass : TARGET_CLASS_NAMES)
+		{
+			if (_wcsicmp(className, targetClass) == 0)
+				return &config.TargetProfile();
+		}
+	}
 
-	wchar_t buf[MAX_PATH];
-	DWORD sz = MAX_PATH;
-	if (QueryFullProcessImageNameW(h, 0, buf, &sz))
+	classifierStats.exeQueries++;
+	wchar_t exe[MAX_PATH];
+	GetProcessExeName(pid, exe);
+	if (exe[0])
 	{
-		wchar_t* fname = PathFindFileNameW(buf);
-		if (fname) name = fname;
+		if (const Config::Profile* profile = config.FindProfile(exe))
+			return profile;
+		if (_wcsicmp(exe, config.targetExe.c_str()) == 0)
+			return &config.defaults;
 	}
-	CloseHandle(h);
-	return name;
+
+	// Fallback: title contains "Minecraft"
+	classifierStats.titleReads++;
+	wchar_t title[512] = { 0 };
+	W32(GetWindowTextW)(hwnd, title, 511);
+	return wcsstr(title, L"Minecraft") != nullptr ? &config.TargetProfile() : nullptr;
 }
 
-static bool IsMinecraftWindow(HWND hwnd)
+static const wchar_t* ProfileName(const Config::Profile* profile)
 {
-	if (!hwnd || !IsWindow(hwnd)) return false;
+	return !profile ? L"other" : profile->exe.empty() ? L"Minecraft" : profile->exe.c_str();
+}
+
+// GetTargetProfile without the per-lookup timing
+static const Config::Profile* LookupTargetProfile(HWND hwnd)
+{
+	if (!hwnd || !W32(IsWindow)(hwnd)) return nullptr;
 
 	DWORD pid = 0;
-	GetWindowThreadProcessId(hwnd, &pid);
-	std::wstring exe = GetProcessExeName(pid);
-	if (!exe.empty() && _wcsicmp(exe.c_str(), TARGET_EXE) == 0)
+	W32(GetWindowThreadProcessId)(hwnd, &pid);
+
+	// Positive and negative verdicts are both cached, so a browser sitting in the foreground only pays
+	// for the exe/title lookup once. The pid guards against a recycled HWND we missed the destroy event for.
+	// Caching is only safe while the rename/destroy hooks are installed to invalidate entries.
+	bool cacheUsable = nameChangeHook && destroyHook;
+	classifierStats.lookups++;
+	if (cacheUsable)
 	{
-		return true;
+		auto it = windowClassCache.find(hwnd);
+		if (it != windowClassCache.end() && it->second.pid == pid)
+		{
+			classifierStats.cacheHits++;
+			return it->second.profile;
+		}
 	}
 
-	// Fallback: title contains "Minecraft"
-	wchar_t title[512] = { 0 };
-	GetWindowTextW(hwnd, title, 511);
-	return wcsstr(title, L"Minecraft") != nullptr;
+	LARGE_INTEGER start, end;
+	QueryPerformanceCounter(&start);
+	const Config::Profile* profile = ClassifyWindow(hwnd, pid);
+	QueryPerformanceCounter(&end);
+	classifierStats.missTicks += (uint64_t)(end.QuadPart - start.QuadPart);
+
+	LOG_DEBUG(L"[.] Classified window %p (pid %lu) as %s.", hwnd, pid, ProfileName(profile));
+
+	if (cacheUsable)
+	{
+		// Bounded: short-lived windows we never saw destroyed shouldn't grow this forever
+		if (windowClassCache.size() >= WINDOW_CLASS_CACHE_MAX)
+			windowClassCache.clear();
+		windowClassCache[hwnd] = { pid, profile };
+	}
+	return profile;
+}
+
+// Settings for the window if it is a target (Minecraft or an exe with a profile section), else nullptr.
+// Called every tick with whatever is in the foreground, so its cost is what a non-target app pays.
+static const Config::Profile* GetTargetProfile(HWND hwnd)
+{
+	LARGE_INTEGER start, end;
+	QueryPerformanceCounter(&start);
+	const Config::Profile* profile = LookupTargetProfile(hwnd);
+	QueryPerformanceCounter(&end);
+	classifierStats.lookupTicks += (uint64_t)(end.QuadPart - start.QuadPart);
+	return profile;
+}
+
+// WinEvent callback (out of context, delivered through our message pump) that drops cached
+// verdicts when a window is renamed or destroyed, so the title fallback is re-evaluated.
+static void CALLBACK WindowCacheEventProc(HWINEVENTHOOK, DWORD, HWND hwnd, LONG idObject, LONG idChild, DWORD, DWORD)
+{
+	if (!hwnd || idObject != OBJID_WINDOW || idChild != CHILDID_SELF) return;
+	windowClassCache.erase(hwnd);
 }
 
 // Detect if any window is being moved or resized
 static bool IsAnyWindowBeingMovedOrResized()
 {
 	// Check if left mouse button is down (used for dragging)
-	if (GetAsyncKeyState(VK_LBUTTON) & 0x8000)
+	if (W32(GetAsyncKeyState)(VK_LBUTTON) & 0x8000)
 	{
 		// Get cursor position
 		POINT pt;
-		if (GetCursorPos(&pt))
+		if (W32(GetCursorPos)(&pt))
 		{
-			HWND hwndAtCursor = WindowFromPoint(pt);
+			HWND hwndAtCursor = W32(WindowFromPoint)(pt);
 			if (hwndAtCursor)
 			{
 				// Check if cursor is over a window's non-client area (title bar, borders)
-				LRESULT hitTest = SendMessageW(hwndAtCursor, WM_NCHITTEST, 0, MAKELPARAM(pt.x, pt.y));
+				LRESULT hitTest = W32(SendMessageW)(hwndAtCursor, WM_NCHITTEST, 0, MAKELPARAM(pt.x, pt.y));
 
 				// If hit test returns any of these, a move/resize is likely happening
 				if (hitTest == HTCAPTION ||      // Title bar (dragging to move)
@@ -124,23 +288,25 @@ static bool IsAnyWindowBeingMovedOrResized()
 	return false;
 }
 
-static bool IsWindowActuallyVisibleAndTopmost(HWND hwnd)
+// thresholdPercent: share of sampled points that must belong to the window (profile occlusion_threshold)
+// visiblePercent (optional) receives the share actually found, when sampling was reached
+static bool IsWindowActuallyVisibleAndTopmost(HWND hwnd, uint8_t thresholdPercent, uint8_t* visiblePercent = nullptr)
 {
-	if (!hwnd || !IsWindow(hwnd) || !IsWindowVisible(hwnd))
+	if (!hwnd || !W32(IsWindow)(hwnd) || !W32(IsWindowVisible)(hwnd))
 		return false;
 
 	// Check if the window is minimized
-	if (IsIconic(hwnd))
+	if (W32(IsIconic)(hwnd))
 		return false;
 
 	// CRITICAL: Window must be the actual foreground window receiving input
-	HWND fgWindow = GetForegroundWindow();
+	HWND fgWindow = W32(GetForegroundWindow)();
 	if (fgWindow != hwnd)
 		return false;
 
 	// Get the window rect
 	RECT windowRect{};
-	if (!GetWindowRect(hwnd, &windowRect))
+	if (!W32(GetWindowRect)(hwnd, &windowRect))
 		return false;
 
 	// Check if window has any visible area
@@ -149,15 +315,15 @@ static bool IsWindowActuallyVisibleAndTopmost(HWND hwnd)
 
 	// Additional check: Get the GUI thread info to verify focus
 	GUITHREADINFO gti = { sizeof(GUITHREADINFO) };
-	DWORD windowThreadId = GetWindowThreadProcessId(hwnd, nullptr);
-	if (GetGUIThreadInfo(windowThreadId, &gti))
+	DWORD windowThreadId = W32(GetWindowThreadProcessId)(hwnd, nullptr);
+	if (W32(GetGUIThreadInfo)(windowThreadId, &gti))
 	{
 		// If there's an active window in the thread, it should match our window
 		if (gti.hwndActive && gti.hwndActive != hwnd)
 		{
 			// Check if active window belongs to same root
-			HWND activeRoot = GetAncestor(gti.hwndActive, GA_ROOT);
-			HWND ourRoot = GetAncestor(hwnd, GA_ROOT);
+			HWND activeRoot = W32(GetAncestor)(gti.hwndActive, GA_ROOT);
+			HWND ourRoot = W32(GetAncestor)(hwnd, GA_ROOT);
 			if (activeRoot != ourRoot)
 				return false;
 		}
@@ -169,11 +335,11 @@ static bool IsWindowActuallyVisibleAndTopmost(HWND hwnd)
 	int centerY = (windowRect.top + windowRect.bottom) / 2;
 	POINT centerPt = { centerX, centerY };
 
-	HWND windowAtCenter = WindowFromPoint(centerPt);
+	HWND windowAtCenter = W32(WindowFromPoint)(centerPt);
 	if (windowAtCenter)
 	{
-		HWND rootAtCenter = GetAncestor(windowAtCenter, GA_ROOT);
-		HWND rootMinecraft = GetAncestor(hwnd, GA_ROOT);
+		HWND rootAtCenter = W32(GetAncestor)(windowAtCenter, GA_ROOT);
+		HWND rootMinecraft = W32(GetAncestor)(hwnd, GA_ROOT);
 
 		// If center doesn't belong to Minecraft, we're definitely covered
 		if (rootAtCenter != rootMinecraft)
@@ -192,12 +358,12 @@ static bool IsWindowActuallyVisibleAndTopmost(HWND hwnd)
 		{
 			numChecks++;
 			POINT pt = { x, y };
-			HWND windowAtPoint = WindowFromPoint(pt);
+			HWND windowAtPoint = W32(WindowFromPoint)(pt);
 
 			if (windowAtPoint)
 			{
-				HWND rootAtPoint = GetAncestor(windowAtPoint, GA_ROOT);
-				HWND rootMinecraft = GetAncestor(hwnd, GA_ROOT);
+				HWND rootAtPoint = W32(GetAncestor)(windowAtPoint, GA_ROOT);
+				HWND rootMinecraft = W32(GetAncestor)(hwnd, GA_ROOT);
 
 				if (rootAtPoint == rootMinecraft)
 					passedChecks++;
@@ -205,16 +371,19 @@ static bool IsWindowActuallyVisibleAndTopmost(HWND hwnd)
 		}
 	}
 
-	// STRICTER: Require 90% of sampled points to belong to Minecraft (was 75%)
-	if (numChecks > 0 && passedChecks < (numChecks * 9 / 10))
+	if (visiblePercent && numChecks > 0)
+		*visiblePercent = (uint8_t)(passedChecks * 100 / numChecks);
+
+	// STRICTER: Require 90% (config: occlusion_threshold=) of sampled points to belong to Minecraft (was 75%)
+	if (numChecks > 0 && passedChecks < (numChecks * thresholdPercent / 100))
 		return false;
 
 	// Final check: Verify no other window has captured input
-	HWND captureWindow = GetCapture();
+	HWND captureWindow = W32(GetCapture)();
 	if (captureWindow && captureWindow != hwnd)
 	{
-		HWND captureRoot = GetAncestor(captureWindow, GA_ROOT);
-		HWND ourRoot = GetAncestor(hwnd, GA_ROOT);
+		HWND captureRoot = W32(GetAncestor)(captureWindow, GA_ROOT);
+		HWND ourRoot = W32(GetAncestor)(hwnd, GA_ROOT);
 		if (captureRoot != ourRoot)
 			return false;
 	}
@@ -222,9 +391,9 @@ static bool IsWindowActuallyVisibleAndTopmost(HWND hwnd)
 	return true;
 }
 
-static bool GetWindowClipRect(HWND hwnd, RECT& outClipRect)
+static bool GetWindowAreaRect(HWND hwnd, Config::ClipArea area, RECT& outClipRect)
 {
-	if (!IsWindow(hwnd) || !IsWindowVisible(hwnd)) return false;
+	if (!W32(IsWindow)(hwnd) || !W32(IsWindowVisible)(hwnd)) return false;
 
 	// Force a brief wait to ensure window has settled after focus change
 	// This helps ensure GetWindowRect returns accurate dimensions. This is incredibly scuffed and C style hacky but works.
@@ -233,15 +402,22 @@ static bool GetWindowClipRect(HWND hwnd, RECT& outClipRect)
 
 	// ALWAYS get fresh window rect - don't trust cached values
 	RECT wr{};
-	if (!GetWindowRect(hwnd, &wr)) return false;
+	if (!W32(GetWindowRect)(hwnd, &wr)) return false;
 
 	// Validate window rect is reasonable
 	if (wr.right <= wr.left || wr.bottom <= wr.top)
 		return false;
 
+	// Profile asked for the whole window (clip_area=window)
+	if (area == Config::ClipArea::Window)
+	{
+		outClipRect = wr;
+		return true;
+	}
+
 	// Get fresh client rect
 	RECT clientRect{};
-	if (!GetClientRect(hwnd, &clientRect))
+	if (!W32(GetClientRect)(hwnd, &clientRect))
 	{
 		// If client rect fails, use window rect as fallback
 		outClipRect = wr;
@@ -265,7 +441,7 @@ static bool GetWindowClipRect(HWND hwnd, RECT& outClipRect)
 	bool convertSuccess = false;
 	for (int attempt = 0; attempt < 3; attempt++)
 	{
-		if (ClientToScreen(hwnd, &topLeft) && ClientToScreen(hwnd, &bottomRight))
+		if (W32(ClientToScreen)(hwnd, &topLeft) && W32(ClientToScreen)(hwnd, &bottomRight))
 		{
 			// Validate the converted coordinates make sense
 			if (bottomRight.x > topLeft.x && bottomRight.y > topLeft.y)
@@ -278,7 +454,7 @@ static bool GetWindowClipRect(HWND hwnd, RECT& outClipRect)
 		// If conversion failed, wait briefly and try again, in testing this seems unreachable though (which is good).
 		if (attempt < 2)
 		{
-			Sleep(5);
+			W32(Sleep)(5);
 			// Reset points
 			topLeft = { 0, 0 };
 			bottomRight = { clientRect.right, clientRect.bottom };
@@ -318,312 +494,1586 @@ static bool GetWindowClipRect(HWND hwnd, RECT& outClipRect)
 	return true;
 }
 
-static void RecenterCursor(HWND hwnd)
+// The window's clip area confined to the virtual screen. ClipCursor confines it there anyway, so escapes and
+// recentering use the rect the cursor is really held to (a maximized window's rect overhangs its monitor by the
+// border width).
+static bool GetWindowClipRect(HWND hwnd, Config::ClipArea area, RECT& outClipRect)
 {
-	RECT wr{};
-	if (GetWindowRect(hwnd, &wr))
+	if (!GetWindowAreaRect(hwnd, area, outClipRect))
+		return false;
+
+	LONG screenLeft = W32(GetSystemMetrics)(SM_XVIRTUALSCREEN);
+	LONG screenTop = W32(GetSystemMetrics)(SM_YVIRTUALSCREEN);
+	LONG screenRight = screenLeft + W32(GetSystemMetrics)(SM_CXVIRTUALSCREEN);
+	LONG screenBottom = screenTop + W32(GetSystemMetrics)(SM_CYVIRTUALSCREEN);
+	if (screenRight <= screenLeft || screenBottom <= screenTop)
+		return true; // No metrics (shouldn't happen); leave the rect as it is
+
+	// Entirely off-screen comes out empty, which the tick treats as an invalid rect
+	outClipRect.left = (std::max)(outClipRect.left, screenLeft);
+	outClipRect.top = (std::max)(outClipRect.top, screenTop);
+	outClipRect.right = (std::min)(outClipRect.right, screenRight);
+	outClipRect.bottom = (std::min)(outClipRect.bottom, screenBottom);
+	return true;
+}
+
+static uint64_t QpcNow()
+{
+	LARGE_INTEGER now;
+	QueryPerformanceCounter(&now);
+	return (uint64_t)now.QuadPart;
+}
+
+static void ReportEscape(const EscapeDetector::Escape& escape)
+{
+	LARGE_INTEGER freq;
+	QueryPerformanceFrequency(&freq);
+	uint64_t durationUs = escape.durationQpc * 1000000 / freq.QuadPart;
+	if (escape.pendingClip)
+		LogLimited(LogCategory::ClipState, L"[!] Cursor escaped for %.1f ms at (%ld,%ld), %lu ms after Minecraft became active, before the clip was applied.",
+			durationUs / 1000.0, escape.at.x, escape.at.y, (unsigned long)escape.msSinceActivation);
+	else
+		LogLimited(LogCategory::ClipState, L"[!] Cursor escaped the clip for %.1f ms at (%ld,%ld), %lu ms after Minecraft became active (last tick: %S).",
+			durationUs / 1000.0, escape.at.x, escape.at.y, (unsigned long)escape.msSinceActivation, FlightRecorder::ActionName((uint8_t)escape.lastAction));
+	eventLog.CursorEscaped(durationUs, escape.at, (uint8_t)escape.lastAction, escape.msSinceActivation, escape.pendingClip);
+}
+
+// WinEvent callback for cursor and window moves while clipped (delivered through our message pump).
+// The cursor leaving the clip, or the target moving, makes the next tick verify the clip right away.
+static void CALLBACK LocationEventProc(HWINEVENTHOOK, DWORD, HWND hwnd, LONG idObject, LONG idChild, DWORD, DWORD)
+{
+	if (idObject == OBJID_CURSOR)
+	{
+		if (!escapeDetector.IsArmed()) return;
+		POINT pt;
+		if (!W32(GetCursorPos)(&pt)) return;
+		uint64_t now = QpcNow();
+		bool wasEscaping = escapeDetector.IsEscaping();
+		if (const EscapeDetector::Escape* escape = escapeDetector.OnCursor(pt, W32(GetForegroundWindow)(), now))
+			ReportEscape(*escape);
+		else if (!wasEscaping && escapeDetector.IsEscaping())
+			clipWatch.Notify(ClipWatch::Trigger::CursorOutside, now);
+	}
+	else if (idObject == OBJID_WINDOW && idChild == CHILDID_SELF && hwnd && hwnd == watchedTarget)
+	{
+		clipWatch.Notify(ClipWatch::Trigger::TargetMoved, QpcNow());
+	}
+}
+
+static void InstallLocationHook()
+{
+	if (locationHook)
+		return;
+	locationHook = SetWinEventHook(EVENT_OBJECT_LOCATIONCHANGE, EVENT_OBJECT_LOCATIONCHANGE, nullptr,
+		LocationEventProc, 0, 0, WINEVENT_OUTOFCONTEXT | WINEVENT_SKIPOWNPROCESS);
+	if (!locationHook)
+		LOG_WARN(L"[!] Failed to install location event hook (error %lu). Escape detection and event-driven clip checks are off.", GetLastError());
+}
+
+// Foreground changes are when games and overlays most often call ClipCursor themselves. When the target comes
+// to the front, escapes are watched for from here on, not only once the next tick has clipped it.
+static void CALLBACK ForegroundEventProc(HWINEVENTHOOK, DWORD, HWND hwnd, LONG, LONG, DWORD, DWORD)
+{
+	uint64_t now = QpcNow();
+	clipWatch.Notify(ClipWatch::Trigger::Foreground, now);
+
+	const Config::Profile* profile = clippingEnabled.load() ? GetTargetProfile(hwnd) : nullptr;
+	if (!profile)
+		return;
+	escapeDetector.TargetActivated(now);
+
+	RECT expected;
+	if (CurrentConfig().escapeDetector && GetWindowClipRect(hwnd, profile->clipArea, expected) &&
+		expected.right > expected.left && expected.bottom > expected.top)
+	{
+		escapeDetector.ArmPendingClip(expected, hwnd, now);
+		InstallLocationHook();
+	}
+}
+
+// Tick: while the target is clipped, arm the escape detector and watch cursor and window locations; stop
+// otherwise, except that a pending clip armed by the foreground event is kept while the target stays in
+// front. The location hook follows, so it costs nothing while the game isn't in front.
+static void UpdateClipWatch(bool clipped, bool targetFront, const RECT& clip, HWND target, FlightRecorder::Action action, uint64_t qpc)
+{
+	if (clipped)
+	{
+		watchedTarget = target;
+		if (CurrentConfig().escapeDetector)
+			escapeDetector.Arm(clip, target, action, qpc);
+		else if (const EscapeDetector::Escape* escape = escapeDetector.Disarm(qpc))
+			ReportEscape(*escape);
+		InstallLocationHook();
+		return;
+	}
+
+	watchedTarget = nullptr;
+	clipWatch.Clear();
+	if (targetFront && escapeDetector.IsPendingClip() && !escapeDetector.PendingExpired(qpc))
+		return;
+	if (const EscapeDetector::Escape* escape = escapeDetector.Disarm(qpc))
+		ReportEscape(*escape);
+	if (locationHook)
+	{
+		UnhookWinEvent(locationHook);
+		locationHook = nullptr;
+	}
+}
+
+// ClipCursor, then GetClipCursor once: the system may confine or scale what we asked for, and verification
+// has to compare against what it really set
+static void ApplyClip(const RECT& clip, ClipLogic::State& clipState)
+{
+	W32(ClipCursor)(&clip);
+	RECT effective;
+	if (W32(GetClipCursor)(&effective))
+	{
+		ClipLogic::ClipReadBack(clipState, effective);
+		trace.ClipReadBack(effective);
+	}
+}
+
+// The tick found our clip replaced. Re-asserts it unless that is happening too often (the next tick tries again).
+static void ReassertClip(const RECT& clip, uint64_t qpc, ClipLogic::State& clipState)
+{
+	ClipWatch::ResetInfo info;
+	if (clipWatch.Reset(qpc, info))
+	{
+		LARGE_INTEGER freq;
+		QueryPerformanceFrequency(&freq);
+		uint64_t sinceUs = info.sinceTriggerQpc * 1000000 / (uint64_t)freq.QuadPart;
+		if (info.trigger == ClipWatch::Trigger::Poll)
+			LogLimited(LogCategory::ClipState, L"[!] Clip was reset by another program (found by the periodic check)  re-asserting.");
+		else
+			LogLimited(LogCategory::ClipState, L"[!] Clip was reset by another program (%.1f ms after %S)  re-asserting.",
+				sinceUs / 1000.0, ClipWatch::TriggerName((uint8_t)info.trigger));
+		eventLog.ClipReset((uint8_t)info.trigger, sinceUs);
+	}
+
+	if (clipWatch.AllowReassert(qpc))
+	{
+		ApplyClip(clip, clipState);
+		clipWatch.Reasserted(qpc);
+	}
+}
+
+static void RecenterCursor(const ClipTargetState& state)
+{
+	// Centre was computed from the client clip rect by the poll loop, no window queries needed here
+	W32(SetCursorPos)(state.center.x, state.center.y);
+}
+
+static POINT RectCenter(const RECT& rc)
+{
+	return { (rc.left + rc.right) / 2, (rc.top + rc.bottom) / 2 };
+}
+
+// Path-returning Win32 calls give 0 on failure and the buffer size or more when the result didn't fit
+static bool FitsPath(DWORD length)
+{
+	return length > 0 && length < MAX_PATH;
+}
+
+// Output files named with a relative path go next to the config file, never into the working directory
+// (System32 under autostart). Absolute paths are kept as they are.
+static void ResolveOutputPaths(Config::Settings& settings)
+{
+	size_t slash = configPath.find_last_of(L"\\/");
+	if (slash == std::wstring::npos)
+		return; // Config itself came from the working directory
+	std::wstring directory = configPath.substr(0, slash + 1);
+
+	std::wstring* paths[] = { &settings.logFile, &settings.eventLog, &settings.trace, &settings.flightRecorderPath,
+		&settings.zoneTracePath, &settings.metricsFile };
+	for (std::wstring* path : paths)
 	{
-		int centerX = (wr.left + wr.right) / 2;
-		int centerY = (wr.top + wr.bottom) / 2;
-		SetCursorPos(centerX, centerY);
+		if (path->empty() || !PathIsRelativeW(path->c_str()))
+			continue;
+		std::wstring combined = directory + *path;
+		wchar_t buffer[MAX_PATH];
+		*path = FitsPath(GetFullPathNameW(combined.c_str(), MAX_PATH, buffer, nullptr)) ? buffer : combined;
 	}
 }
 
-static WORD LoadRecenterKeyFromConfig()
+// Config::Parse plus the path resolution every loaded snapshot gets
+static void ParseConfig(std::string_view text, Config::Snapshot& snapshot)
 {
-	// Try to open config file
-	std::ifstream configFile(CONFIG_FILE);
+	Config::Parse(text, snapshot.settings, snapshot.report, commandLineOverrides);
+	ResolveOutputPaths(snapshot.settings);
+}
 
+// Read and parse the config file. At startup a missing file is created with the default key; on reload
+// (createIfMissing false, any thread, so no logging) a missing or unreadable file returns nullptr.
+static std::unique_ptr<Config::Snapshot> LoadConfigSnapshot(bool createIfMissing)
+{
+	std::unique_ptr<Config::Snapshot> snapshot = std::make_unique<Config::Snapshot>();
+	std::ifstream configFile(configPath.c_str(), std::ios::binary);
 	if (!configFile.is_open())
 	{
+		if (!createIfMissing)
+			return nullptr;
+
 		// File doesn't exist, create it with default value
-		Log(L"[*] Config file not found. Creating %s with default key 'E'.", CONFIG_FILE);
-		std::ofstream outFile(CONFIG_FILE);
+		Log(L"[*] Config file not found. Creating %s with default key 'E'.", configPath.c_str());
+		std::ofstream outFile(configPath.c_str());
 		if (outFile.is_open())
 		{
-			outFile << "E";
+			outFile << "recenter_key=E\n";
 			outFile.close();
 		}
-		return 'E';
+		ParseConfig({}, *snapshot);
+		return snapshot;
 	}
 
-	// Read the file content
-	std::string line;
-	std::getline(configFile, line);
-	configFile.close();
+	// One read of the whole file; the parser only takes views into it
+	std::string text((std::istreambuf_iterator<char>(configFile)), std::istreambuf_iterator<char>());
+	ParseConfig(text, *snapshot);
+	return snapshot;
+}
 
-	// Trim whitespace
-	while (!line.empty() && std::isspace(static_cast<unsigned char>(line.back())))
-		line.pop_back();
-	while (!line.empty() && std::isspace(static_cast<unsigned char>(line.front())))
-		line.erase(0, 1);
+// Called once the log level and log file are in place, so these messages land in both
+static void ReportConfig(const Config::Snapshot& snapshot)
+{
+	const Config::Settings& config = snapshot.settings;
+	const Config::ParseReport& report = snapshot.report;
+	for (size_t i = 0; i < report.issueCount; i++)
+	{
+		if (report.issues[i].line)
+			LOG_WARN(L"[!] %s line %u: %S.", configPath.c_str(), report.issues[i].line, report.issues[i].text);
+		else
+			LOG_WARN(L"[!] Command line: %S.", report.issues[i].text);
+	}
+	if ((int)config.logLevel > LOG_COMPILE_LEVEL)
+		LOG_WARN(L"[!] log_level '%S' is above what this build includes; using '%S'.", LogConfig::LevelName(config.logLevel), LogConfig::LevelName((LogLevel)LOG_COMPILE_LEVEL));
+
+	VirtualKeyParser::ChordName chordName = VirtualKeyParser::GetChordName(config.defaults.recenterChord);
+	Log(L"[*] Loaded recenter key from config: '%S' (VK: 0x%02X)", chordName.c_str(), config.defaults.recenterChord.keys[config.defaults.recenterChord.count - 1]);
+	Log(L"[*] Recenter interval %lu ms, poll every %lu ms, occlusion threshold %u%%.",
+		config.recenterIntervalMs, config.defaults.pollMs, config.defaults.occlusionThresholdPercent);
+	for (const Config::Profile& profile : config.profiles)
+	{
+		chordName = VirtualKeyParser::GetChordName(profile.recenterChord);
+		Log(L"[*] Profile %s: recenter '%S', poll every %lu ms, occlusion threshold %u%%, %s clip.", profile.exe.c_str(), chordName.c_str(),
+			profile.pollMs, profile.occlusionThresholdPercent, profile.clipArea == Config::ClipArea::Window ? L"window" : L"client area");
+	}
+}
+
+// Point the recenter binding at the chord of the target in front. Cheap when nothing changed, so the
+// loop calls it every tick; the bindings are only read by the hook, which runs on this same thread.
+static void BindRecenterChord(const VirtualKeyParser::KeyChord& chord)
+{
+	if (keyBindings.Size() && Config::SameChord(chord, boundRecenterChord))
+		return;
+
+	keyBindings.Clear();
+	keyBindings.Add(chord, KeyBindings::Action::Recenter);
+	keyBindings.Add({ { VK_ESCAPE }, 1 }, KeyBindings::Action::Recenter);
+	boundRecenterChord = chord;
+	std::fill(std::begin(recenteredBefore), std::end(recenteredBefore), false);
+}
 
-	// Validate: should not be empty
-	if (line.empty())
+// "input_backend=hook" (default, WH_KEYBOARD_LL) or "input_backend=rawinput" (Raw Input, never delays the game)
+// "input_backend=none" (--no-hook) returns nullptr: no keyboard input at all
+static std::unique_ptr<InputSource> CreateInputSourceFromConfig()
+{
+	switch (CurrentConfig().inputBackend)
 	{
-		Log(L"[!] Config file is empty. Defaulting to 'E'.");
-		return 'E';
+		case Config::InputBackend::RawInput: return std::make_unique<RawInputSource>();
+		case Config::InputBackend::None: return nullptr;
+		default: return std::make_unique<LowLevelHookInput>();
 	}
+}
 
-	// Use the VirtualKeyParser to parse the key name
-	WORD parsedKey = VirtualKeyParser::ParseKeyName(line);
+// Recenter on a matched key-down, unless it is an auto-repeat or too soon after the same binding's last one.
+// eventTime is the hook's own timestamp, so no extra Win32 call is needed for debouncing.
+static Trace::KeyOutcome HandleRecenterKey(DWORD eventTime, bool isRepeat, size_t binding)
+{
+	PROFILE_ZONE("recenter key");
+	if (isRepeat)
+	{
+		recenterStats.suppressedRepeat.fetch_add(1, std::memory_order_relaxed);
+		return Trace::KeyOutcome::Repeat;
+	}
 
-	if (parsedKey != 0)
+	if (binding >= RECENTER_BINDINGS)
+		binding = 0;
+	if (recenteredBefore[binding] && eventTime - lastRecenterTime[binding] < CurrentConfig().recenterIntervalMs)
 	{
-		std::string keyName = VirtualKeyParser::GetKeyNameFromVK(parsedKey);
-		Log(L"[*] Loaded recenter key from config: '%S' (VK: 0x%02X)", keyName.c_str(), parsedKey);
-		return parsedKey;
+		LOG_DEBUG(L"[.] Recenter debounced (%lu ms after the last one).", eventTime - lastRecenterTime[binding]);
+		recenterStats.suppressedInterval.fetch_add(1, std::memory_order_relaxed);
+		return Trace::KeyOutcome::Debounced;
+	}
+
+	// The poll loop already decided whether Minecraft is focused AND actually visible
+	ClipTargetState state = clipSnapshot.Read();
+	if (!state.eligible)
+	{
+		recenterStats.ineligible.fetch_add(1, std::memory_order_relaxed);
+		return Trace::KeyOutcome::Ineligible;
+	}
+
+	RecenterCursor(state);
+	eventLog.Recenter(state.target, state.center);
+	lastRecenterTime[binding] = eventTime;
+	recenteredBefore[binding] = true;
+	recenterStats.executed.fetch_add(1, std::memory_order_relaxed);
+	return Trace::KeyOutcome::Executed;
+}
+
+// Key events from whichever input backend is active (low-level hook or raw input). Never consumes the key.
+static void OnKeyEvent(const KeyEvent& ev)
+{
+	// Holding a key produces a stream of key-downs; the tracker tells us it was already down
+	bool wasDown = keyState.OnKeyEvent(ev.vk, ev.isDown);
+
+	// Only trigger on key down
+	if (ev.isDown)
+	{
+		// Check if it completes the recenter chord OR escape key
+		size_t binding = 0;
+		if (keyBindings.Match(keyState.State(), ev.vk, &binding) == KeyBindings::Action::Recenter)
+		{
+			trace.RecenterKey(ev.vk, ev.time, HandleRecenterKey(ev.time, wasDown, binding));
+		}
+	}
+}
+
+// Fills in one flight recorder entry over the course of a poll tick and commits it on every exit path
+struct FlightTick
+{
+	FlightRecorder::TickRecord rec{};
+
+	FlightTick()
+	{
+		LARGE_INTEGER now;
+		QueryPerformanceCounter(&now);
+		rec.qpc = (uint64_t)now.QuadPart;
+		rec.visiblePercent = FlightRecorder::VISIBLE_UNKNOWN;
+		Win32Calls::BeginTick();
+	}
+
+	~FlightTick()
+	{
+		LARGE_INTEGER now;
+		QueryPerformanceCounter(&now);
+		rec.durationQpc = (uint32_t)((uint64_t)now.QuadPart - rec.qpc);
+		flightRecorder.Record(rec);
+		Win32Calls::EndTick(rec.action);
+		LoopCounters::Bump(loopCounters.ticks[(size_t)rec.action]);
+		statsPage.Tick(rec.action, rec.durationQpc);
+		statsPage.Publish();
+	}
+};
+
+// ClipLogic::Tick's questions answered from Win32. Remembers the target's profile for the rest of the tick.
+struct LiveWorld
+{
+	const Config::Profile* profile = nullptr;
+
+	bool IsMoving() { PROFILE_ZONE("snapshot: moving"); return IsAnyWindowBeingMovedOrResized(); }
+	bool Enabled() { return clippingEnabled.load(); }
+	HWND Foreground() { PROFILE_ZONE("snapshot: foreground"); return W32(GetForegroundWindow)(); }
+
+	// Resolved once per window and cached, so this is a map lookup on every tick after the first
+	bool IsTarget(HWND hwnd)
+	{
+		PROFILE_ZONE("classification");
+		profile = GetTargetProfile(hwnd);
+		return profile != nullptr;
+	}
+
+	bool IsVisible(HWND hwnd, uint8_t* visiblePercent)
+	{
+		PROFILE_ZONE("occlusion");
+		return IsWindowActuallyVisibleAndTopmost(hwnd, profile->occlusionThresholdPercent, visiblePercent);
+	}
+
+	bool ClipRect(HWND hwnd, RECT& rc) { PROFILE_ZONE("clip rect"); return GetWindowClipRect(hwnd, profile->clipArea, rc); }
+	bool VerifyDue() { return clipWatch.VerifyDue(CurrentConfig().clipVerifyMs, QpcNow()); }
+	bool CurrentClip(RECT& rc) { PROFILE_ZONE("current clip"); return W32(GetClipCursor)(&rc) != 0; }
+};
+
+// Builds with PROFILE_ZONES=1 only
+static void ExportZones()
+{
+#if PROFILE_ZONES
+	const Config::Settings& config = CurrentConfig();
+	int64_t zones = ZoneProfiler::Export(config.zoneTracePath.c_str());
+	if (zones >= 0)
+		Log(L"[*] Profile zones: %lld written to %s (open in ui.perfetto.dev or chrome://tracing).", zones, config.zoneTracePath.c_str());
+	else
+		LOG_WARN(L"[!] Failed to write profile zones to %s.", config.zoneTracePath.c_str());
+#endif
+}
+
+static void DumpFlightRecorder()
+{
+	const Config::Settings& config = CurrentConfig();
+	if (flightRecorder.Dump(config.flightRecorderPath.c_str()))
+		Log(L"[*] Flight recorder: last %llu ticks written to %s (decode with --decode-flight).",
+			flightRecorder.Count() < 4096 ? flightRecorder.Count() : 4096ULL, config.flightRecorderPath.c_str());
+	else
+		LOG_ERROR(L"[!] Failed to write flight recorder dump %s (error %lu).", config.flightRecorderPath.c_str(), GetLastError());
+}
+
+// Safety hotkey and control pipe (posted to the main thread). Releases at once rather than on the next tick.
+static void SetClippingEnabled(bool enabled, ClipLogic::State& clipState)
+{
+	if (enabled == clippingEnabled.load())
+		return;
+
+	clippingEnabled.store(enabled);
+	if (!enabled)
+	{
+		W32(ClipCursor)(nullptr);
+		UpdateClipWatch(false, false, RECT{}, nullptr, FlightRecorder::Action::None, QpcNow());
+		bool wasClipped = ClipLogic::Disable(clipState);
+		if (wasClipped)
+		{
+			eventLog.ClipReleased(EventLog::ReleaseReason::Disabled);
+			LoopCounters::Bump(loopCounters.releases[(size_t)EventLog::ReleaseReason::Disabled]);
+		}
+		trace.Disabled(wasClipped);
+		Log(L"[=] Clipping DISABLED  cursor released.");
+		eventLog.ClippingToggled(false);
 	}
 	else
 	{
-		Log(L"[!] Invalid key name in config ('%S'). Defaulting to 'E'.", line.c_str());
-		Log(L"[!] Valid examples: E, TAB, VK_TAB, SPACE, F1, CTRL, etc.");
-		return 'E';
+		Log(L"[=] Clipping ENABLED  will clip when Minecraft is focused.");
+		eventLog.ClippingToggled(true);
 	}
 }
 
-// Low-level keyboard hook to detect recenter key without consuming it
-static LRESULT CALLBACK LowLevelKeyboardProc(int nCode, WPARAM wParam, LPARAM lParam)
+// Control pipe requests, on the pipe's thread. Reads only state that is safe from any thread; clipping
+// changes are posted to the main thread and a reload goes through the config store like a file change.
+static ControlPipe::Status HandleControlRequest(ControlPipe::Request request, uint8_t* reply, uint32_t& replySize)
 {
-	if (nCode == HC_ACTION)
+	bool enabled = clippingEnabled.load();
+	switch (request)
 	{
-		KBDLLHOOKSTRUCT* kb = (KBDLLHOOKSTRUCT*)lParam;
+		case ControlPipe::Request::Toggle:
+		case ControlPipe::Request::Enable:
+		case ControlPipe::Request::Disable:
+		{
+			WPARAM change = request == ControlPipe::Request::Toggle ? 2 : request == ControlPipe::Request::Enable ? 1 : 0;
+			if (!PostThreadMessageW(mainThreadId, WM_CONTROL_CLIPPING, change, 0))
+				return ControlPipe::Status::Failed;
+			enabled = change == 2 ? !enabled : change == 1;
+			break;
+		}
 
-		// Only trigger on key down
-		if (wParam == WM_KEYDOWN || wParam == WM_SYSKEYDOWN)
+		case ControlPipe::Request::Reload:
 		{
-			HWND fg = GetForegroundWindow();
+			std::unique_ptr<Config::Snapshot> snapshot = LoadConfigSnapshot(false);
+			if (!snapshot)
+				return ControlPipe::Status::Failed;
+			LARGE_INTEGER now;
+			QueryPerformanceCounter(&now);
+			snapshot->detectedQpc = (uint64_t)now.QuadPart;
+			configStore.Offer(std::move(snapshot));
+			replySize = 0;
+			return ControlPipe::Status::Ok;
+		}
 
-			// Check if Minecraft is focused AND actually visible
-			if (fg && IsMinecraftWindow(fg) && IsWindowActuallyVisibleAndTopmost(fg))
-			{
-				// Check if it's the recenter key OR escape key
-				if (kb->vkCode == recenterKey || kb->vkCode == VK_ESCAPE)
-				{
-					RecenterCursor(fg);
-				}
-			}
+		case ControlPipe::Request::Stats:
+		{
+			ControlPipe::StatsReply stats{};
+			stats.ticks = flightRecorder.Count();
+			stats.recentersExecuted = recenterStats.executed.load(std::memory_order_relaxed);
+			stats.recentersRepeat = recenterStats.suppressedRepeat.load(std::memory_order_relaxed);
+			stats.recentersDebounced = recenterStats.suppressedInterval.load(std::memory_order_relaxed);
+			stats.recentersIneligible = recenterStats.ineligible.load(std::memory_order_relaxed);
+			stats.keyEvents = inputSource ? inputSource->Stats().events.load(std::memory_order_relaxed) : 0;
+			memcpy(reply, &stats, sizeof(stats));
+			replySize = sizeof(stats);
+			return ControlPipe::Status::Ok;
 		}
+
+		default:
+			break;
 	}
 
-	// IMPORTANT: Return CallNextHookEx to NOT consume the key
-	return CallNextHookEx(keyboardHook, nCode, wParam, lParam);
+	ClipTargetState state = clipSnapshot.Read();
+	ControlPipe::StatusReply status{};
+	status.target = (uint64_t)(uintptr_t)state.target;
+	status.centerX = state.center.x;
+	status.centerY = state.center.y;
+	status.enabled = enabled ? 1 : 0;
+	status.eligible = state.eligible ? 1 : 0;
+	memcpy(reply, &status, sizeof(status));
+	replySize = sizeof(status);
+	return ControlPipe::Status::Ok;
 }
 
+// Metrics file contents, on the exporter thread. Only atomics are read here.
+static void CollectMetrics(MetricsExport::Text& out)
+{
+	char labels[64];
+	out.Describe("swimmousecursor_ticks_total", "counter", "Poll ticks by outcome.");
+	for (size_t action = 0; action < (size_t)FlightRecorder::Action::Count; action++)
+	{
+		snprintf(labels, sizeof(labels), "action=\"%s\"", FlightRecorder::ActionName((uint8_t)action));
+		out.Sample("swimmousecursor_ticks_total", labels, loopCounters.ticks[action].load(std::memory_order_relaxed));
+	}
+	out.Counter("swimmousecursor_clip_applies_total", "Clip rects applied (new or changed, not re-asserted).",
+		loopCounters.ticks[(size_t)FlightRecorder::Action::Applied].load(std::memory_order_relaxed));
+
+	out.Describe("swimmousecursor_clip_releases_total", "counter", "Clips dropped, by reason.");
+	for (size_t reason = 0; reason < (size_t)EventLog::ReleaseReason::Count; reason++)
+	{
+		snprintf(labels, sizeof(labels), "reason=\"%s\"", EventLog::ReleaseReasonName((uint8_t)reason));
+		out.Sample("swimmousecursor_clip_releases_total", labels, loopCounters.releases[reason].load(std::memory_order_relaxed));
+	}
+
+	out.Describe("swimmousecursor_recenters_total", "counter", "Recenter key presses by outcome.");
+	out.Sample("swimmousecursor_recenters_total", "outcome=\"executed\"", recenterStats.executed.load(std::memory_order_relaxed));
+	out.Sample("swimmousecursor_recenters_total", "outcome=\"repeat\"", recenterStats.suppressedRepeat.load(std::memory_order_relaxed));
+	out.Sample("swimmousecursor_recenters_total", "outcome=\"debounced\"", recenterStats.suppressedInterval.load(std::memory_order_relaxed));
+	out.Sample("swimmousecursor_recenters_total", "outcome=\"ineligible\"", recenterStats.ineligible.load(std::memory_order_relaxed));
+
+	if (inputSource)
+	{
+		const InputDeliveryStats& input = inputSource->Stats();
+		double bounds[InputDeliveryStats::LATENCY_BUCKETS];
+		uint64_t counts[InputDeliveryStats::LATENCY_BUCKETS + 1];
+		for (size_t i = 0; i < InputDeliveryStats::LATENCY_BUCKETS; i++)
+			bounds[i] = InputDeliveryStats::LATENCY_BOUNDS_MS[i] / 1000.0;
+		for (size_t i = 0; i <= InputDeliveryStats::LATENCY_BUCKETS; i++)
+			counts[i] = input.latencyBuckets[i].load(std::memory_order_relaxed);
+		out.Histogram("swimmousecursor_key_delivery_seconds", "Keyboard event delivery latency (system timestamp to hook).",
+			bounds, counts, InputDeliveryStats::LATENCY_BUCKETS, input.totalLatencyMs.load(std::memory_order_relaxed) / 1000.0);
+	}
+
+	LARGE_INTEGER freq;
+	QueryPerformanceFrequency(&freq);
+	const Win32Calls::Totals& calls = Win32Calls::GetTotals();
+	out.Describe("swimmousecursor_win32_calls_total", "counter", "Win32 calls made by the main thread, by API.");
+	for (size_t api = 0; api < Win32Calls::API_COUNT; api++)
+	{
+		snprintf(labels, sizeof(labels), "api=\"%s\"", Win32Calls::ApiName(api));
+		out.Sample("swimmousecursor_win32_calls_total", labels, calls.calls[api].load(std::memory_order_relaxed));
+	}
+	out.Describe("swimmousecursor_win32_call_seconds_total", "counter", "Time spent in Win32 calls by the main thread, by API.");
+	for (size_t api = 0; api < Win32Calls::API_COUNT; api++)
+	{
+		snprintf(labels, sizeof(labels), "api=\"%s\"", Win32Calls::ApiName(api));
+		out.Sample("swimmousecursor_win32_call_seconds_total", labels, (double)calls.qpc[api].load(std::memory_order_relaxed) / freq.QuadPart);
+	}
+
+	out.Describe("swimmousecursor_log_lines_dropped_total", "counter", "Console/log lines suppressed by rate limiting.");
+	out.Sample("swimmousecursor_log_lines_dropped_total", "category=\"clip_state\"", LogLimiter::SuppressedLines(LogCategory::ClipState));
+	out.Sample("swimmousecursor_log_lines_dropped_total", "category=\"move_resize\"", LogLimiter::SuppressedLines(LogCategory::MoveResize));
+
+	const EscapeDetector::Stats& escapes = escapeDetector.GetStats();
+	double escapeBounds[EscapeDetector::DURATION_BUCKETS];
+	uint64_t escapeCounts[EscapeDetector::DURATION_BUCKETS + 1];
+	for (size_t i = 0; i < EscapeDetector::DURATION_BUCKETS; i++)
+		escapeBounds[i] = EscapeDetector::DURATION_BOUNDS_MS[i] / 1000.0;
+	for (size_t i = 0; i <= EscapeDetector::DURATION_BUCKETS; i++)
+		escapeCounts[i] = escapes.durationBuckets[i].load(std::memory_order_relaxed);
+	out.Histogram("swimmousecursor_cursor_escape_seconds", "Cursor escapes: time spent outside the clip rect while clipped.",
+		escapeBounds, escapeCounts, EscapeDetector::DURATION_BUCKETS, (double)escapes.escapedQpc.load(std::memory_order_relaxed) / freq.QuadPart);
+	double clippedSeconds = (double)escapes.armedQpc.load(std::memory_order_relaxed) / freq.QuadPart;
+	out.Describe("swimmousecursor_clipped_seconds_total", "counter", "Time the target was clipped with escape detection armed.");
+	out.Sample("swimmousecursor_clipped_seconds_total", "", clippedSeconds);
+	out.Counter("swimmousecursor_cursor_escapes_pending_clip_total", "Escapes after the target came to the front, before the clip was applied.",
+		escapes.pendingClipEscapes.load(std::memory_order_relaxed));
+	out.Describe("swimmousecursor_cursor_escapes_per_hour", "gauge", "Escapes per hour of clipped time since start.");
+	out.Sample("swimmousecursor_cursor_escapes_per_hour", "", clippedSeconds > 0 ? escapes.escapes.load(std::memory_order_relaxed) * 3600.0 / clippedSeconds : 0.0);
+
+	const ClipWatch::Stats& watch = clipWatch.GetStats();
+	out.Describe("swimmousecursor_clip_resets_total", "counter", "Our clip found reset by another program, by the event that preceded it.");
+	for (size_t trigger = 0; trigger < (size_t)ClipWatch::Trigger::Count; trigger++)
+	{
+		snprintf(labels, sizeof(labels), "trigger=\"%s\"", ClipWatch::TriggerName((uint8_t)trigger));
+		out.Sample("swimmousecursor_clip_resets_total", labels, watch.resetsByTrigger[trigger].load(std::memory_order_relaxed));
+	}
+	out.Describe("swimmousecursor_clip_reset_unclipped_seconds_total", "counter", "Upper bound on the time resets left the cursor unclipped.");
+	out.Sample("swimmousecursor_clip_reset_unclipped_seconds_total", "", (double)watch.unclippedQpc.load(std::memory_order_relaxed) / freq.QuadPart);
+	out.Counter("swimmousecursor_clip_reasserts_deferred_total", "Re-assertions held back by the rate limit.", watch.reassertsDeferred.load(std::memory_order_relaxed));
+	out.Counter("swimmousecursor_clip_verifications_total", "Checks of the cursor's clip against ours.", watch.verifications.load(std::memory_order_relaxed));
+
+	out.Describe("swimmousecursor_clipping_enabled", "gauge", "1 while clipping is switched on.");
+	out.Sample("swimmousecursor_clipping_enabled", "", (uint64_t)(clippingEnabled.load() ? 1 : 0));
+}
+
+// Last chance on a crash: free the cursor and save what the loop saw. No allocation, no logging.
+static LONG WINAPI CrashFilter(EXCEPTION_POINTERS*)
+{
+	ClipCursor(nullptr);
+	flightRecorder.Dump(CurrentConfig().flightRecorderPath.c_str());
+	return EXCEPTION_CONTINUE_SEARCH;
+}
+
+// Windows ends the process about 5 seconds after a close, logoff or shutdown event, or as soon as the handler returns
+constexpr DWORD EXIT_CLEANUP_WAIT_MS = 4500;
+
 static BOOL WINAPI ConsoleCtrlHandler(DWORD ctrlType)
 {
 	switch (ctrlType)
 	{
 		case CTRL_C_EVENT:
-		case CTRL_CLOSE_EVENT:
 		case CTRL_BREAK_EVENT:
+		running.store(false);
+		ClipCursor(nullptr); // always release on exit
+		return TRUE;
+
+		case CTRL_CLOSE_EVENT:
 		case CTRL_LOGOFF_EVENT:
 		case CTRL_SHUTDOWN_EVENT:
 		running.store(false);
-		ClipCursor(nullptr); // always release on exit
+		ClipCursor(nullptr);
+		// Returning kills the process, so hold on until the loop has run its exit path (flight recorder dump,
+		// event log, trace and metrics flushes, log file close)
+		if (exitCleanupDone)
+			WaitForSingleObject(exitCleanupDone, EXIT_CLEANUP_WAIT_MS);
 		return TRUE;
 	}
 	return FALSE;
 }
 
+// Offline decoder: SwimMouseCursor.exe --decode-events <file> [--csv]
+static int DecodeEventLogCommand(int argc, wchar_t** argv)
+{
+	bool csv = argc >= 4 && _wcsicmp(argv[3], L"--csv") == 0;
+	if (!EventLog::Decode(argv[2], csv, stdout))
+	{
+		fwprintf(stderr, L"Could not decode event log '%s'.\n", argv[2]);
+		return 1;
+	}
+	return 0;
+}
+
+// Offline decoder: SwimMouseCursor.exe --decode-flight <file>
+static int DecodeFlightRecorderCommand(wchar_t** argv)
+{
+	if (!FlightRecorder::Decode(argv[2], stdout))
+	{
+		fwprintf(stderr, L"Could not decode flight recorder dump '%s'.\n", argv[2]);
+		return 1;
+	}
+	return 0;
+}
+
+// Offline replay: SwimMouseCursor.exe --replay-trace <file> [--realtime]
+// Exit code 1 if the file is bad or any replayed decision differs from the recorded one.
+static int ReplayTraceCommand(int argc, wchar_t** argv)
+{
+	bool realtime = argc >= 4 && _wcsicmp(argv[3], L"--realtime") == 0;
+	Trace::ReplayResult result;
+	if (!Trace::Replay(argv[2], realtime, stdout, result))
+	{
+		fwprintf(stderr, L"Could not replay trace '%s'.\n", argv[2]);
+		return 1;
+	}
+
+	printf("%llu ticks and %llu recenter keys over %.1f s replayed in %.3f s: %llu divergences.\n",
+		(unsigned long long)result.ticks, (unsigned long long)result.keys, result.recordedSeconds, result.replaySeconds,
+		(unsigned long long)result.divergences);
+	return result.divergences ? 1 : 0;
+}
+
+// Control client: SwimMouseCursor.exe --control <status|toggle|enable|disable|reload|stats> [count]
+// With a count, sends the request that many times over one connection and prints round-trip latencies.
+static int ControlCommand(int argc, wchar_t** argv)
+{
+	uint8_t request = ControlPipe::ParseRequest(argv[2]);
+	int count = argc >= 4 ? (int)wcstol(argv[3], nullptr, 10) : 1;
+	if (!request || count < 1)
+	{
+		fwprintf(stderr, L"Unknown control request '%s'.\n", argv[2]);
+		return 2;
+	}
+
+	HANDLE pipe = ControlPipe::Connect(2000);
+	if (pipe == INVALID_HANDLE_VALUE)
+	{
+		fwprintf(stderr, L"Could not connect to %s (error %lu). Is SwimMouseCursor running?\n", ControlPipe::PIPE_NAME, GetLastError());
+		return 1;
+	}
+
+	LARGE_INTEGER freq;
+	QueryPerformanceFrequency(&freq);
+	std::vector<double> latencyUs;
+	latencyUs.reserve(count);
+	uint8_t reply[ControlPipe::MAX_PAYLOAD];
+	uint32_t replySize = 0;
+	ControlPipe::Status status = ControlPipe::Status::Failed;
+	for (int i = 0; i < count; i++)
+	{
+		LARGE_INTEGER start, end;
+		QueryPerformanceCounter(&start);
+		if (!ControlPipe::Transact(pipe, (ControlPipe::Request)request, status, reply, replySize))
+		{
+			fwprintf(stderr, L"Control request failed (error %lu).\n", GetLastError());
+			CloseHandle(pipe);
+			return 1;
+		}
+		QueryPerformanceCounter(&end);
+		latencyUs.push_back((end.QuadPart - start.QuadPart) * 1000000.0 / freq.QuadPart);
+	}
+	CloseHandle(pipe);
+
+	if (status != ControlPipe::Status::Ok)
+	{
+		fwprintf(stderr, L"Request '%S' failed (status %u).\n", ControlPipe::RequestName(request), (unsigned)status);
+		return 1;
+	}
+
+	if (replySize == sizeof(ControlPipe::StatusReply))
+	{
+		ControlPipe::StatusReply s;
+		memcpy(&s, reply, sizeof(s));
+		printf("enabled=%u eligible=%u target=0x%llx center=%d,%d\n", s.enabled, s.eligible, (unsigned long long)s.target, s.centerX, s.centerY);
+	}
+	else if (replySize == sizeof(ControlPipe::StatsReply))
+	{
+		ControlPipe::StatsReply s;
+		memcpy(&s, reply, sizeof(s));
+		printf("ticks=%llu key_events=%llu recenters=%llu repeats=%llu debounced=%llu ineligible=%llu\n",
+			(unsigned long long)s.ticks, (unsigned long long)s.keyEvents, (unsigned long long)s.recentersExecuted,
+			(unsigned long long)s.recentersRepeat, (unsigned long long)s.recentersDebounced, (unsigned long long)s.recentersIneligible);
+	}
+	else
+	{
+		printf("ok\n");
+	}
+
+	if (count > 1)
+	{
+		std::sort(latencyUs.begin(), latencyUs.end());
+		printf("%d round trips: min %.1f us, median %.1f us, p99 %.1f us, max %.1f us\n", count, latencyUs.front(),
+			latencyUs[latencyUs.size() / 2], latencyUs[latencyUs.size() * 99 / 100], latencyUs.back());
+	}
+	return 0;
+}
+
+// Stats page reader: SwimMouseCursor.exe --stats. Prints one snapshot of a running instance's shared memory page.
+static int StatsCommand()
+{
+	StatsPage::Reader reader;
+	StatsPage::Data data;
+	unsigned retries = 0;
+	if (!reader.Open() || !reader.Read(data, 1000, &retries))
+	{
+		fwprintf(stderr, L"Could not read %s (error %lu). Is SwimMouseCursor running with stats_page=on?\n", StatsPage::MAPPING_NAME, GetLastError());
+		return 1;
+	}
+
+	LARGE_INTEGER now, freq;
+	QueryPerformanceCounter(&now);
+	QueryPerformanceFrequency(&freq);
+	printf("pid=%lu age_ms=%.1f retries=%u\n", (unsigned long)data.writerPid,
+		((uint64_t)now.QuadPart - data.publishedQpc) * 1000.0 / freq.QuadPart, retries);
+	printf("enabled=%u clipped=%u eligible=%u target_front=%u moving=%u\n", (data.flags & StatsPage::ENABLED) != 0,
+		(data.flags & StatsPage::CLIPPED) != 0, (data.flags & StatsPage::ELIGIBLE) != 0,
+		(data.flags & StatsPage::TARGET_FRONT) != 0, (data.flags & StatsPage::MOVING) != 0);
+	printf("target_pid=%lu target=0x%llx clip=(%d,%d)-(%d,%d)\n", (unsigned long)data.targetPid, (unsigned long long)data.targetWindow,
+		data.clipLeft, data.clipTop, data.clipRight, data.clipBottom);
+	for (size_t action = 0; action < (size_t)FlightRecorder::Action::Count; action++)
+		printf("ticks_%s=%llu\n", FlightRecorder::ActionName((uint8_t)action), (unsigned long long)data.ticks[action]);
+	printf("recenters=%llu\n", (unsigned long long)data.recenters);
+	printf("escapes=%u escaped_ms=%u clip_resets=%u\n", data.escapes, data.escapedMs, data.clipResets);
+	printf("tick_us p50=%u p90=%u p99=%u max=%u\n", data.tickP50Us, data.tickP90Us, data.tickP99Us, data.tickMaxUs);
+	return 0;
+}
+
+// "log_file=<path>", optionally "log_file_size_mb=<n>" (default 4) and "log_file_count=<n>" (default 3)
+static void OpenLogFileFromConfig()
+{
+	const Config::Settings& config = CurrentConfig();
+	if (config.logFile.empty())
+		return;
+
+	if (!logFile.Open(config.logFile, (size_t)config.logFileSizeMb * 1024 * 1024, (unsigned)config.logFileCount))
+	{
+		LOG_ERROR(L"[!] Failed to open log file %s (error %lu).", config.logFile.c_str(), GetLastError());
+		return;
+	}
+
+	logFileSink = [](const wchar_t* text) { logFile.Write(text); };
+	Log(L"[*] Logging to %s (%lu x %lu MB, rotating).", config.logFile.c_str(), config.logFileCount, config.logFileSizeMb);
+}
+
+static void OpenEventLogFromConfig()
+{
+	const Config::Settings& config = CurrentConfig();
+	if (config.eventLog.empty())
+		return;
+
+	if (eventLog.Open(config.eventLog.c_str()))
+	{
+		Log(L"[*] Writing binary event log to %s (decode with --decode-events).", config.eventLog.c_str());
+		eventLog.Event(EventLog::EventId::Start);
+	}
+	else
+	{
+		LOG_ERROR(L"[!] Failed to open event log %s (error %lu).", config.eventLog.c_str(), GetLastError());
+	}
+}
+
+static void OpenTraceFromConfig()
+{
+	const Config::Settings& config = CurrentConfig();
+	if (config.trace.empty())
+		return;
+
+	if (trace.Open(config.trace.c_str()))
+		Log(L"[*] Recording clip loop trace to %s (replay with --replay-trace).", config.trace.c_str());
+	else
+		LOG_ERROR(L"[!] Failed to open trace %s (error %lu).", config.trace.c_str(), GetLastError());
+}
+
+// Safety toggle hotkey (id 1) from the configured chord; also used when a reload changes it
+static void RegisterToggleHotkey(const VirtualKeyParser::KeyChord& chord)
+{
+	UINT toggleModifiers = 0, toggleVk = 0;
+	Config::HotkeyFromChord(chord, toggleModifiers, toggleVk);
+	VirtualKeyParser::ChordName toggleName = VirtualKeyParser::GetChordName(chord);
+	if (!RegisterHotKey(nullptr, 1, toggleModifiers, toggleVk))
+	{
+		LOG_ERROR(L"[!] Failed to register hotkey %S (error %lu).", toggleName.c_str(), GetLastError());
+	}
+	else
+	{
+		Log(L"[*] Safety hotkey ready: %S to toggle clipping on/off.", toggleName.c_str());
+	}
+}
+
+// Size and last-write time: a reload only re-reads and re-parses the file when either changed
+static bool GetConfigFileStamp(WIN32_FILE_ATTRIBUTE_DATA& stamp)
+{
+	return GetFileAttributesExW(configPath.c_str(), GetFileExInfoStandard, &stamp) != 0;
+}
+
+// Watcher thread: waits on a change notification for the config directory, then reads and parses the
+// file here, off the poll loop, and offers the result to the main thread. Nothing here touches live state.
+static void WatchConfigFile()
+{
+	wchar_t directory[MAX_PATH];
+	if (!GetFullPathNameW(configPath.c_str(), MAX_PATH, directory, nullptr))
+		return;
+	PathRemoveFileSpecW(directory);
+
+	HANDLE change = FindFirstChangeNotificationW(directory, FALSE, FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_SIZE | FILE_NOTIFY_CHANGE_FILE_NAME);
+	if (change == INVALID_HANDLE_VALUE)
+		return;
+
+	WIN32_FILE_ATTRIBUTE_DATA lastStamp{};
+	GetConfigFileStamp(lastStamp);
+
+	HANDLE handles[] = { configWatchStop, change };
+	while (WaitForMultipleObjects(2, handles, FALSE, INFINITE) == WAIT_OBJECT_0 + 1)
+	{
+		LARGE_INTEGER detected;
+		QueryPerformanceCounter(&detected);
+		FindNextChangeNotification(change);
+
+		// Editors save in several steps (truncate, write, rename); let them finish before reading
+		if (WaitForSingleObject(configWatchStop, 100) == WAIT_OBJECT_0)
+			break;
+
+		// Other files in the directory (our own logs, for one) trigger the notification too
+		WIN32_FILE_ATTRIBUTE_DATA stamp{};
+		if (!GetConfigFileStamp(stamp) ||
+			(CompareFileTime(&stamp.ftLastWriteTime, &lastStamp.ftLastWriteTime) == 0 &&
+			 stamp.nFileSizeLow == lastStamp.nFileSizeLow && stamp.nFileSizeHigh == lastStamp.nFileSizeHigh))
+			continue;
+
+		std::unique_ptr<Config::Snapshot> snapshot = LoadConfigSnapshot(false);
+		if (!snapshot)
+			continue;
+		lastStamp = stamp;
+		snapshot->detectedQpc = (uint64_t)detected.QuadPart;
+		configStore.Offer(std::move(snapshot));
+	}
+
+	FindCloseChangeNotification(change);
+}
+
+// Main thread, between ticks: nothing holds a reference to the current settings here, so the replaced
+// snapshot is freed as soon as the live state derived from it has been updated. Returns true on a reload.
+static bool ApplyConfigUpdate()
+{
+	PROFILE_ZONE("config install");
+	std::unique_ptr<const Config::Snapshot> previous = configStore.Install();
+	if (!previous)
+		return false;
+
+	const Config::Snapshot& snapshot = configStore.CurrentSnapshot();
+	const Config::Settings& config = snapshot.settings;
+	const Config::Settings& old = previous->settings;
+
+	Log(L"[*] %s changed, reloading.", configPath.c_str());
+	LogConfig::SetLevel(config.logLevel);
+	ReportConfig(snapshot);
+
+	// Cached verdicts point at profiles in the old snapshot; the next tick re-binds the target's chord
+	windowClassCache.clear();
+	BindRecenterChord(config.TargetProfile().recenterChord);
+	if (!Config::SameChord(config.toggleChord, old.toggleChord))
+	{
+		UnregisterHotKey(nullptr, 1);
+		RegisterToggleHotkey(config.toggleChord);
+	}
+	if (config.inputBackend != old.inputBackend || config.logFile != old.logFile || config.logFileSizeMb != old.logFileSizeMb ||
+		config.logFileCount != old.logFileCount || config.eventLog != old.eventLog || config.trace != old.trace ||
+		config.controlPipe != old.controlPipe || config.statsPage != old.statsPage ||
+		config.metricsFile != old.metricsFile || config.metricsIntervalMs != old.metricsIntervalMs)
+	{
+		LOG_WARN(L"[!] Changes to input_backend, log_file*, event_log, trace, control_pipe, stats_page and metrics_* take effect after a restart.");
+	}
+
+	LARGE_INTEGER now, freq;
+	QueryPerformanceCounter(&now);
+	QueryPerformanceFrequency(&freq);
+	Log(L"[*] Config reload applied %.1f ms after the change was noticed.",
+		(now.QuadPart - (LONGLONG)snapshot.detectedQpc) * 1000.0 / freq.QuadPart);
+	return true;
+}
+
+static bool FileExists(const std::wstring& path)
+{
+	DWORD attributes = GetFileAttributesW(path.c_str());
+	return attributes != INVALID_FILE_ATTRIBUTES && !(attributes & FILE_ATTRIBUTE_DIRECTORY);
+}
+
+// Pick the config file, highest precedence first:
+//  1. --config <path> on the command line
+//  2. the SWIMMOUSECURSOR_CONFIG environment variable
+//  3. %APPDATA%\SwimMouseCursor\config.txt, if it exists (per-user settings)
+//  4. config.txt next to the executable (created there on first run)
+// Never relative to the working directory, which is arbitrary under shortcuts and autostart.
+// Returns a description of where the path came from.
+static const wchar_t* ResolveConfigPath(const std::wstring& explicitPath)
+{
+	wchar_t buffer[MAX_PATH];
+	const wchar_t* source = L"next to the executable";
+	std::wstring path;
+
+	if (!explicitPath.empty())
+	{
+		path = explicitPath;
+		source = L"from --config";
+	}
+	else if (FitsPath(GetEnvironmentVariableW(L"SWIMMOUSECURSOR_CONFIG", buffer, MAX_PATH)))
+	{
+		path = buffer;
+		source = L"from SWIMMOUSECURSOR_CONFIG";
+	}
+	else if (FitsPath(GetEnvironmentVariableW(L"APPDATA", buffer, MAX_PATH)) &&
+		FileExists(std::wstring(buffer) + L"\\SwimMouseCursor\\" + CONFIG_FILE_NAME))
+	{
+		path = std::wstring(buffer) + L"\\SwimMouseCursor\\" + CONFIG_FILE_NAME;
+		source = L"per-user";
+	}
+	else if (FitsPath(GetModuleFileNameW(nullptr, buffer, MAX_PATH)))
+	{
+		PathRemoveFileSpecW(buffer);
+		path = std::wstring(buffer) + L"\\" + CONFIG_FILE_NAME;
+	}
+	else
+	{
+		path = CONFIG_FILE_NAME;
+		source = L"in the working directory";
+	}
+
+	// An explicit relative path means relative to where the user ran the command
+	if (FitsPath(GetFullPathNameW(path.c_str(), MAX_PATH, buffer, nullptr)))
+		path = buffer;
+	configPath = path;
+	return source;
+}
+
+// Overrides are parsed as config text, which is UTF-8, so any path survives the round trip through WidenPath
+static std::string NarrowArgument(const wchar_t* text)
+{
+	return Config::NarrowPath(text);
+}
+
+static void PrintUsage()
+{
+	fwprintf(stderr, L"Usage: SwimMouseCursor.exe [--config <file>] [--<setting> <value>]... [--check-config]\n"
+		L"       SwimMouseCursor.exe --decode-events <file> [--csv]\n"
+		L"       SwimMouseCursor.exe --decode-flight <file>\n"
+		L"       SwimMouseCursor.exe --replay-trace <file> [--realtime]\n"
+		L"       SwimMouseCursor.exe --control <status|toggle|enable|disable|reload|stats> [count]\n"
+		L"       SwimMouseCursor.exe --stats\n"
+		L"       SwimMouseCursor.exe [--config <file>] [--<setting> <value>]... --benchmark\n"
+		L"Any config.txt setting can be overridden as --name value or --name=value (e.g. --poll-ms 5).\n"
+		L"Shortcuts: --target <exe> (target_exe), --no-hook (input_backend=none).\n");
+}
+
+// Collects overrides into commandLineOverrides; Config::Parse validates them with the file on every load
+static bool ParseCommandLine(int argc, wchar_t** argv, bool& checkConfig, bool& benchmark, std::wstring& explicitConfigPath)
+{
+	for (int i = 1; i < argc; i++)
+	{
+		std::string arg = NarrowArgument(argv[i]);
+		if (arg.size() < 3 || arg.compare(0, 2, "--") != 0)
+		{
+			fwprintf(stderr, L"Unknown argument '%s'.\n", argv[i]);
+			return false;
+		}
+		arg.erase(0, 2);
+
+		if (arg == "check-config")
+		{
+			checkConfig = true;
+			continue;
+		}
+		if (arg == "benchmark")
+		{
+			benchmark = true;
+			continue;
+		}
+		if (arg.compare(0, 7, "config=") == 0)
+		{
+			explicitConfigPath = argv[i] + 9; // Past "--config=", keeping the path wide
+			continue;
+		}
+		if (arg == "config")
+		{
+			if (i + 1 >= argc)
+			{
+				fwprintf(stderr, L"Missing value for '%s'.\n", argv[i]);
+				return false;
+			}
+			explicitConfigPath = argv[++i];
+			continue;
+		}
+		if (arg == "no-hook")
+		{
+			commandLineOverrides += "input_backend=none\n";
+			continue;
+		}
+
+		std::string value;
+		size_t equals = arg.find('=');
+		if (equals != std::string::npos)
+		{
+			value = arg.substr(equals + 1);
+			arg.resize(equals);
+		}
+		else if (i + 1 < argc)
+		{
+			value = NarrowArgument(argv[++i]);
+		}
+		else
+		{
+			fwprintf(stderr, L"Missing value for '%s'.\n", argv[i]);
+			return false;
+		}
+
+		std::replace(arg.begin(), arg.end(), '-', '_');
+		if (arg == "target")
+			arg = "target_exe";
+
+		// Like --config, a relative output path on the command line is relative to where the command ran
+		if (!value.empty() && (arg == "log_file" || arg == "event_log" || arg == "trace" || arg == "flight_recorder" ||
+			arg == "zone_trace" || arg == "metrics_file"))
+		{
+			wchar_t buffer[MAX_PATH];
+			if (FitsPath(GetFullPathNameW(Config::WidenPath(value).c_str(), MAX_PATH, buffer, nullptr)))
+				value = NarrowArgument(buffer);
+		}
+		commandLineOverrides += arg + "=" + value + "\n";
+	}
+	return true;
+}
+
+// SwimMouseCursor.exe [overrides] --check-config: parse, validate and print the effective settings, then exit.
+// Installs no hooks and creates no files. Exit code 1 if anything was reported.
+static int CheckConfigCommand()
+{
+	std::unique_ptr<Config::Snapshot> snapshot = LoadConfigSnapshot(false);
+	if (!snapshot)
+	{
+		fwprintf(stderr, L"%s not found, using defaults.\n", configPath.c_str());
+		snapshot = std::make_unique<Config::Snapshot>();
+		ParseConfig({}, *snapshot);
+	}
+
+	const Config::ParseReport& report = snapshot->report;
+	for (size_t i = 0; i < report.issueCount; i++)
+	{
+		if (report.issues[i].line)
+			fwprintf(stderr, L"%s line %u: %S.\n", configPath.c_str(), report.issues[i].line, report.issues[i].text);
+		else
+			fwprintf(stderr, L"Command line: %S.\n", report.issues[i].text);
+	}
+
+	Config::Print(snapshot->settings, stdout);
+	return report.issueCount ? 1 : 0;
+}
+
+static volatile uintptr_t benchmarkSink; // Keeps benchmarked results alive through the optimizer
+static const DWORD BENCHMARK_MIN_MS = 200;
+
+// Calls fn in doubling batches until BENCHMARK_MIN_MS have passed and prints one JSON result object
+template <class Fn>
+static void Benchmark(const char* name, Fn fn, bool& first)
+{
+	LARGE_INTEGER freq, start, now;
+	QueryPerformanceFrequency(&freq);
+	QueryPerformanceCounter(&start);
+	uint64_t calls = 0, batch = 1;
+	do
+	{
+		for (uint64_t i = 0; i < batch; i++)
+			benchmarkSink = benchmarkSink + (uintptr_t)fn();
+		calls += batch;
+		if (batch < (1u << 20)) batch *= 2;
+		QueryPerformanceCounter(&now);
+	} while ((uint64_t)(now.QuadPart - start.QuadPart) * 1000 < (uint64_t)BENCHMARK_MIN_MS * freq.QuadPart);
+
+	printf("%s\n    { \"name\": \"%s\", \"calls\": %llu, \"ns_per_call\": %.1f }", first ? "" : ",", name,
+		(unsigned long long)calls, (now.QuadPart - start.QuadPart) * 1e9 / freq.QuadPart / calls);
+	first = false;
+}
+
+static BOOL CALLBACK CountWindowProc(HWND hwnd, LPARAM lParam)
+{
+	uint32_t* counts = (uint32_t*)lParam;
+	counts[0]++;
+	if (IsWindowVisible(hwnd)) counts[1]++;
+	return TRUE;
+}
+
+// SwimMouseCursor.exe [overrides] --benchmark: time the hot functions against the real desktop, with the
+// window in front after a 3 second countdown as the subject (switch to the game to measure the target
+// path), and print JSON. Clips nothing and installs no input hooks. Results depend on the number of
+// windows, which is reported as the scene.
+static int BenchmarkCommand()
+{
+	std::unique_ptr<Config::Snapshot> snapshot = LoadConfigSnapshot(false);
+	if (!snapshot)
+	{
+		snapshot = std::make_unique<Config::Snapshot>();
+		ParseConfig({}, *snapshot);
+	}
+	configStore.Offer(std::move(snapshot));
+	configStore.Install();
+	LogConfig::SetLevel(LogLevel::Info);
+
+	for (int i = 3; i > 0; i--)
+	{
+		fwprintf(stderr, L"Benchmarking the foreground window in %d...\n", i);
+		Sleep(1000);
+	}
+
+	HWND fg = GetForegroundWindow();
+	DWORD pid = 0;
+	GetWindowThreadProcessId(fg, &pid);
+	const Config::Profile* profile = GetTargetProfile(fg);
+	const Config::Profile& settings = profile ? *profile : CurrentConfig().defaults;
+	uint32_t windowCounts[2] = {};
+	EnumWindows(CountWindowProc, (LPARAM)windowCounts);
+
+	// The classification cache only runs with its invalidation hooks installed, as in the real loop
+	nameChangeHook = SetWinEventHook(EVENT_OBJECT_NAMECHANGE, EVENT_OBJECT_NAMECHANGE, nullptr,
+		WindowCacheEventProc, 0, 0, WINEVENT_OUTOFCONTEXT | WINEVENT_SKIPOWNPROCESS);
+	destroyHook = SetWinEventHook(EVENT_OBJECT_DESTROY, EVENT_OBJECT_DESTROY, nullptr,
+		WindowCacheEventProc, 0, 0, WINEVENT_OUTOFCONTEXT | WINEVENT_SKIPOWNPROCESS);
+
+	printf("{\n  \"scene\": { \"top_level_windows\": %u, \"visible_windows\": %u, \"foreground_is_target\": %s },\n  \"results\": [",
+		windowCounts[0], windowCounts[1], profile ? "true" : "false");
+	bool first = true;
+
+	Benchmark("ClassifyWindow", [&] { return ClassifyWindow(fg, pid); }, first);
+	Benchmark("GetTargetProfile", [&] { return GetTargetProfile(fg); }, first);
+	Benchmark("IsWindowActuallyVisibleAndTopmost", [&] { return IsWindowActuallyVisibleAndTopmost(fg, settings.occlusionThresholdPercent); }, first);
+	Benchmark("GetWindowClipRect", [&] { RECT rc; return GetWindowClipRect(fg, settings.clipArea, rc); }, first);
+	Benchmark("IsAnyWindowBeingMovedOrResized", [] { return IsAnyWindowBeingMovedOrResized(); }, first);
+
+	static const char* keyNames[] = { "E", "NUMPAD5", "VK_F12", "lctrl" };
+	size_t nameIndex = 0;
+	Benchmark("VirtualKeyParser::ParseKeyName", [&] { return VirtualKeyParser::ParseKeyName(keyNames[nameIndex++ & 3]); }, first);
+	static const WORD keyCodes[] = { 'E', VK_NUMPAD5, VK_F12, VK_LCONTROL };
+	size_t codeIndex = 0;
+	Benchmark("VirtualKeyParser::GetKeyNameFromVK", [&] { return VirtualKeyParser::GetKeyNameFromVK(keyCodes[codeIndex++ & 3]); }, first);
+
+	Benchmark(PROFILE_ZONES ? "PROFILE_ZONE" : "PROFILE_ZONE (compiled out)", [] { PROFILE_ZONE("benchmark"); return 0; }, first);
+	Benchmark("LOG_DEBUG (filtered out)", [&] { LOG_DEBUG(L"[.] Benchmark %p.", fg); return 0; }, first);
+	// Real console writes, into an off-screen buffer so the benchmark doesn't scroll the window
+	HANDLE console = GetStdHandle(STD_OUTPUT_HANDLE);
+	HANDLE hiddenBuffer = CreateConsoleScreenBuffer(GENERIC_READ | GENERIC_WRITE, 0, nullptr, CONSOLE_TEXTMODE_BUFFER, nullptr);
+	if (hiddenBuffer != INVALID_HANDLE_VALUE)
+	{
+		SetStdHandle(STD_OUTPUT_HANDLE, hiddenBuffer);
+		Benchmark("Log", [&] { Log(L"[#] Clipping cursor to Minecraft window (%ld,%ld)-(%ld,%ld).", 0L, 0L, 1920L, 1080L); return 0; }, first);
+		SetStdHandle(STD_OUTPUT_HANDLE, console);
+		CloseHandle(hiddenBuffer);
+	}
+
+	Benchmark("ClipLogic::Tick (live)", [] {
+		ClipLogic::State state;
+		LiveWorld live;
+		ClipLogic::ObservingWorld<LiveWorld> world{ live };
+		return ClipLogic::Tick(state, world).action;
+	}, first);
+
+	// Replay the answers of a second tick, the steady state of the loop
+	ClipLogic::State steadyState;
+	LiveWorld live;
+	ClipLogic::ObservingWorld<LiveWorld> firstTick{ live };
+	ClipLogic::Tick(steadyState, firstTick);
+	ClipLogic::ObservingWorld<LiveWorld> observed{ live };
+	ClipLogic::Tick(steadyState, observed);
+	Benchmark("ClipLogic::Tick (replayed)", [&] {
+		ClipLogic::State state = steadyState;
+		ClipLogic::ReplayWorld world{ observed.seen };
+		return ClipLogic::Tick(state, world).action;
+	}, first);
+
+	printf("\n  ]\n}\n");
+	UnhookWinEvent(nameChangeHook);
+	UnhookWinEvent(destroyHook);
+	return 0;
+}
+
 int wmain(int argc, wchar_t** argv)
 {
+	if (argc >= 3 && _wcsicmp(argv[1], L"--decode-events") == 0)
+	{
+		return DecodeEventLogCommand(argc, argv);
+	}
+	if (argc >= 3 && _wcsicmp(argv[1], L"--decode-flight") == 0)
+	{
+		return DecodeFlightRecorderCommand(argv);
+	}
+	if (argc >= 3 && _wcsicmp(argv[1], L"--replay-trace") == 0)
+	{
+		return ReplayTraceCommand(argc, argv);
+	}
+	if (argc >= 3 && _wcsicmp(argv[1], L"--control") == 0)
+	{
+		return ControlCommand(argc, argv);
+	}
+	if (argc >= 2 && _wcsicmp(argv[1], L"--stats") == 0)
+	{
+		return StatsCommand();
+	}
+
+	bool checkConfig = false;
+	bool benchmark = false;
+	std::wstring explicitConfigPath;
+	if (!ParseCommandLine(argc, argv, checkConfig, benchmark, explicitConfigPath))
+	{
+		PrintUsage();
+		return 2;
+	}
+	const wchar_t* configSource = ResolveConfigPath(explicitConfigPath);
+	if (checkConfig)
+	{
+		return CheckConfigCommand();
+	}
+	if (benchmark)
+	{
+		return BenchmarkCommand();
+	}
+
+	exitCleanupDone = CreateEventW(nullptr, TRUE, FALSE, nullptr);
 	SetConsoleCtrlHandler(ConsoleCtrlHandler, TRUE);
+	SetUnhandledExceptionFilter(CrashFilter);
 
 	Log(L"Bedrock Mouse Cursor, a Program to fix Minecraft Bedrock 1.21.121's Mouse Cursor Window Issues");
 	Log(L"Programmed by Swedeachu, sponsored by discord.gg/swim");
 	Log(L"Play Our MCPE Server: swimgg.club");
 	Log(L"\n");
 
-	// Load recenter key from config
-	recenterKey = LoadRecenterKeyFromConfig();
-
-	// Safety hotkey: Ctrl+Shift+C (this one can consume the key since it's a special combo)
-	if (!RegisterHotKey(nullptr, 1, MOD_CONTROL | MOD_SHIFT, 'C'))
+	// Load settings; the log level applies to everything after this, including config warnings
+	configStore.Offer(LoadConfigSnapshot(true));
+	configStore.Install();
+	LogConfig::SetLevel(CurrentConfig().logLevel);
+	OpenLogFileFromConfig();
+	Log(L"[*] Using config file %s (%s).", configPath.c_str(), configSource);
+	ReportConfig(configStore.CurrentSnapshot());
+	BindRecenterChord(CurrentConfig().TargetProfile().recenterChord);
+	OpenEventLogFromConfig();
+	OpenTraceFromConfig();
+
+	// Safety hotkey: Ctrl+Shift+C by default (this one can consume the key since it's a special combo)
+	RegisterToggleHotkey(CurrentConfig().toggleChord);
+
+	if (!RegisterHotKey(nullptr, 2, MOD_CONTROL | MOD_SHIFT, 'D'))
 	{
-		Log(L"[!] Failed to register hotkey Ctrl+Shift+C (error %lu).", GetLastError());
+		LOG_WARN(L"[!] Failed to register hotkey Ctrl+Shift+D (error %lu).", GetLastError());
 	}
 	else
 	{
-		Log(L"[*] Safety hotkey ready: Ctrl+Shift+C to toggle clipping on/off.");
+		Log(L"[*] Diagnostics hotkey ready: Ctrl+Shift+D to dump the flight recorder to %s and show Win32 call counts.", CurrentConfig().flightRecorderPath.c_str());
 	}
 
-	// Install low-level keyboard hook for recenter key (non-blocking)
-	keyboardHook = SetWindowsHookExW(WH_KEYBOARD_LL, LowLevelKeyboardProc, GetModuleHandle(nullptr), 0);
-	if (!keyboardHook)
+	// Start the keyboard backend for the recenter key (non-blocking), falling back to the low-level hook
+	inputSource = CreateInputSourceFromConfig();
+	if (!inputSource)
 	{
-		Log(L"[!] Failed to install keyboard hook (error %lu).", GetLastError());
+		Log(L"[*] Keyboard input disabled (input_backend=none): recenter key is off.");
 	}
-	else
+	else if (!inputSource->Start(OnKeyEvent))
 	{
-		std::string keyName = VirtualKeyParser::GetKeyNameFromVK(recenterKey);
-		Log(L"[*] Recenter hotkey ready: Press '%S' to recenter cursor (non-blocking).", keyName.c_str());
+		LOG_WARN(L"[!] Failed to start '%s' keyboard input (error %lu).", inputSource->Name(), GetLastError());
+		if (dynamic_cast<RawInputSource*>(inputSource.get()))
+		{
+			inputSource = std::make_unique<LowLevelHookInput>();
+			if (!inputSource->Start(OnKeyEvent))
+			{
+				LOG_ERROR(L"[!] Failed to install keyboard hook (error %lu).", GetLastError());
+				inputSource.reset();
+			}
+		}
+		else
+		{
+			inputSource.reset();
+		}
 	}
 
-	Log(L"[*] CursorClipperConsole running. Looking for: %s", TARGET_EXE);
+	if (inputSource)
+	{
+		VirtualKeyParser::ChordName keyName = VirtualKeyParser::GetChordName(boundRecenterChord);
+		Log(L"[*] Recenter hotkey ready: Press '%S' to recenter cursor (non-blocking, %s input).", keyName.c_str(), inputSource->Name());
+	}
+
+	// Invalidate cached window classifications on rename/destroy (delivered via our message pump)
+	nameChangeHook = SetWinEventHook(EVENT_OBJECT_NAMECHANGE, EVENT_OBJECT_NAMECHANGE, nullptr,
+		WindowCacheEventProc, 0, 0, WINEVENT_OUTOFCONTEXT | WINEVENT_SKIPOWNPROCESS);
+	destroyHook = SetWinEventHook(EVENT_OBJECT_DESTROY, EVENT_OBJECT_DESTROY, nullptr,
+		WindowCacheEventProc, 0, 0, WINEVENT_OUTOFCONTEXT | WINEVENT_SKIPOWNPROCESS);
+	if (!nameChangeHook || !destroyHook)
+	{
+		// Without invalidation a renamed window would keep its old verdict, so don't cache at all
+		LOG_WARN(L"[!] Failed to install window event hooks (error %lu). Window classification cache disabled.", GetLastError());
+	}
+
+	// Check the clip right after foreground changes instead of waiting for clip_verify_ms
+	foregroundHook = SetWinEventHook(EVENT_SYSTEM_FOREGROUND, EVENT_SYSTEM_FOREGROUND, nullptr,
+		ForegroundEventProc, 0, 0, WINEVENT_OUTOFCONTEXT | WINEVENT_SKIPOWNPROCESS);
+	if (!foregroundHook)
+		LOG_WARN(L"[!] Failed to install foreground event hook (error %lu). Clip resets are found by the periodic check only.", GetLastError());
+
+	// Pick up edits to the config file while running
+	configWatchStop = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+	std::thread configWatcher;
+	if (configWatchStop)
+		configWatcher = std::thread(WatchConfigFile);
+
+	// Local control endpoint (status, toggle, reload, stats); clipping changes come back through our message queue
+	mainThreadId = GetCurrentThreadId();
+	ZoneProfiler::NameThread("main");
+	if (CurrentConfig().controlPipe)
+	{
+		if (!controlPipe.Start(HandleControlRequest))
+			LOG_WARN(L"[!] Failed to open control pipe %s (error %lu). Is another instance running?", ControlPipe::PIPE_NAME, GetLastError());
+		else
+			Log(L"[*] Control pipe ready: %s (try SwimMouseCursor.exe --control status).", ControlPipe::PIPE_NAME);
+	}
+
+	// Shared memory stats for overlays and monitoring tools
+	if (CurrentConfig().statsPage)
+	{
+		if (!statsPage.Open())
+			LOG_WARN(L"[!] Failed to create stats page %s (error %lu). Is another instance running?", StatsPage::MAPPING_NAME, GetLastError());
+		else
+			Log(L"[*] Stats page ready: %s (try SwimMouseCursor.exe --stats).", StatsPage::MAPPING_NAME);
+	}
+
+	// Prometheus text file for textfile collectors (off unless metrics_file= is set)
+	if (!CurrentConfig().metricsFile.empty())
+	{
+		if (!metricsExporter.Start(CurrentConfig().metricsFile.c_str(), CurrentConfig().metricsIntervalMs, CollectMetrics))
+			LOG_WARN(L"[!] Failed to start metrics export (error %lu).", GetLastError());
+		else
+			Log(L"[*] Writing metrics to %s every %lu ms.", CurrentConfig().metricsFile.c_str(), (unsigned long)CurrentConfig().metricsIntervalMs);
+	}
+
+	Log(L"[*] CursorClipperConsole running. Looking for: %s", CurrentConfig().targetExe.c_str());
 	Log(L"[*] Will clip cursor whenever Minecraft window is focused AND visible on screen.");
 	Log(L"[*] Clipping is currently: ENABLED");
 
 	// We'll pump messages only for hotkey; foreground tracking is via polling.
 	MSG msg{};
-	HWND lastActive = nullptr;
-	bool lastClipped = false;
-	bool needsClipUpdate = false;
+	ClipLogic::State clipState;
 
 	auto lastPoll = GetTickCount();
-	const DWORD POLL_MS = 10;
+	DWORD pollMs = CurrentConfig().TargetProfile().pollMs; // From the profile of the window in front
+	auto lastEventLogFlush = lastPoll;
+	const DWORD EVENT_LOG_FLUSH_MS = 5000; // Bounds what a crash can lose
+	auto lastLogSummary = lastPoll;
+	DWORD targetPid = 0; // Of the target window in front, for the stats page
+	LARGE_INTEGER loopFreq;
+	QueryPerformanceFrequency(&loopFreq);
+	const uint64_t qpcPerMs = (uint64_t)loopFreq.QuadPart / 1000;
 
 	while (running.load())
 	{
+		// Quiescent point: no settings reference is held across loop iterations
+		if (ApplyConfigUpdate())
+		{
+			clipState.needsClipUpdate = true;
+			trace.ForceUpdate();
+		}
+
 		// Non-blocking message pump (for hotkey and hook)
-		while (PeekMessageW(&msg, nullptr, 0, 0, PM_REMOVE))
 		{
-			if (msg.message == WM_HOTKEY)
+			PROFILE_ZONE("message pump");
+			while (W32(PeekMessageW)(&msg, nullptr, 0, 0, PM_REMOVE))
 			{
-				if (msg.wParam == 1)
+				if (msg.message == WM_HOTKEY)
 				{
-					// Toggle clipping on/off
-					clippingEnabled.store(!clippingEnabled.load());
-					if (!clippingEnabled.load())
+					if (msg.wParam == 1)
 					{
-						ClipCursor(nullptr);
-						lastClipped = false;
-						Log(L"[=] Clipping DISABLED  cursor released.");
+						// Toggle clipping on/off
+						SetClippingEnabled(!clippingEnabled.load(), clipState);
 					}
-					else
+					else if (msg.wParam == 2)
 					{
-						Log(L"[=] Clipping ENABLED  will clip when Minecraft is focused.");
+						DumpFlightRecorder();
+						Win32Calls::Dump();
+						ExportZones();
 					}
 				}
+				else if (msg.message == WM_CONTROL_CLIPPING)
+				{
+					SetClippingEnabled(msg.wParam == 2 ? !clippingEnabled.load() : msg.wParam == 1, clipState);
+				}
+				W32(TranslateMessage)(&msg);
+				W32(DispatchMessageW)(&msg);
 			}
-			TranslateMessage(&msg);
-			DispatchMessageW(&msg);
 		}
 
-		DWORD now = GetTickCount();
-		if (now - lastPoll >= POLL_MS)
+		DWORD now = W32(GetTickCount)();
+		if ((eventLog.IsOpen() || trace.IsOpen()) && now - lastEventLogFlush >= EVENT_LOG_FLUSH_MS)
+		{
+			lastEventLogFlush = now;
+			eventLog.Flush();
+			trace.Flush();
+		}
+		else
+		{
+			eventLog.FlushIfFull();
+			trace.FlushIfFull();
+		}
+
+		// Summarise rate-limited messages that have since gone quiet, and push the log file to disk
+		if (now - lastLogSummary >= 1000)
+		{
+			lastLogSummary = now;
+			LogLimiter::FlushSummaries(now);
+			logFile.Flush();
+			statsPage.UpdatePercentiles(now);
+			Win32Calls::PublishTotals();
+			escapeDetector.Publish(QpcNow());
+		}
+
+		// An event that tends to reset the clip gets its check now rather than at the next poll
+		if (now - lastPoll >= pollMs || clipWatch.Pending())
 		{
 			lastPoll = now;
+			FlightTick tick;
+			PROFILE_ZONE("tick");
 
-			// Check if any window is being moved or resized
-			bool movingWindow = IsAnyWindowBeingMovedOrResized();
-			if (movingWindow != windowBeingMoved.load())
+			// Decide from what Win32 reports (noted for the trace), then carry the decision out
+			LiveWorld live;
+			ClipLogic::ObservingWorld<LiveWorld> world{ live };
+			ClipLogic::Decision d = ClipLogic::Tick(clipState, world);
+			trace.Tick(world.seen, d);
+
+			if (d.moveStarted)
 			{
-				windowBeingMoved.store(movingWindow);
-				if (movingWindow)
-				{
-					Log(L"[~] Window move/resize detected  temporarily releasing cursor.");
-					ClipCursor(nullptr);
-					lastClipped = false;
-				}
-				else
-				{
-					Log(L"[~] Window move/resize ended  forcing clip rect update.");
-					needsClipUpdate = true; // Force update clip rect after window change
-				}
+				LogLimited(LogCategory::MoveResize, L"[~] Window move/resize detected  temporarily releasing cursor.");
+				eventLog.Event(EventLog::EventId::MoveResizeStart);
 			}
-
-			// If a window is being moved/resized, don't clip
-			if (movingWindow)
+			else if (d.moveEnded)
 			{
-				if (lastClipped)
-				{
-					ClipCursor(nullptr);
-					lastClipped = false;
-				}
-				std::this_thread::yield();
-				continue;
+				LogLimited(LogCategory::MoveResize, L"[~] Window move/resize ended  forcing clip rect update.");
+				eventLog.Event(EventLog::EventId::MoveResizeEnd);
 			}
 
-			HWND fg = GetForegroundWindow();
-
-			// If clipping is disabled, always release
-			if (!clippingEnabled.load())
+			if (d.focusChanged)
 			{
-				if (lastClipped)
+				if (d.targetActivated)
 				{
-					ClipCursor(nullptr);
-					lastClipped = false;
+					LogLimited(LogCategory::ClipState, L"[+] Minecraft active - refreshing window geometry.");
+					eventLog.TargetActivated(d.foreground);
+					if (!foregroundHook)
+						escapeDetector.TargetActivated(tick.rec.qpc); // Otherwise ForegroundEventProc did, earlier
 				}
-				std::this_thread::yield();
-				continue;
+
+				// Key-ups can be lost across focus changes (secure desktop, elevated windows)
+				keyState.Resync();
 			}
 
-			if (fg != lastActive)
 			{
-				// Foreground changed - FORCE clip rect refresh
-				if (fg && IsMinecraftWindow(fg))
+				PROFILE_ZONE("clip apply");
+				if (d.externalReset)
 				{
-					Log(L"[+] Minecraft active - refreshing window geometry.");
-					needsClipUpdate = true; // Force fresh clip rect calculation
+					ReassertClip(d.clip, tick.rec.qpc, clipState);
 				}
-				else
+				else if (d.op == ClipLogic::ClipOp::Apply)
 				{
-					if (lastClipped)
-					{
-						ClipCursor(nullptr);
-						lastClipped = false;
-						Log(L"[-] Minecraft not active  cursor released.");
-					}
+					LogLimited(LogCategory::ClipState, L"[#] Clipping cursor to Minecraft window (%ld,%ld)-(%ld,%ld).",
+						d.clip.left, d.clip.top, d.clip.right, d.clip.bottom);
+					eventLog.ClipApplied(d.foreground, d.clip);
+					ApplyClip(d.clip, clipState);
+					clipWatch.Intact(tick.rec.qpc);
+				}
+				else if (d.verified)
+				{
+					clipWatch.Intact(tick.rec.qpc);
+				}
+				else if (d.op == ClipLogic::ClipOp::Release)
+				{
+					W32(ClipCursor)(nullptr);
 				}
-				lastActive = fg;
 			}
 
-			// Check if Minecraft is foreground AND actually visible
-			if (fg && IsMinecraftWindow(fg) && IsWindowActuallyVisibleAndTopmost(fg))
+			UpdateClipWatch(d.eligible && clipState.lastClipped, d.isTarget, d.clip, d.foreground, d.action, tick.rec.qpc);
+
+			if (d.released)
 			{
-				RECT clip{};
-				// ALWAYS get fresh clip rect - never trust old values
-				if (GetWindowClipRect(fg, clip))
-				{
-					// Validate clip rect is reasonable
-					if (clip.right > clip.left && clip.bottom > clip.top)
-					{
-						// Check if clip rect actually changed significantly (moved/resized)
-						RECT currentClip{};
-						bool hasCurrentClip = (GetClipCursor(&currentClip) != 0);
-
-						bool clipChanged = !hasCurrentClip ||
-							abs(currentClip.left - clip.left) > 2 ||
-							abs(currentClip.top - clip.top) > 2 ||
-							abs(currentClip.right - clip.right) > 2 ||
-							abs(currentClip.bottom - clip.bottom) > 2;
-
-						// Log and update if this is first clip, forced update, or rect changed
-						if (needsClipUpdate || !lastClipped || clipChanged)
-						{
-							Log(L"[#] Clipping cursor to Minecraft window (%ld,%ld)-(%ld,%ld).",
-								clip.left, clip.top, clip.right, clip.bottom);
-							ClipCursor(&clip);
-							lastClipped = true;
-							needsClipUpdate = false;
-						}
-						else
-						{
-							// Rect is the same, but still apply it to ensure consistency
-							ClipCursor(&clip);
-						}
-					}
-					else
-					{
-						// Invalid clip rect
-						if (lastClipped)
-						{
-							ClipCursor(nullptr);
-							lastClipped = false;
-							Log(L"[-] Invalid clip rect  cursor released.");
-						}
-					}
-				}
+				if (d.reason == EventLog::ReleaseReason::NotActive)
+					LogLimited(LogCategory::ClipState, L"[-] Minecraft not active  cursor released.");
+				else if (d.reason == EventLog::ReleaseReason::NotVisible)
+					LogLimited(LogCategory::ClipState, L"[-] Minecraft not visible  cursor released.");
+				else if (d.reason == EventLog::ReleaseReason::InvalidRect)
+					LogLimited(LogCategory::ClipState, L"[-] Invalid clip rect  cursor released.");
+				eventLog.ClipReleased(d.reason);
+				LoopCounters::Bump(loopCounters.releases[(size_t)d.reason]);
 			}
-			else
+
+			if (d.evaluated)
 			{
-				if (lastClipped)
-				{
-					ClipCursor(nullptr);
-					lastClipped = false;
-					Log(L"[-] Minecraft not visible  cursor released.");
-				}
+				LOG_TRACE(L"[.] Tick: foreground %p, %S.", d.foreground, FlightRecorder::ActionName((uint8_t)d.action));
+
+				// The profile of the target in front sets the poll rate and the recenter chord
+				const Config::Profile* profile = d.isTarget ? live.profile : nullptr;
+				pollMs = profile ? profile->pollMs : CurrentConfig().defaults.pollMs;
+				if (profile)
+					BindRecenterChord(profile->recenterChord);
+				tick.rec.classification = !d.foreground ? FlightRecorder::Classification::None :
+					profile ? FlightRecorder::Classification::Minecraft : FlightRecorder::Classification::Other;
+			}
+			tick.rec.foreground = (uint64_t)(uintptr_t)d.foreground;
+			tick.rec.visiblePercent = world.seen.visiblePercent;
+			tick.rec.clip = d.clip;
+			tick.rec.action = d.action;
+
+			// Hand the verdict to the keyboard hook; recentering only makes sense with a usable rect
+			clipSnapshot.Publish(d.evaluated ? d.foreground : nullptr, d.eligible, d.eligible ? RectCenter(d.clip) : POINT{});
+
+			// Stats page state; published with the tick's duration when `tick` goes out of scope
+			if (statsPage.IsOpen())
+			{
+				if (d.targetActivated)
+					W32(GetWindowThreadProcessId)(d.foreground, &targetPid);
+				uint32_t flags = (clippingEnabled.load() ? StatsPage::ENABLED : 0) | (clipState.lastClipped ? StatsPage::CLIPPED : 0) |
+					(d.eligible ? StatsPage::ELIGIBLE : 0) | (d.isTarget ? StatsPage::TARGET_FRONT : 0) | (clipState.moving ? StatsPage::MOVING : 0);
+				statsPage.SetState(flags, d.clip, d.isTarget ? d.foreground : nullptr, targetPid);
+				statsPage.SetRecenters(recenterStats.executed.load(std::memory_order_relaxed));
+				const EscapeDetector::Stats& escapes = escapeDetector.GetStats();
+				statsPage.SetEscapes(escapes.escapes.load(std::memory_order_relaxed), escapes.escapedQpc.load(std::memory_order_relaxed) / qpcPerMs);
+				statsPage.SetClipResets(clipWatch.GetStats().resets.load(std::memory_order_relaxed));
 			}
 		}
 
@@ -632,14 +2082,79 @@ int wmain(int argc, wchar_t** argv)
 	}
 
 	// Cleanup
-	if (keyboardHook)
+	if (controlPipe.Served())
+		Log(L"[*] Control pipe: %llu requests served.", controlPipe.Served());
+	controlPipe.Stop();
+	UpdateClipWatch(false, false, RECT{}, nullptr, FlightRecorder::Action::None, QpcNow());
+	Win32Calls::PublishTotals();
+	metricsExporter.Stop();
+	if (metricsExporter.Failed())
+		LOG_WARN(L"[!] Metrics export: %llu of %llu writes failed (last error %lu).", metricsExporter.Failed(),
+			metricsExporter.Failed() + metricsExporter.Written(), metricsExporter.LastError());
+	if (inputSource)
 	{
-		UnhookWindowsHookEx(keyboardHook);
+		const InputDeliveryStats& inputStats = inputSource->Stats();
+		uint64_t events = inputStats.events.load();
+		Log(L"[*] Keyboard input (%s): %llu events, %.2f ms average / %lu ms max delivery latency.",
+			inputSource->Name(), events, events ? (double)inputStats.totalLatencyMs.load() / events : 0.0,
+			(unsigned long)inputStats.maxLatencyMs.load());
+		inputSource->Stop();
 	}
+	if (configWatcher.joinable())
+	{
+		SetEvent(configWatchStop);
+		configWatcher.join();
+	}
+	if (configWatchStop) CloseHandle(configWatchStop);
+	if (nameChangeHook) UnhookWinEvent(nameChangeHook);
+	if (destroyHook) UnhookWinEvent(destroyHook);
+	if (foregroundHook) UnhookWinEvent(foregroundHook);
+
+	Log(L"[*] Recenters: %llu executed, %llu auto-repeats suppressed, %llu debounced, %llu while not eligible.",
+		recenterStats.executed.load(), recenterStats.suppressedRepeat.load(),
+		recenterStats.suppressedInterval.load(), recenterStats.ineligible.load());
+
+	LogLimiter::FlushSummaries(GetTickCount() + LogLimiter::WINDOW_MS);
+	Log(L"[*] Rate-limited log lines suppressed: %llu clip state, %llu move/resize.",
+		LogLimiter::SuppressedLines(LogCategory::ClipState), LogLimiter::SuppressedLines(LogCategory::MoveResize));
+
+	LARGE_INTEGER qpcFreq;
+	QueryPerformanceFrequency(&qpcFreq);
+	const EscapeDetector::Stats& escapeStats = escapeDetector.GetStats();
+	double clippedHours = escapeStats.armedQpc.load() / (double)qpcFreq.QuadPart / 3600;
+	Log(L"[*] Cursor escapes: %llu in %.2f h clipped (%.2f per hour, %llu before the clip was applied), %.1f ms outside in total, longest %.1f ms.",
+		escapeStats.escapes.load(), clippedHours, clippedHours > 0 ? escapeStats.escapes.load() / clippedHours : 0.0,
+		escapeStats.pendingClipEscapes.load(), escapeStats.escapedQpc.load() * 1000.0 / qpcFreq.QuadPart,
+		escapeStats.longestQpc.load() * 1000.0 / qpcFreq.QuadPart);
+	const ClipWatch::Stats& watchStats = clipWatch.GetStats();
+	Log(L"[*] Clip resets by other programs: %llu (%llu after a foreground change, %llu after the window moved, %llu seen by the cursor), %.1f ms unclipped at most, %llu re-assertions deferred.",
+		watchStats.resets.load(), watchStats.resetsByTrigger[(size_t)ClipWatch::Trigger::Foreground].load(),
+		watchStats.resetsByTrigger[(size_t)ClipWatch::Trigger::TargetMoved].load(),
+		watchStats.resetsByTrigger[(size_t)ClipWatch::Trigger::CursorOutside].load(),
+		watchStats.unclippedQpc.load() * 1000.0 / qpcFreq.QuadPart, watchStats.reassertsDeferred.load());
+	Log(L"[*] Window classification: %llu lookups, %llu cache hits, %llu exe queries, %llu title reads, %.3f ms uncached, %.2f us per lookup.",
+		classifierStats.lookups, classifierStats.cacheHits, classifierStats.exeQueries, classifierStats.titleReads,
+		classifierStats.missTicks * 1000.0 / qpcFreq.QuadPart,
+		classifierStats.lookups ? classifierStats.lookupTicks * 1e6 / qpcFreq.QuadPart / classifierStats.lookups : 0.0);
+
+	Win32Calls::Dump();
+	ExportZones();
 
 	ClipCursor(nullptr);
 	UnregisterHotKey(nullptr, 1);
+	UnregisterHotKey(nullptr, 2);
+	DumpFlightRecorder();
+	eventLog.Event(EventLog::EventId::Exit);
+	if (eventLog.Dropped() || trace.Dropped())
+		LOG_WARN(L"[!] Records dropped with a full buffer: %llu event log, %llu trace.", eventLog.Dropped(), trace.Dropped());
+	eventLog.Close();
+	trace.Close();
+	statsPage.Close();
 	Log(L"[*] Exiting. Cursor released.");
 
+	logFileSink = nullptr;
+	logFile.Close();
+
+	if (exitCleanupDone) SetEvent(exitCleanupDone);
 	return 0;
 }
@@ -0,0 +1,140 @@
+// AllocationTests.cpp
+// Replaces the global operator new/delete of the test program with counting ones, and checks that the steady-state
+// tick and the keyboard hook path make no heap allocations at all
+
+#include <windows.h>
+#include <atomic>
+#include <cstdlib>
+#include <memory>
+#include <new>
+#include <string>
+#include "Check.h"
+#include "ScriptedWorld.h"
+#include "../ClipSnapshot.h"
+#include "../KeyBindings.h"
+#include "../Trace.h"
+
+static std::atomic<bool> countingAllocations{ false };
+static std::atomic<uint64_t> allocations{ 0 };
+
+void* operator new(size_t size)
+{
+	if (countingAllocations.load(std::memory_order_relaxed))
+		allocations.fetch_add(1, std::memory_order_relaxed);
+	if (void* block = malloc(size ? size : 1))
+		return block;
+	throw std::bad_alloc();
+}
+
+void operator delete(void* block) noexcept
+{
+	free(block);
+}
+
+void operator delete(void* block, size_t) noexcept
+{
+	free(block);
+}
+
+// Counts the allocations made while in scope; tests run one at a time, so no other thread allocates meanwhile
+struct CountAllocations
+{
+	CountAllocations()
+	{
+		allocations.store(0);
+		countingAllocations.store(true);
+	}
+	~CountAllocations() { countingAllocations.store(false); }
+	uint64_t Count() const { return allocations.load(); }
+};
+
+static const uint32_t STEPS = 100000;
+
+// Without this a broken counter would pass every other test here
+TEST(Allocations_CounterWorks)
+{
+	CountAllocations counter;
+	std::unique_ptr<std::string> text = std::make_unique<std::string>(100, 'x');
+	std::unique_ptr<int[]> numbers(new int[16]);
+	Check::sink = (uintptr_t)text->data() + (uintptr_t)numbers.get(); // Or the optimizer may leave them out
+	CHECK(counter.Count() >= 3);
+}
+
+// Focused on the target with the clip in place, as the loop spends almost all of its time: the tick, the
+// snapshot the hook reads, and the trace. Every 1000th tick the window moves, which also writes to the event log.
+TEST(Allocations_SteadyStateTick)
+{
+	std::wstring tracePath = Check::TempPath(L"SwimMouseCursor.Tests.alloc.trace.bin");
+	std::wstring eventsPath = Check::TempPath(L"SwimMouseCursor.Tests.alloc.events.bin");
+	auto trace = std::make_unique<Trace::Writer>();
+	auto events = std::make_unique<EventLog::Writer>();
+	if (!CHECK(trace->Open(tracePath.c_str())) || !CHECK(events->Open(eventsPath.c_str())))
+		return;
+
+	HWND game = (HWND)(uintptr_t)0x10010;
+	ClipLogic::State state;
+	ScriptedWorld live;
+	live.foreground = game;
+	live.target = true;
+	ClipSnapshot snapshot;
+	uint32_t applied = 0;
+	{
+		CountAllocations counter;
+		for (uint32_t i = 0; i < STEPS; i++)
+		{
+			if (i % 1000 == 999)
+				live.clip.left = (LONG)(i / 1000 + 1) * 10;
+			ClipLogic::ObservingWorld<ScriptedWorld> world{ live };
+			ClipLogic::Decision d = ClipLogic::Tick(state, world);
+			trace->Tick(world.seen, d);
+			if (d.op == ClipLogic::ClipOp::Apply)
+			{
+				applied++;
+				events->ClipApplied(game, d.clip);
+			}
+			snapshot.Publish(game, state.lastClipped, POINT{ (live.clip.left + live.clip.right) / 2, 540 });
+			snapshot.Read();
+			trace->FlushIfFull();
+			events->FlushIfFull();
+		}
+		CHECK(counter.Count() == 0);
+	}
+	CHECK(applied == STEPS / 1000 + 1);
+	CHECK(trace->Dropped() == 0);
+	trace->Close();
+	events->Close();
+	DeleteFileW(tracePath.c_str());
+	DeleteFileW(eventsPath.c_str());
+}
+
+// What the input callback does per key: track it, match the bindings, and name it for the log
+TEST(Allocations_KeyEvents)
+{
+	KeyBindings::BindingTable table;
+	VirtualKeyParser::KeyChord recenter, toggle;
+	CHECK(VirtualKeyParser::ParseChord("E", recenter));
+	CHECK(VirtualKeyParser::ParseChord("CTRL+SHIFT+C", toggle));
+	table.Add(recenter, KeyBindings::Action::Recenter);
+	KeyBindings::KeyStateTracker tracker;
+	static const WORD keys[] = { 'E', 'W', VK_LCONTROL, VK_LSHIFT, 'C', VK_SPACE, VK_F24, VK_NUMPAD5 };
+
+	uint32_t matches = 0;
+	size_t nameLength = 0;
+	{
+		CountAllocations counter;
+		for (uint32_t i = 0; i < STEPS; i++)
+		{
+			WORD vk = keys[i % 8];
+			bool down = (i / 8) % 2 == 0;
+			bool wasDown = tracker.OnKeyEvent(vk, down);
+			if (down && !wasDown && table.Match(tracker.State(), vk) != KeyBindings::Action::None)
+				matches++;
+			nameLength += strlen(VirtualKeyParser::GetKeyNameFromVK(vk));
+			nameLength += strlen(VirtualKeyParser::GetChordName(i & 1 ? recenter : toggle).c_str());
+			nameLength += VirtualKeyParser::ParseKeyName("numpad5") == VK_NUMPAD5 ? 1 : 0;
+		}
+		CHECK(counter.Count() == 0);
+	}
+	CHECK(matches > 0);
+	CHECK(nameLength > 0);
+}
@@ -0,0 +1,136 @@
+// Check.h
+// Minimal test and benchmark harness for SwimMouseCursor.Tests
+//  - TEST(name) { ... }:  registers a test; all tests run in file/registration order
+//  - CHECK(expr):         records a failure with file and line and carries on with the test
+//  - BENCH(name) { ... }: registers a benchmark, run only with --bench; the body calls Measure()
+//  - Measure(name, fn):   calls fn in doubling batches until BENCH_MIN_MS have passed and records ns per call,
+//                         in the same JSON shape as SwimMouseCursor.exe --benchmark
+//  - TempPath(name):      a file in the user's temp folder, for tests that write files
+
+#pragma once
+#include <windows.h>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace Check
+{
+
+	struct Registered
+	{
+		const char* name;
+		void (*fn)();
+	};
+
+	struct BenchResult
+	{
+		std::string name;
+		uint64_t calls;
+		double nsPerCall;
+	};
+
+	inline std::vector<Registered>& Tests()
+	{
+		static std::vector<Registered> tests;
+		return tests;
+	}
+
+	inline std::vector<Registered>& Benches()
+	{
+		static std::vector<Registered> benches;
+		return benches;
+	}
+
+	inline std::vector<BenchResult>& Results()
+	{
+		static std::vector<BenchResult> results;
+		return results;
+	}
+
+	inline uint64_t checks = 0;
+	inline uint64_t failures = 0;
+
+	inline bool Record(bool ok, const char* expr, const char* file, int line)
+	{
+		checks++;
+		if (!ok)
+		{
+			failures++;
+			fprintf(stderr, "[!] %s(%d): CHECK(%s) failed\n", file, line, expr);
+		}
+		return ok;
+	}
+
+	struct AutoRegister
+	{
+		AutoRegister(std::vector<Registered>& list, const char* name, void (*fn)()) { list.push_back({ name, fn }); }
+	};
+
+	inline volatile uintptr_t sink; // Keeps measured results alive through the optimizer
+	constexpr DWORD BENCH_MIN_MS = 200;
+
+	inline uint64_t Qpc()
+	{
+		LARGE_INTEGER now;
+		QueryPerformanceCounter(&now);
+		return (uint64_t)now.QuadPart;
+	}
+
+	inline double QpcToNs(uint64_t ticks)
+	{
+		LARGE_INTEGER freq;
+		QueryPerformanceFrequency(&freq);
+		return ticks * 1e9 / freq.QuadPart;
+	}
+
+	template <class Fn>
+	void Measure(const char* name, Fn fn)
+	{
+		LARGE_INTEGER freq;
+		QueryPerformanceFrequency(&freq);
+		uint64_t start = Qpc(), now;
+		uint64_t calls = 0, batch = 1;
+		do
+		{
+			for (uint64_t i = 0; i < batch; i++)
+				sink = sink + (uintptr_t)fn();
+			calls += batch;
+			if (batch < (1u << 20)) batch *= 2;
+			now = Qpc();
+		} while ((now - start) * 1000 < (uint64_t)BENCH_MIN_MS * freq.QuadPart);
+
+		Results().push_back({ name, calls, QpcToNs(now - start) / calls });
+		printf("[*] %-48s %12.1f ns/call (%llu calls)\n", name, Results().back().nsPerCall, (unsigned long long)calls);
+	}
+
+	inline std::wstring TempPath(const wchar_t* name)
+	{
+		wchar_t dir[MAX_PATH];
+		DWORD length = GetTempPathW(MAX_PATH, dir);
+		return std::wstring(dir, length < MAX_PATH ? length : 0) + name;
+	}
+
+	// A figure that isn't a per-call time (latencies, percentiles); recorded in the same JSON list
+	inline void Report(const char* name, double value, const char* unit)
+	{
+		Results().push_back({ name, 1, value });
+		printf("[*] %-48s %12.1f %s\n", name, value, unit);
+	}
+
+}
+
+#define CHECK_CONCAT2(a, b) a##b
+#define CHECK_CONCAT(a, b) CHECK_CONCAT2(a, b)
+
+#define TEST(name) \
+	static void CHECK_CONCAT(Test_, name)(); \
+	static Check::AutoRegister CHECK_CONCAT(testRegistration_, name)(Check::Tests(), #name, CHECK_CONCAT(Test_, name)); \
+	static void CHECK_CONCAT(Test_, name)()
+
+#define BENCH(name) \
+	static void CHECK_CONCAT(Bench_, name)(); \
+	static Check::AutoRegister CHECK_CONCAT(benchRegistration_, name)(Check::Benches(), #name, CHECK_CONCAT(Bench_, name)); \
+	static void CHECK_CONCAT(Bench_, name)()
+
+#define CHECK(expr) Check::Record((expr) ? true : false, #expr, __FILE__, __LINE__)
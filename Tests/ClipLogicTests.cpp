@@ -0,0 +1,203 @@
+// ClipLogicTests.cpp
+// The tick's clip decisions once the clip is in place (held, verified, re-applied after a reset) and the reset
+// bookkeeping of ClipWatch: counting, rate limit, unclipped time
+
+#include <windows.h>
+#include "Check.h"
+#include "ScriptedWorld.h"
+#include "../ClipLogic.h"
+#include "../ClipWatch.h"
+
+using FlightRecorder::Action;
+
+static ClipLogic::Decision Step(ClipLogic::State& state, ScriptedWorld& live, uint8_t* asked = nullptr)
+{
+	ClipLogic::ObservingWorld<ScriptedWorld> world{ live };
+	ClipLogic::Decision d = ClipLogic::Tick(state, world);
+	if (asked) *asked = world.seen.asked;
+	return d;
+}
+
+static ScriptedWorld TargetInFront()
+{
+	ScriptedWorld live;
+	live.foreground = (HWND)(uintptr_t)0x10010;
+	live.target = true;
+	return live;
+}
+
+TEST(ClipLogic_HeldUntilVerified)
+{
+	ClipLogic::State state;
+	ScriptedWorld live = TargetInFront();
+	ClipLogic::Decision d = Step(state, live);
+	CHECK(d.action == Action::Applied && d.op == ClipLogic::ClipOp::Apply && d.changed);
+
+	// No ClipCursor and no GetClipCursor on the ticks in between
+	bool allHeld = true;
+	for (int i = 0; i < 100; i++)
+	{
+		uint8_t asked = 0;
+		d = Step(state, live, &asked);
+		allHeld = allHeld && d.action == Action::Held && d.op == ClipLogic::ClipOp::None && !d.verified &&
+			!(asked & ClipLogic::CURRENT_CLIP) && d.eligible;
+	}
+	CHECK(allHeld);
+
+	// Within the tolerance the window hasn't moved; past it the clip follows
+	live.clip.right += ClipLogic::CLIP_TOLERANCE;
+	CHECK(Step(state, live).action == Action::Held);
+	live.clip.right += 1;
+	d = Step(state, live);
+	CHECK(d.action == Action::Applied && d.changed);
+}
+
+TEST(ClipLogic_VerifiedAndReapplied)
+{
+	ClipLogic::State state;
+	ScriptedWorld live = TargetInFront();
+	Step(state, live);
+
+	live.verifyDue = true;
+	ClipLogic::Decision d = Step(state, live);
+	CHECK(d.action == Action::Held && d.verified && !d.externalReset && d.op == ClipLogic::ClipOp::None);
+
+	live.currentClip = RECT{ 0, 0, 3840, 2160 };
+	d = Step(state, live);
+	CHECK(d.action == Action::Reapplied && d.verified && d.externalReset);
+	CHECK(d.op == ClipLogic::ClipOp::Apply && !d.changed);
+	CHECK(d.clip.right == 1920 && d.clip.bottom == 1080);
+
+	// No clip at all counts as reset too
+	live.currentClip = RECT{};
+	CHECK(Step(state, live).externalReset);
+
+	// Once it's back, verification finds it intact again
+	live.currentClip = live.clip;
+	CHECK(!Step(state, live).externalReset);
+}
+
+// The system gives a process that isn't DPI aware a scaled clip; that must not read as a reset on every check
+TEST(ClipLogic_VerifiesAgainstReadBack)
+{
+	ClipLogic::State state;
+	ScriptedWorld live = TargetInFront();
+	Step(state, live);
+	RECT scaled{ 0, 0, 1536, 864 };
+	ClipLogic::ClipReadBack(state, scaled);
+	live.currentClip = scaled;
+	live.verifyDue = true;
+
+	int resets = 0;
+	for (int i = 0; i < 100; i++)
+		resets += Step(state, live).externalReset ? 1 : 0;
+	CHECK(resets == 0);
+
+	// What we asked for is no longer what an intact clip looks like
+	live.currentClip = live.clip;
+	CHECK(Step(state, live).externalReset);
+
+	// A read-back after the clip was dropped is ignored
+	live.foreground = nullptr;
+	CHECK(Step(state, live).action == Action::Released);
+	ClipLogic::ClipReadBack(state, RECT{ 1, 2, 3, 4 });
+	CHECK(state.effectiveClip.right == live.clip.right);
+}
+
+static uint64_t QpcPerMs()
+{
+	LARGE_INTEGER freq;
+	QueryPerformanceFrequency(&freq);
+	return (uint64_t)freq.QuadPart / 1000;
+}
+
+TEST(ClipWatch_ResetCountedOnce)
+{
+	const uint64_t ms = QpcPerMs(), start = 1000 * ms;
+	ClipWatch::Watch watch;
+	ClipWatch::ResetInfo info;
+	watch.Intact(start);
+
+	CHECK(watch.Reset(start + 100 * ms, info));
+	CHECK(info.trigger == ClipWatch::Trigger::Poll && info.sinceTriggerQpc == 0);
+
+	// Still outstanding (say the rate limit held the re-assertion back): found again, not counted again
+	CHECK(watch.VerifyDue(100, start + 101 * ms)); // Outstanding is verified every tick
+	CHECK(!watch.Reset(start + 110 * ms, info));
+	CHECK(!watch.Reset(start + 120 * ms, info));
+	CHECK(watch.GetStats().resets.load() == 1);
+
+	watch.Reasserted(start + 130 * ms);
+	watch.Notify(ClipWatch::Trigger::Foreground, start + 200 * ms);
+	CHECK(watch.Reset(start + 203 * ms, info));
+	CHECK(info.trigger == ClipWatch::Trigger::Foreground && info.sinceTriggerQpc == 3 * ms);
+	CHECK(watch.GetStats().resets.load() == 2);
+	CHECK(watch.GetStats().resetsByTrigger[(size_t)ClipWatch::Trigger::Poll].load() == 1);
+	CHECK(watch.GetStats().resetsByTrigger[(size_t)ClipWatch::Trigger::Foreground].load() == 1);
+}
+
+TEST(ClipWatch_UnclippedTime)
+{
+	const uint64_t ms = QpcPerMs(), start = 1000 * ms;
+	ClipWatch::Watch watch;
+	ClipWatch::ResetInfo info;
+
+	// Found by the periodic check: unclipped since the last time it was known good
+	watch.Intact(start);
+	watch.Reset(start + 100 * ms, info);
+	watch.Reasserted(start + 150 * ms);
+	CHECK(watch.GetStats().unclippedQpc.load() == 150 * ms);
+
+	// After an event: unclipped since the event, which came after the last good check
+	watch.Notify(ClipWatch::Trigger::TargetMoved, start + 400 * ms);
+	watch.Reset(start + 402 * ms, info);
+	watch.Reasserted(start + 405 * ms);
+	CHECK(watch.GetStats().unclippedQpc.load() == 155 * ms);
+
+	// Re-applied without a reset (the window moved): nothing added
+	watch.Reasserted(start + 500 * ms);
+	CHECK(watch.GetStats().unclippedQpc.load() == 155 * ms);
+}
+
+// Called every 10 ms tick, the bucket refills by a fifth of a token per call; the fractions must add up
+TEST(ClipWatch_RateLimit)
+{
+	const uint64_t ms = QpcPerMs(), start = 1000 * ms;
+	ClipWatch::Watch watch;
+	uint32_t allowed = 0, calls = 0;
+	for (uint64_t t = 0; t < 2000; t += 10, calls++)
+		allowed += watch.AllowReassert(start + t * ms) ? 1 : 0;
+
+	// The burst, then REASSERTS_PER_SEC for the rest of the 2 s
+	uint32_t expected = ClipWatch::REASSERT_BURST + 2 * ClipWatch::REASSERTS_PER_SEC;
+	CHECK(allowed >= expected - 1 && allowed <= expected);
+	CHECK(watch.GetStats().reassertsDeferred.load() == calls - allowed);
+
+	// A quiet second fills the bucket back up to the burst, no further
+	uint32_t burst = 0;
+	for (int i = 0; i < 10; i++)
+		burst += watch.AllowReassert(start + 4000 * ms) ? 1 : 0;
+	CHECK(burst == ClipWatch::REASSERT_BURST);
+}
+
+TEST(ClipWatch_Clear)
+{
+	const uint64_t ms = QpcPerMs(), start = 1000 * ms;
+	ClipWatch::Watch watch;
+	ClipWatch::ResetInfo info;
+	watch.Intact(start);
+	CHECK(watch.VerifyDue(100, start + 10 * ms)); // Never checked yet
+	CHECK(!watch.VerifyDue(100, start + 20 * ms));
+
+	watch.Notify(ClipWatch::Trigger::CursorOutside, start + 30 * ms);
+	CHECK(watch.Pending());
+	watch.Reset(start + 31 * ms, info);
+
+	// The target went away: no pending check, no outstanding reset, and the next reset is a new one
+	watch.Clear();
+	CHECK(!watch.Pending());
+	CHECK(!watch.VerifyDue(100, start + 40 * ms));
+	CHECK(watch.Reset(start + 200 * ms, info));
+	CHECK(info.trigger == ClipWatch::Trigger::Poll);
+	CHECK(watch.GetStats().resets.load() == 2);
+}
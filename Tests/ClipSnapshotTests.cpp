@@ -0,0 +1,93 @@
+// ClipSnapshotTests.cpp
+// Seqlock snapshot read by the keyboard hook: values, generation, and no torn reads under a concurrent writer
+
+#include <windows.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include "Check.h"
+#include "../ClipSnapshot.h"
+
+TEST(ClipSnapshot_PublishAndRead)
+{
+	ClipSnapshot snapshot;
+	ClipTargetState state = snapshot.Read();
+	CHECK(state.target == nullptr);
+	CHECK(!state.eligible);
+	CHECK(state.generation == 0);
+
+	HWND target = (HWND)(uintptr_t)0x1234;
+	snapshot.Publish(target, true, POINT{ 960, 540 });
+	state = snapshot.Read();
+	CHECK(state.target == target);
+	CHECK(state.eligible);
+	CHECK(state.center.x == 960 && state.center.y == 540);
+	CHECK(state.generation == 1);
+
+	// Republishing the same verdict is a no-op, so readers have nothing to retry on
+	snapshot.Publish(target, true, POINT{ 960, 540 });
+	CHECK(snapshot.Read().generation == 1);
+
+	snapshot.Publish(target, false, POINT{ 960, 540 });
+	state = snapshot.Read();
+	CHECK(!state.eligible);
+	CHECK(state.generation == 2);
+}
+
+// The writer publishes states whose fields all derive from one counter; a reader that ever sees fields
+// from two different publishes has read a torn snapshot
+TEST(ClipSnapshot_NoTornReads)
+{
+	const uint32_t PUBLISHES = 2000000;
+	const unsigned READERS = 3;
+	ClipSnapshot snapshot;
+	std::atomic<bool> done{ false };
+	std::atomic<unsigned> started{ 0 };
+	std::atomic<uint64_t> torn{ 0 }, reads{ 0 }, backwards{ 0 };
+
+	std::vector<std::thread> readers;
+	for (unsigned r = 0; r < READERS; r++)
+	{
+		readers.emplace_back([&]
+		{
+			uint64_t myReads = 0;
+			uint32_t lastGeneration = 0;
+			started.fetch_add(1);
+			while (!done.load(std::memory_order_relaxed))
+			{
+				ClipTargetState state = snapshot.Read();
+				LONG i = (LONG)(uintptr_t)state.target;
+				if (state.center.x != i || state.center.y != -i || state.eligible != ((i & 1) != 0))
+					torn.fetch_add(1, std::memory_order_relaxed);
+				if (state.generation < lastGeneration)
+					backwards.fetch_add(1, std::memory_order_relaxed);
+				lastGeneration = state.generation;
+				myReads++;
+			}
+			reads.fetch_add(myReads, std::memory_order_relaxed);
+		});
+	}
+
+	while (started.load() < READERS)
+		std::this_thread::yield();
+	for (uint32_t i = 1; i <= PUBLISHES; i++)
+		snapshot.Publish((HWND)(uintptr_t)i, (i & 1) != 0, POINT{ (LONG)i, -(LONG)i });
+	done.store(true);
+	for (std::thread& reader : readers)
+		reader.join();
+
+	CHECK(torn.load() == 0);
+	CHECK(backwards.load() == 0);
+	CHECK(reads.load() > 0);
+	CHECK(snapshot.Read().generation == PUBLISHES);
+}
+
+BENCH(ClipSnapshot)
+{
+	ClipSnapshot snapshot;
+	snapshot.Publish((HWND)(uintptr_t)0x1234, true, POINT{ 960, 540 });
+	Check::Measure("ClipSnapshot::Read", [&] { return snapshot.Read().center.x; });
+	Check::Measure("ClipSnapshot::Publish (unchanged)", [&] { snapshot.Publish((HWND)(uintptr_t)0x1234, true, POINT{ 960, 540 }); return 0; });
+	LONG x = 0;
+	Check::Measure("ClipSnapshot::Publish (changed)", [&] { snapshot.Publish((HWND)(uintptr_t)0x1234, true, POINT{ ++x, 540 }); return 0; });
+}
@@ -0,0 +1,411 @@
+// ConfigTests.cpp
+// config.txt parsing: every setting, the legacy one-key file, profile sections, rejected lines, Print() output
+// loading back, a mutation fuzz loop, and parse cost. Config::Store: snapshot swaps under a concurrent writer.
+
+#include <windows.h>
+#include <atomic>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <thread>
+#include "Check.h"
+#include "../Config.h"
+
+static const char SAMPLE_CONFIG[] =
+	"; SwimMouseCursor settings\r\n"
+	"recenter_key=CTRL+R\r\n"
+	"toggle_hotkey=ALT+F9\r\n"
+	"recenter_interval_ms=150\r\n"
+	"poll_ms=5\r\n"
+	"target_exe=Minecraft.Windows.exe\r\n"
+	"occlusion_threshold=75\r\n"
+	"clip_area=window\r\n"
+	"input_backend=rawinput\r\n"
+	"log_level=debug\r\n"
+	"log_file=logs\\SwimMouseCursor.log\r\n"
+	"log_file_size_mb=8\r\n"
+	"log_file_count=5\r\n"
+	"event_log=events.bin\r\n"
+	"flight_recorder=recorder.bin\r\n"
+	"zone_trace=zones2.json\r\n"
+	"trace=trace.bin\r\n"
+	"control_pipe=off\r\n"
+	"stats_page=off\r\n"
+	"escape_detector=off\r\n"
+	"clip_verify_ms=250\r\n"
+	"metrics_file=metrics.prom\r\n"
+	"metrics_interval_ms=30000\r\n"
+	"\r\n"
+	"[Minecraft.WindowsBeta.exe]\r\n"
+	"recenter_key=I\r\n"
+	"clip_area=client\r\n"
+	"\r\n"
+	"# Java edition\r\n"
+	"[javaw.exe]\r\n"
+	"poll_ms=16\r\n";
+
+static std::string PrintToString(const Config::Settings& settings)
+{
+	FILE* out = tmpfile();
+	if (!CHECK(out != nullptr))
+		return std::string();
+	Config::Print(settings, out);
+	rewind(out);
+	std::string text;
+	char buffer[512];
+	size_t read;
+	while ((read = fread(buffer, 1, sizeof(buffer), out)) > 0)
+		text.append(buffer, read);
+	fclose(out);
+	return text;
+}
+
+static bool IsChord(const VirtualKeyParser::KeyChord& chord, const char* text)
+{
+	VirtualKeyParser::KeyChord expected;
+	return VirtualKeyParser::ParseChord(text, expected) && Config::SameChord(chord, expected);
+}
+
+TEST(Config_Defaults)
+{
+	Config::Settings settings;
+	Config::ParseReport report;
+	Config::Parse("", settings, report);
+	CHECK(report.issueCount == 0);
+	CHECK(!report.legacyKeyLine);
+	CHECK(IsChord(settings.defaults.recenterChord, "E"));
+	CHECK(IsChord(settings.toggleChord, "CTRL+SHIFT+C"));
+	CHECK(settings.defaults.pollMs == 10);
+	CHECK(settings.targetExe == Config::DEFAULT_TARGET_EXE);
+	CHECK(settings.profiles.empty());
+	CHECK(&settings.TargetProfile() == &settings.defaults);
+}
+
+// Files from before key=value are a single key name, which must keep working
+TEST(Config_LegacyKeyLine)
+{
+	Config::Settings settings;
+	Config::ParseReport report;
+	Config::Parse("\xEF\xBB\xBFR\r\n", settings, report);
+	CHECK(report.legacyKeyLine);
+	CHECK(report.issueCount == 0);
+	CHECK(IsChord(settings.defaults.recenterChord, "R"));
+
+	Config::Parse("F5\npoll_ms=20\n", settings, report);
+	CHECK(report.legacyKeyLine);
+	CHECK(IsChord(settings.defaults.recenterChord, "F5"));
+	CHECK(settings.defaults.pollMs == 20);
+}
+
+TEST(Config_EverySetting)
+{
+	Config::Settings s;
+	Config::ParseReport report;
+	Config::Parse(SAMPLE_CONFIG, s, report);
+	CHECK(report.issueCount == 0);
+	CHECK(IsChord(s.defaults.recenterChord, "CTRL+R"));
+	CHECK(IsChord(s.toggleChord, "ALT+F9"));
+	CHECK(s.recenterIntervalMs == 150);
+	CHECK(s.defaults.pollMs == 5);
+	CHECK(s.defaults.occlusionThresholdPercent == 75);
+	CHECK(s.defaults.clipArea == Config::ClipArea::Window);
+	CHECK(s.inputBackend == Config::InputBackend::RawInput);
+	CHECK(s.logLevel == LogLevel::Debug);
+	CHECK(s.logFile == L"logs\\SwimMouseCursor.log");
+	CHECK(s.logFileSizeMb == 8 && s.logFileCount == 5);
+	CHECK(s.eventLog == L"events.bin");
+	CHECK(s.flightRecorderPath == L"recorder.bin");
+	CHECK(s.zoneTracePath == L"zones2.json");
+	CHECK(s.trace == L"trace.bin");
+	CHECK(!s.controlPipe && !s.statsPage && !s.escapeDetector);
+	CHECK(s.clipVerifyMs == 250);
+	CHECK(s.metricsFile == L"metrics.prom");
+	CHECK(s.metricsIntervalMs == 30000);
+}
+
+TEST(Config_ProfileSections)
+{
+	Config::Settings s;
+	Config::ParseReport report;
+	Config::Parse(SAMPLE_CONFIG, s, report);
+	if (!CHECK(s.profiles.size() == 2))
+		return;
+
+	// Whatever a section leaves out comes from the top-level lines
+	const Config::Profile* beta = s.FindProfile(L"minecraft.windowsbeta.exe");
+	if (CHECK(beta != nullptr))
+	{
+		CHECK(IsChord(beta->recenterChord, "I"));
+		CHECK(beta->clipArea == Config::ClipArea::Client);
+		CHECK(beta->pollMs == 5);
+		CHECK(beta->occlusionThresholdPercent == 75);
+	}
+	const Config::Profile* java = s.FindProfile(L"javaw.exe");
+	if (CHECK(java != nullptr))
+	{
+		CHECK(java->pollMs == 16);
+		CHECK(IsChord(java->recenterChord, "CTRL+R"));
+	}
+	CHECK(s.FindProfile(L"notepad.exe") == nullptr);
+	CHECK(&s.TargetProfile() == &s.defaults);
+
+	// A repeated section continues the first one, and a section for target_exe becomes the target profile
+	Config::Parse("target_exe=javaw.exe\n[javaw.exe]\npoll_ms=16\n[other.exe]\n[JAVAW.EXE]\nclip_area=window\n", s, report);
+	CHECK(report.issueCount == 0);
+	CHECK(s.profiles.size() == 2);
+	CHECK(s.TargetProfile().pollMs == 16);
+	CHECK(s.TargetProfile().clipArea == Config::ClipArea::Window);
+}
+
+TEST(Config_RejectedLines)
+{
+	Config::Settings s;
+	Config::ParseReport report;
+	Config::Parse(
+		"poll_ms=0\n"               // 1: out of range
+		"poll_ms=12ms\n"            // 2: not a number
+		"colour=blue\n"             // 3: unknown setting
+		"recenter_key=CTRL+NOPE\n"  // 4: unknown key
+		"toggle_hotkey=CTRL\n"      // 5: hotkeys need a non-modifier key
+		"just words\n"              // 6: not the first line, so not a legacy key
+		"[]\n"                      // 7: section without a name
+		"[game.exe]\n"
+		"log_level=debug\n",        // 9: not a per-profile setting
+		s, report);
+	CHECK(!report.legacyKeyLine);
+	if (CHECK(report.issueCount == 8))
+	{
+		static const unsigned lines[] = { 1, 2, 3, 4, 5, 6, 7, 9 };
+		for (size_t i = 0; i < 8; i++)
+			CHECK(report.issues[i].line == lines[i]);
+	}
+	CHECK(s.defaults.pollMs == 10);
+	CHECK(IsChord(s.defaults.recenterChord, "E"));
+	CHECK(IsChord(s.toggleChord, "CTRL+SHIFT+C"));
+	CHECK(s.logLevel == LogLevel::Info);
+
+	// Issues are capped, however bad the file
+	std::string junk;
+	for (int i = 0; i < 100; i++)
+		junk += "nonsense=1\n";
+	Config::Parse(junk, s, report);
+	CHECK(report.issueCount == Config::ParseReport::MAX_ISSUES);
+}
+
+TEST(Config_Overrides)
+{
+	Config::Settings s;
+	Config::ParseReport report;
+	Config::Parse("poll_ms=5\n[game.exe]\nclip_area=window\n", s, report, "poll_ms=7\nstats_page=off\nnope");
+	CHECK(s.defaults.pollMs == 7);
+	CHECK(!s.statsPage);
+	CHECK(report.issueCount == 1);
+	CHECK(report.issues[0].line == 0);
+	// Overrides are top level, and sections still inherit what they set
+	const Config::Profile* game = s.FindProfile(L"game.exe");
+	CHECK(game && game->pollMs == 7 && game->clipArea == Config::ClipArea::Window);
+}
+
+TEST(Config_Utf8Paths)
+{
+	Config::Settings s;
+	Config::ParseReport report;
+	Config::Parse("log_file=C:\\Users\\J\xC3\xB6rg\\log.txt\ntarget_exe=\xE3\x82\xB2\xE3\x83\xBC\xE3\x83\xA0.exe\n", s, report);
+	CHECK(report.issueCount == 0);
+	CHECK(s.logFile == L"C:\\Users\\J\u00F6rg\\log.txt");
+	CHECK(s.targetExe == L"\u30B2\u30FC\u30E0.exe");
+	CHECK(Config::NarrowPath(s.targetExe) == "\xE3\x82\xB2\xE3\x83\xBC\xE3\x83\xA0.exe");
+
+	// Not UTF-8: taken to be the ANSI code page rather than dropped
+	Config::Parse("log_file=J\xF6rg.log\n", s, report);
+	CHECK(s.logFile.size() == 8);
+}
+
+// --check-config prints every effective value; that output must load back to the same settings
+TEST(Config_PrintLoadsBack)
+{
+	Config::Settings s, reloaded;
+	Config::ParseReport report;
+	Config::Parse(SAMPLE_CONFIG, s, report);
+	std::string printed = PrintToString(s);
+	Config::Parse(printed, reloaded, report);
+	CHECK(report.issueCount == 0);
+	CHECK(PrintToString(reloaded) == printed);
+
+	Config::Settings defaults;
+	Config::Parse("", defaults, report);
+	std::string printedDefaults = PrintToString(defaults);
+	Config::Parse(printedDefaults, reloaded, report);
+	CHECK(report.issueCount == 0);
+	CHECK(PrintToString(reloaded) == printedDefaults);
+}
+
+// Deterministic mutations of the sample file: the parser must never crash, never report more than it has room
+// for, and always leave settings inside their documented ranges
+TEST(Config_Fuzz)
+{
+	const int ITERATIONS = 20000;
+	static const char alphabet[] = "=[]+\n\r;# \t0123456789ABCDEFabcdef_.\xC3\xB6\xEF\xBB\xBF";
+	uint64_t rng = 0x9E3779B97F4A7C15ull;
+	auto next = [&]
+	{
+		rng ^= rng << 13;
+		rng ^= rng >> 7;
+		rng ^= rng << 17;
+		return rng;
+	};
+
+	uint64_t violations = 0;
+	Config::Settings s;
+	Config::ParseReport report;
+	for (int i = 0; i < ITERATIONS; i++)
+	{
+		std::string text(SAMPLE_CONFIG);
+		int mutations = 1 + (int)(next() % 8);
+		for (int m = 0; m < mutations && !text.empty(); m++)
+		{
+			size_t at = (size_t)(next() % text.size());
+			switch (next() % 4)
+			{
+				case 0: text[at] = alphabet[next() % (sizeof(alphabet) - 1)]; break;
+				case 1: text.insert(at, 1, alphabet[next() % (sizeof(alphabet) - 1)]); break;
+				case 2: text.erase(at, 1 + (size_t)(next() % 16)); break;
+				case 3: text.resize(at); break;
+			}
+		}
+
+		Config::Parse(text, s, report);
+		bool ok = report.issueCount <= Config::ParseReport::MAX_ISSUES &&
+			s.defaults.pollMs >= 1 && s.defaults.pollMs <= 1000 && s.defaults.occlusionThresholdPercent <= 100 &&
+			s.defaults.recenterChord.count >= 1 && s.defaults.recenterChord.count <= VirtualKeyParser::MAX_CHORD_KEYS &&
+			!s.targetExe.empty() && !s.flightRecorderPath.empty();
+		for (const Config::Profile& profile : s.profiles)
+			ok = ok && !profile.exe.empty() && profile.pollMs >= 1 && profile.recenterChord.count >= 1;
+		if (!ok)
+		{
+			if (!violations)
+				fprintf(stderr, "    first violating input: \"%s\"\n", text.c_str());
+			violations++;
+		}
+	}
+	CHECK(violations == 0);
+}
+
+TEST(ConfigStore_OfferAndInstall)
+{
+	Config::Store store;
+	CHECK(store.Current().defaults.pollMs == 10);
+	CHECK(store.Install() == nullptr);
+
+	auto first = std::make_unique<Config::Snapshot>();
+	first->settings.defaults.pollMs = 20;
+	auto second = std::make_unique<Config::Snapshot>();
+	second->settings.defaults.pollMs = 30;
+	store.Offer(std::move(first));
+	store.Offer(std::move(second)); // Replaces the offer nobody has read yet
+	CHECK(store.Current().defaults.pollMs == 10);
+
+	std::unique_ptr<const Config::Snapshot> replaced = store.Install();
+	CHECK(replaced && replaced->settings.defaults.pollMs == 10);
+	CHECK(store.Current().defaults.pollMs == 30);
+	CHECK(store.Install() == nullptr);
+}
+
+// A writer thread offers snapshots whose fields all derive from one counter, as fast as it can, while this
+// thread (the single reader, like the main loop) installs and reads them. Every snapshot seen must be whole
+// and newer than the one before.
+TEST(ConfigStore_NoTornSnapshots)
+{
+	const uint32_t OFFERS = 20000;
+	Config::Store store;
+	std::atomic<bool> done{ false };
+	std::thread writer([&]
+	{
+		for (uint32_t i = 1; i <= OFFERS; i++)
+		{
+			auto next = std::make_unique<Config::Snapshot>();
+			next->detectedQpc = i;
+			next->settings.defaults.pollMs = i;
+			next->settings.recenterIntervalMs = i;
+			next->settings.logFile = std::to_wstring(i);
+			next->settings.profiles.emplace_back();
+			next->settings.profiles.back().exe = L"game.exe";
+			next->settings.profiles.back().pollMs = i;
+			store.Offer(std::move(next));
+		}
+		done.store(true);
+	});
+
+	uint64_t installs = 0, torn = 0, backwards = 0, last = 0;
+	for (;;)
+	{
+		bool finished = done.load();
+		if (store.Install())
+			installs++;
+
+		const Config::Snapshot& snapshot = store.CurrentSnapshot();
+		const Config::Settings& s = snapshot.settings;
+		uint64_t i = snapshot.detectedQpc;
+		if (i && (s.defaults.pollMs != i || s.recenterIntervalMs != i || s.logFile != std::to_wstring(i) ||
+			s.profiles.size() != 1 || s.profiles[0].pollMs != i))
+			torn++;
+		if (i < last)
+			backwards++;
+		last = i;
+		if (finished && store.Install() == nullptr)
+			break;
+	}
+	writer.join();
+
+	CHECK(torn == 0);
+	CHECK(backwards == 0);
+	CHECK(installs > 0);
+	CHECK(store.CurrentSnapshot().detectedQpc == OFFERS); // The last offer always gets installed
+}
+
+BENCH(Config)
+{
+	Config::Settings s;
+	Config::ParseReport report;
+	Check::Measure("Config::Parse (sample file, 31 lines)", [&] { Config::Parse(SAMPLE_CONFIG, s, report); return s.defaults.pollMs; });
+	Check::Measure("Config::Parse (legacy one-key file)", [&] { Config::Parse("E\n", s, report); return s.defaults.pollMs; });
+
+	// A reload as the watcher thread and the loop do it, minus the file read and the wait for the next tick
+	Config::Store store;
+	Check::Measure("Config reload (parse, Offer, Install)", [&]
+	{
+		auto next = std::make_unique<Config::Snapshot>();
+		Config::Parse(SAMPLE_CONFIG, next->settings, next->report);
+		store.Offer(std::move(next));
+		return store.Install() != nullptr;
+	});
+	Check::Measure("Config::Store::Current", [&] { return store.Current().defaults.pollMs; });
+
+	// Offer on another thread to Install here, with this thread checking as fast as it can. The loop checks
+	// once per tick, so a real reload takes up to poll_ms longer than this.
+	const int RELOADS = 2000;
+	std::atomic<uint64_t> offeredQpc{ 0 };
+	std::atomic<int> installed{ 0 };
+	double totalUs = 0;
+	std::thread watcher([&]
+	{
+		for (int i = 0; i < RELOADS; i++)
+		{
+			while (installed.load() != i) // One offer at a time, so none is replaced before it's installed
+				std::this_thread::yield();
+			auto next = std::make_unique<Config::Snapshot>();
+			Config::Parse(SAMPLE_CONFIG, next->settings, next->report);
+			offeredQpc.store(Check::Qpc());
+			store.Offer(std::move(next));
+		}
+	});
+	for (int i = 0; i < RELOADS; i++)
+	{
+		while (!store.Install())
+			std::this_thread::yield();
+		totalUs += Check::QpcToNs(Check::Qpc() - offeredQpc.load()) / 1000;
+		installed.store(i + 1);
+	}
+	watcher.join();
+	Check::Report("Config reload: Offer to Install across threads", totalUs / RELOADS, "us");
+}
@@ -0,0 +1,163 @@
+// ControlPipeTests.cpp
+// Control pipe: request names, and the framing on a loopback server with a stub handler (reply sizes, unknown
+// requests, malformed frames, idle and stalled clients)
+
+#include <windows.h>
+#include <cstdio>
+#include <cstring>
+#include "Check.h"
+#include "../ControlPipe.h"
+
+using ControlPipe::Request;
+using ControlPipe::Status;
+
+TEST(ControlPipe_ParseRequest)
+{
+	for (uint8_t i = 1; i < (uint8_t)Request::Count; i++)
+	{
+		wchar_t name[16];
+		size_t j = 0;
+		for (const char* c = ControlPipe::RequestName(i); *c; c++)
+			name[j++] = (wchar_t)*c;
+		name[j] = 0;
+		CHECK(ControlPipe::ParseRequest(name) == i);
+	}
+	CHECK(ControlPipe::ParseRequest(L"status") == (uint8_t)Request::Status);
+	CHECK(ControlPipe::ParseRequest(L"stats") == (uint8_t)Request::Stats);
+	CHECK(ControlPipe::ParseRequest(L"") == 0);
+	CHECK(ControlPipe::ParseRequest(L"stat") == 0);
+	CHECK(ControlPipe::ParseRequest(L"statuses") == 0);
+	CHECK(ControlPipe::ParseRequest(L"STATUS") == 0); // Names are exact
+	CHECK(strcmp(ControlPipe::RequestName(0), "?") == 0);
+	CHECK(strcmp(ControlPipe::RequestName((uint8_t)Request::Count), "?") == 0);
+}
+
+// Status and Stats fill their reply structs, Reload fails, Toggle claims more than MAX_PAYLOAD
+static Status StubHandler(Request request, uint8_t* reply, uint32_t& replySize)
+{
+	switch (request)
+	{
+		case Request::Status:
+		{
+			ControlPipe::StatusReply status{};
+			status.target = 0x10010;
+			status.centerX = -960;
+			status.centerY = 540;
+			status.enabled = 1;
+			status.eligible = 1;
+			memcpy(reply, &status, sizeof(status));
+			replySize = sizeof(status);
+			return Status::Ok;
+		}
+		case Request::Stats:
+		{
+			ControlPipe::StatsReply stats{};
+			stats.ticks = 123456789;
+			stats.keyEvents = 42;
+			memcpy(reply, &stats, sizeof(stats));
+			replySize = sizeof(stats);
+			return Status::Ok;
+		}
+		case Request::Reload:
+			replySize = 8;
+			return Status::Failed;
+		default:
+			replySize = ControlPipe::MAX_PAYLOAD + 1;
+			return Status::Ok;
+	}
+}
+
+// Raw frame bytes, for what Transact() never sends
+static bool WriteRaw(HANDLE pipe, const void* data, DWORD size)
+{
+	DWORD written = 0;
+	return WriteFile(pipe, data, size, &written, nullptr) && written == size;
+}
+
+// The server dropped us: the pipe is broken and nothing more arrives
+static bool Dropped(HANDLE pipe)
+{
+	uint8_t byte;
+	DWORD read = 0;
+	return !ReadFile(pipe, &byte, 1, &read, nullptr) || read == 0;
+}
+
+TEST(ControlPipe_Loopback)
+{
+	ControlPipe::Server server;
+	if (!server.Start(StubHandler))
+	{
+		printf("[~] ControlPipe: %ls is in use (error %lu), skipped. Is SwimMouseCursor running?\n", ControlPipe::PIPE_NAME, GetLastError());
+		return;
+	}
+	ControlPipe::Server second;
+	CHECK(!second.Start(StubHandler)); // One owner per name
+
+	HANDLE pipe = ControlPipe::Connect(1000);
+	if (!CHECK(pipe != INVALID_HANDLE_VALUE))
+	{
+		server.Stop();
+		return;
+	}
+
+	uint8_t reply[ControlPipe::MAX_PAYLOAD];
+	uint32_t replySize = 0;
+	Status status = Status::Failed;
+	CHECK(ControlPipe::Transact(pipe, Request::Status, status, reply, replySize));
+	CHECK(status == Status::Ok && replySize == sizeof(ControlPipe::StatusReply));
+	ControlPipe::StatusReply statusReply;
+	memcpy(&statusReply, reply, sizeof(statusReply));
+	CHECK(statusReply.target == 0x10010 && statusReply.centerX == -960 && statusReply.centerY == 540);
+	CHECK(statusReply.enabled == 1 && statusReply.eligible == 1);
+
+	CHECK(ControlPipe::Transact(pipe, Request::Stats, status, reply, replySize));
+	CHECK(status == Status::Ok && replySize == sizeof(ControlPipe::StatsReply));
+	ControlPipe::StatsReply statsReply;
+	memcpy(&statsReply, reply, sizeof(statsReply));
+	CHECK(statsReply.ticks == 123456789 && statsReply.keyEvents == 42 && statsReply.recentersExecuted == 0);
+
+	// Codes outside the enum never reach the handler; a failed or oversized reply goes out without payload
+	for (uint8_t code : { (uint8_t)0, (uint8_t)Request::Count, (uint8_t)200 })
+	{
+		CHECK(ControlPipe::Transact(pipe, (Request)code, status, reply, replySize));
+		CHECK(status == Status::UnknownRequest && replySize == 0);
+	}
+	CHECK(ControlPipe::Transact(pipe, Request::Reload, status, reply, replySize));
+	CHECK(status == Status::Failed && replySize == 0);
+	CHECK(ControlPipe::Transact(pipe, Request::Toggle, status, reply, replySize));
+	CHECK(status == Status::Ok && replySize == 0);
+
+	// Idle for longer than the I/O timeout between requests: still connected
+	Sleep(ControlPipe::IO_TIMEOUT_MS + 500);
+	CHECK(ControlPipe::Transact(pipe, Request::Status, status, reply, replySize));
+	CHECK(status == Status::Ok && replySize == sizeof(ControlPipe::StatusReply));
+
+	// A request with a payload is not our protocol: dropped without a reply
+	const uint8_t withPayload[] = { 2, 0, 0, 0, (uint8_t)Request::Status, 0 };
+	CHECK(WriteRaw(pipe, withPayload, sizeof(withPayload)));
+	CHECK(Dropped(pipe));
+	CloseHandle(pipe);
+
+	// The pipe is free again; a client that stops halfway through a frame is dropped after the timeout
+	pipe = ControlPipe::Connect(1000);
+	if (CHECK(pipe != INVALID_HANDLE_VALUE))
+	{
+		const uint8_t request[] = { 1, 0, 0, 0, (uint8_t)Request::Status };
+		CHECK(WriteRaw(pipe, request, 2));
+		Sleep(ControlPipe::IO_TIMEOUT_MS + 500);
+		WriteRaw(pipe, request + 2, 3); // May already fail on the broken pipe
+		CHECK(Dropped(pipe));
+		CloseHandle(pipe);
+	}
+
+	// And the next client is served as usual
+	pipe = ControlPipe::Connect(1000);
+	if (CHECK(pipe != INVALID_HANDLE_VALUE))
+	{
+		CHECK(ControlPipe::Transact(pipe, Request::Stats, status, reply, replySize));
+		CHECK(status == Status::Ok && replySize == sizeof(ControlPipe::StatsReply));
+		CloseHandle(pipe);
+	}
+	server.Stop();
+	CHECK(server.Served() == 9); // Counted after the reply is written, so only exact once stopped
+}
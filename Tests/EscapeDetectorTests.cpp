@@ -0,0 +1,169 @@
+// EscapeDetectorTests.cpp
+// Escape detection state machine: clipped time, escapes before the clip arrives, the half-open clip rect, the
+// duration histogram, and the time since activation
+
+#include <windows.h>
+#include "Check.h"
+#include "../EscapeDetector.h"
+
+using EscapeDetector::Detector;
+using FlightRecorder::Action;
+
+static const HWND GAME = (HWND)(uintptr_t)0x10010;
+static const RECT CLIP{ 0, 0, 1920, 1080 };
+
+static uint64_t QpcPerMs()
+{
+	LARGE_INTEGER freq;
+	QueryPerformanceFrequency(&freq);
+	return (uint64_t)freq.QuadPart / 1000;
+}
+
+// Only time with the clip applied counts as armed: not the gap before the tick clips, not after Disarm
+TEST(EscapeDetector_ArmedTime)
+{
+	const uint64_t ms = QpcPerMs(), start = 1000 * ms;
+	Detector detector;
+	const EscapeDetector::Stats& stats = detector.GetStats();
+
+	detector.ArmPendingClip(CLIP, GAME, start);
+	CHECK(detector.IsArmed() && detector.IsPendingClip());
+	detector.Publish(start + 40 * ms);
+	CHECK(stats.armedQpc.load() == 0);
+
+	CHECK(!detector.Arm(CLIP, GAME, Action::Applied, start + 50 * ms)); // Already armed, now clipped
+	CHECK(!detector.IsPendingClip());
+	detector.Publish(start + 150 * ms);
+	CHECK(stats.armedQpc.load() == 100 * ms);
+	CHECK(!detector.Arm(CLIP, GAME, Action::Held, start + 160 * ms)); // Held ticks don't restart the clock
+	detector.Disarm(start + 350 * ms);
+	CHECK(stats.armedQpc.load() == 300 * ms);
+	CHECK(!detector.IsArmed());
+
+	detector.Publish(start + 500 * ms);
+	CHECK(detector.Disarm(start + 600 * ms) == nullptr);
+	CHECK(stats.armedQpc.load() == 300 * ms);
+
+	CHECK(detector.Arm(CLIP, GAME, Action::Applied, start + 1000 * ms));
+	detector.Disarm(start + 1010 * ms);
+	CHECK(stats.armedQpc.load() == 310 * ms);
+
+	// A pending clip that never arrives adds nothing
+	detector.ArmPendingClip(CLIP, GAME, start + 2000 * ms);
+	CHECK(!detector.PendingExpired(start + 2000 * ms + EscapeDetector::PENDING_CLIP_MS * ms));
+	CHECK(detector.PendingExpired(start + 2001 * ms + EscapeDetector::PENDING_CLIP_MS * ms));
+	detector.Disarm(start + 4000 * ms);
+	CHECK(stats.armedQpc.load() == 310 * ms);
+}
+
+TEST(EscapeDetector_PendingClipEscapes)
+{
+	const uint64_t ms = QpcPerMs(), start = 1000 * ms;
+	Detector detector;
+	detector.TargetActivated(start);
+	detector.ArmPendingClip(CLIP, GAME, start);
+	CHECK(detector.OnCursor(POINT{ -10, 500 }, GAME, start + 5 * ms) == nullptr);
+	CHECK(detector.IsEscaping());
+	const EscapeDetector::Escape* escape = detector.OnCursor(POINT{ 10, 500 }, GAME, start + 25 * ms);
+	if (CHECK(escape != nullptr))
+	{
+		CHECK(escape->pendingClip);
+		CHECK(escape->lastAction == Action::None);
+		CHECK(escape->msSinceActivation == 5);
+		CHECK(escape->at.x == -10 && escape->at.y == 500);
+		CHECK(escape->durationQpc == 20 * ms);
+	}
+
+	// After the clip arrived, escapes are the clip failing, not the gap before it
+	detector.Arm(CLIP, GAME, Action::Applied, start + 30 * ms);
+	detector.OnCursor(POINT{ 2000, 500 }, GAME, start + 40 * ms);
+	escape = detector.OnCursor(POINT{ 100, 500 }, GAME, start + 41 * ms);
+	CHECK(escape && !escape->pendingClip && escape->lastAction == Action::Applied);
+	CHECK(detector.GetStats().escapes.load() == 2);
+	CHECK(detector.GetStats().pendingClipEscapes.load() == 1);
+	CHECK(detector.GetStats().escapedQpc.load() == 21 * ms);
+	CHECK(detector.GetStats().longestQpc.load() == 20 * ms);
+}
+
+// ClipCursor keeps the cursor in [left, right) x [top, bottom)
+TEST(EscapeDetector_HalfOpenRect)
+{
+	const uint64_t ms = QpcPerMs(), start = 1000 * ms;
+	Detector detector;
+	detector.Arm(CLIP, GAME, Action::Applied, start);
+	static const POINT inside[] = { { 0, 0 }, { 1919, 1079 }, { 0, 1079 }, { 1919, 0 } };
+	for (POINT pt : inside)
+	{
+		detector.OnCursor(pt, GAME, start + ms);
+		CHECK(!detector.IsEscaping());
+	}
+	static const POINT outside[] = { { 1920, 500 }, { 500, 1080 }, { -1, 500 }, { 500, -1 } };
+	for (POINT pt : outside)
+	{
+		detector.OnCursor(pt, GAME, start + 2 * ms);
+		CHECK(detector.IsEscaping());
+		detector.OnCursor(POINT{ 500, 500 }, GAME, start + 3 * ms);
+	}
+	CHECK(detector.GetStats().escapes.load() == 4);
+}
+
+// Durations land in the first bucket whose bound they don't exceed; the last bucket takes the rest
+TEST(EscapeDetector_DurationBuckets)
+{
+	const uint64_t ms = QpcPerMs();
+	Detector detector;
+	detector.Arm(CLIP, GAME, Action::Held, ms);
+	uint64_t now = 1000 * ms;
+	auto escapeFor = [&](uint64_t durationMs)
+	{
+		detector.OnCursor(POINT{ -1, 0 }, GAME, now);
+		now += durationMs * ms;
+		detector.OnCursor(POINT{ 1, 0 }, GAME, now);
+		now += ms;
+	};
+
+	for (size_t i = 0; i < EscapeDetector::DURATION_BUCKETS; i++)
+	{
+		uint32_t bound = EscapeDetector::DURATION_BOUNDS_MS[i];
+		escapeFor(bound);     // On the bound: this bucket
+		escapeFor(bound + 1); // Just past it: the next
+	}
+	const EscapeDetector::Stats& stats = detector.GetStats();
+	CHECK(stats.durationBuckets[0].load() == 1);
+	for (size_t i = 1; i < EscapeDetector::DURATION_BUCKETS; i++)
+	{
+		// bound(i-1) + 1 and bound(i); 2 ms and 5 ms for the second bucket
+		if (!CHECK(stats.durationBuckets[i].load() == 2))
+			fprintf(stderr, "    bucket %zu: %llu\n", i, (unsigned long long)stats.durationBuckets[i].load());
+	}
+	CHECK(stats.durationBuckets[EscapeDetector::DURATION_BUCKETS].load() == 1);
+	escapeFor(3600 * 1000);
+	CHECK(stats.durationBuckets[EscapeDetector::DURATION_BUCKETS].load() == 2);
+}
+
+TEST(EscapeDetector_ActivationAndForeground)
+{
+	const uint64_t ms = QpcPerMs(), start = 1000 * ms;
+	Detector detector;
+	detector.Arm(CLIP, GAME, Action::Applied, start);
+
+	// TargetActivated never called: the time since is unknown, reported as the largest value
+	detector.OnCursor(POINT{ -5, 0 }, GAME, start + ms);
+	const EscapeDetector::Escape* escape = detector.OnCursor(POINT{ 5, 0 }, GAME, start + 2 * ms);
+	CHECK(escape && escape->msSinceActivation == UINT32_MAX);
+
+	// Outside the rect with another window in front is the user's business, not an escape
+	detector.OnCursor(POINT{ 3000, 0 }, (HWND)(uintptr_t)0x20020, start + 3 * ms);
+	CHECK(!detector.IsEscaping());
+
+	// An escape in progress ends when the target loses the foreground, and with Disarm
+	detector.OnCursor(POINT{ 3000, 0 }, GAME, start + 4 * ms);
+	escape = detector.OnCursor(POINT{ 3000, 0 }, (HWND)(uintptr_t)0x20020, start + 9 * ms);
+	CHECK(escape && escape->durationQpc == 5 * ms);
+	detector.OnCursor(POINT{ 3000, 0 }, GAME, start + 10 * ms);
+	escape = detector.Disarm(start + 12 * ms);
+	CHECK(escape && escape->durationQpc == 2 * ms);
+	CHECK(detector.OnCursor(POINT{ 3000, 0 }, GAME, start + 20 * ms) == nullptr);
+	CHECK(!detector.IsEscaping());
+	CHECK(detector.GetStats().escapes.load() == 3);
+}
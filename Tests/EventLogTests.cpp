@@ -0,0 +1,285 @@
+// EventLogTests.cpp
+// Event log and trace: encode -> decode round trips, a full buffer never writing from Begin(), and encode cost
+// against formatting the equivalent console line
+
+#include <windows.h>
+#include <cstdio>
+#include <cwchar>
+#include <memory>
+#include <string>
+#include <vector>
+#include "Check.h"
+#include "ScriptedWorld.h"
+#include "../Trace.h"
+
+// Runs the decoder into a temporary FILE and returns its output, one string per line
+static std::vector<std::string> DecodeLines(const std::wstring& path, bool csv, bool* ok = nullptr)
+{
+	std::vector<std::string> lines;
+	FILE* out = tmpfile();
+	if (!CHECK(out != nullptr))
+		return lines;
+	bool decoded = EventLog::Decode(path.c_str(), csv, out);
+	if (ok) *ok = decoded;
+	rewind(out);
+	char line[512];
+	while (fgets(line, sizeof(line), out))
+	{
+		std::string text(line);
+		if (!text.empty() && text.back() == '\n') text.pop_back();
+		lines.push_back(text);
+	}
+	fclose(out);
+	return lines;
+}
+
+// CSV line without its time column, which depends on when the test ran
+static std::string WithoutTime(const std::string& line)
+{
+	size_t comma = line.find(',');
+	return comma == std::string::npos ? line : line.substr(comma + 1);
+}
+
+static void TruncateFile(const std::wstring& path, size_t bytes)
+{
+	std::ifstream in(path.c_str(), std::ios::binary);
+	std::string data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+	in.close();
+	HANDLE file = CreateFileW(path.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (!CHECK(file != INVALID_HANDLE_VALUE))
+		return;
+	DWORD written = 0;
+	WriteFile(file, data.data(), (DWORD)(bytes < data.size() ? bytes : data.size()), &written, nullptr);
+	CloseHandle(file);
+}
+
+TEST(EventLog_RoundTrip)
+{
+	std::wstring path = Check::TempPath(L"SwimMouseCursor.Tests.events.bin");
+	auto writer = std::make_unique<EventLog::Writer>();
+	if (!CHECK(writer->Open(path.c_str())))
+		return;
+
+	HWND game = (HWND)(uintptr_t)0x10010;
+	writer->Event(EventLog::EventId::Start);
+	writer->ClippingToggled(true);
+	writer->TargetActivated(game);
+	writer->ClipApplied(game, RECT{ 0, 0, 1920, 1080 });
+	writer->ClipApplied(game, RECT{ -1920, 0, 0, 1080 }); // Negative deltas from the previous rect
+	writer->Recenter(game, POINT{ -960, 540 });
+	writer->CursorEscaped(1500, POINT{ -5, 20 }, (uint8_t)FlightRecorder::Action::Held, 2500, false);
+	writer->CursorEscaped(250, POINT{ 3000, 20 }, (uint8_t)FlightRecorder::Action::None, 40, true);
+	writer->ClipReset((uint8_t)ClipWatch::Trigger::Foreground, 3000);
+	writer->ClipReleased(EventLog::ReleaseReason::MoveResize);
+	writer->TargetActivated((HWND)(uintptr_t)0x20020);
+	writer->Event(EventLog::EventId::Exit);
+	CHECK(writer->Dropped() == 0);
+	writer->Close();
+
+	bool ok = false;
+	std::vector<std::string> lines = DecodeLines(path, true, &ok);
+	CHECK(ok);
+	static const char* expected[] = {
+		"Start,,,,,,",
+		"ClippingToggled,,,,,,enabled",
+		"TargetActivated,0x10010,,,,,",
+		"ClipApplied,0x10010,0,0,1920,1080,",
+		"ClipApplied,0x10010,-1920,0,0,1080,",
+		"Recenter,0x10010,-960,540,,,",
+		"CursorEscaped,,-5,20,,,1.500 ms after Held, 2500 ms after activation",
+		"CursorEscaped,,3000,20,,,0.250 ms before the clip, 40 ms after activation",
+		"ClipReset,,,,,,after Foreground (3.000 ms earlier)",
+		"ClipReleased,,,,,,MoveResize",
+		"TargetActivated,0x20020,,,,,",
+		"Exit,,,,,,",
+	};
+	const size_t count = sizeof(expected) / sizeof(expected[0]);
+	if (CHECK(lines.size() == count + 1))
+	{
+		CHECK(lines[0] == "time_ms,event,hwnd,left,top,right,bottom,arg");
+		for (size_t i = 0; i < count; i++)
+		{
+			if (!CHECK(WithoutTime(lines[i + 1]) == expected[i]))
+				fprintf(stderr, "    line %zu: '%s', expected '%s'\n", i + 1, WithoutTime(lines[i + 1]).c_str(), expected[i]);
+		}
+	}
+
+	// A record cut short is reported, not decoded into garbage
+	std::ifstream in(path.c_str(), std::ios::binary | std::ios::ate);
+	size_t size = (size_t)in.tellg();
+	in.close();
+	TruncateFile(path, size - 1);
+	DecodeLines(path, false, &ok);
+	CHECK(!ok);
+	TruncateFile(path, 4); // Not even a header
+	DecodeLines(path, false, &ok);
+	CHECK(!ok);
+	DeleteFileW(path.c_str());
+}
+
+// Records come from the keyboard hook too, so a full buffer drops them instead of writing from there
+TEST(EventLog_FullBufferDrops)
+{
+	std::wstring path = Check::TempPath(L"SwimMouseCursor.Tests.full.bin");
+	auto writer = std::make_unique<EventLog::Writer>();
+	if (!CHECK(writer->Open(path.c_str())))
+		return;
+
+	const uint64_t RECORDS = 20000; // Far more than the 64 KB buffer holds
+	for (uint64_t i = 0; i < RECORDS; i++)
+		writer->Recenter((HWND)(uintptr_t)(0x10000 + (i & 1) * 0x100000), POINT{ (LONG)i * 1000, -(LONG)i * 1000 });
+	CHECK(writer->Dropped() > 0);
+	uint64_t kept = RECORDS - writer->Dropped();
+
+	// Once the loop has flushed there is room again
+	writer->FlushIfFull();
+	writer->Event(EventLog::EventId::Exit);
+	CHECK(writer->Dropped() == RECORDS - kept);
+	writer->Close();
+
+	bool ok = false;
+	std::vector<std::string> lines = DecodeLines(path, false, &ok);
+	CHECK(ok);
+	CHECK(lines.size() == kept + 1);
+	DeleteFileW(path.c_str());
+}
+
+// Plays a session through ClipLogic::Tick into a trace. corruptTick >= 0 records that tick's decision wrongly.
+static uint64_t RecordSession(const std::wstring& path, int corruptTick)
+{
+	auto writer = std::make_unique<Trace::Writer>();
+	if (!CHECK(writer->Open(path.c_str())))
+		return 0;
+
+	ClipLogic::State state;
+	ScriptedWorld live;
+	int tick = 0;
+	auto step = [&]
+	{
+		ClipLogic::ObservingWorld<ScriptedWorld> world{ live };
+		ClipLogic::Decision d = ClipLogic::Tick(state, world);
+		if (tick++ == corruptTick)
+			d.changed = !d.changed;
+		writer->Tick(world.seen, d);
+		return d;
+	};
+
+	HWND game = (HWND)(uintptr_t)0x10010, browser = (HWND)(uintptr_t)0x30030;
+	live.foreground = browser;
+	step();
+	live.foreground = game;
+	live.target = true;
+	step(); // Applied
+	RECT scaled{ 0, 0, 1536, 864 }; // What a 125% display gives a process that isn't DPI aware
+	ClipLogic::ClipReadBack(state, scaled);
+	writer->ClipReadBack(scaled);
+	live.currentClip = scaled;
+	for (int i = 0; i < 5; i++) step(); // Held
+	writer->RecenterKey('E', 1000, Trace::KeyOutcome::Executed);
+	writer->RecenterKey('E', 1030, Trace::KeyOutcome::Repeat);
+	live.verifyDue = true;
+	step(); // Verified intact
+	live.currentClip = RECT{ 0, 0, 3840, 2160 };
+	step(); // Reset by someone else, re-applied
+	ClipLogic::ClipReadBack(state, scaled);
+	writer->ClipReadBack(scaled);
+	live.currentClip = scaled;
+	live.verifyDue = false;
+	live.clip = RECT{ 100, 100, 2020, 1180 };
+	step(); // Moved
+	live.moving = true;
+	step();
+	live.moving = false;
+	step();
+	writer->Disabled(ClipLogic::Disable(state)); // Safety hotkey between ticks
+	live.enabled = false;
+	step();
+	writer->RecenterKey('E', 5000, Trace::KeyOutcome::Ineligible);
+	live.enabled = true;
+	state.needsClipUpdate = true; // Config reload
+	writer->ForceUpdate();
+	step();
+	live.visible = false;
+	step(); // Covered
+	live.visible = true;
+	live.foreground = browser;
+	live.target = false;
+	step(); // Released
+	CHECK(writer->Dropped() == 0);
+	writer->Close();
+	return (uint64_t)tick;
+}
+
+TEST(Trace_RoundTrip)
+{
+	std::wstring path = Check::TempPath(L"SwimMouseCursor.Tests.trace.bin");
+	uint64_t ticks = RecordSession(path, -1);
+
+	FILE* out = tmpfile();
+	Trace::ReplayResult result;
+	CHECK(Trace::Replay(path.c_str(), false, out, result));
+	CHECK(result.ticks == ticks);
+	CHECK(result.keys == 3);
+	CHECK(result.divergences == 0);
+	fclose(out);
+
+	// A recording that doesn't match the logic is caught, at the tick where it differs
+	RecordSession(path, 3);
+	out = tmpfile();
+	result = Trace::ReplayResult();
+	CHECK(Trace::Replay(path.c_str(), false, out, result));
+	CHECK(result.divergences == 1);
+	fclose(out);
+	DeleteFileW(path.c_str());
+}
+
+BENCH(EventLog)
+{
+	std::wstring path = Check::TempPath(L"SwimMouseCursor.Tests.bench.bin");
+	auto writer = std::make_unique<EventLog::Writer>();
+	if (!writer->Open(path.c_str()))
+		return;
+
+	// The loop flushes between ticks; FlushIfFull keeps that share of the cost in the figure
+	HWND game = (HWND)(uintptr_t)0x10010;
+	LONG edge = 0;
+	Check::Measure("EventLog::ClipApplied (encode, amortised write)", [&]
+	{
+		writer->ClipApplied(game, RECT{ 0, 0, 1920 + (edge++ & 7), 1080 });
+		writer->FlushIfFull();
+		return 0;
+	});
+	Check::Measure("EventLog::Recenter (encode, amortised write)", [&]
+	{
+		writer->Recenter(game, POINT{ 960, 540 });
+		writer->FlushIfFull();
+		return 0;
+	});
+	writer->Close();
+	DeleteFileW(path.c_str());
+
+	// What Log() paid for the same event before it was written to the console
+	wchar_t text[1024];
+	Check::Measure("swprintf of the clip applied console line", [&]
+	{
+		return swprintf(text, 1024, L"[#] Clipping cursor to Minecraft window (%ld,%ld)-(%ld,%ld).", 0L, 0L, 1920L + (edge++ & 7), 1080L);
+	});
+
+	auto trace = std::make_unique<Trace::Writer>();
+	if (!trace->Open(path.c_str()))
+		return;
+	ClipLogic::State state;
+	ScriptedWorld live;
+	live.foreground = game;
+	live.target = true;
+	Check::Measure("Trace::Tick (held tick, amortised write)", [&]
+	{
+		ClipLogic::ObservingWorld<ScriptedWorld> world{ live };
+		ClipLogic::Decision d = ClipLogic::Tick(state, world);
+		trace->Tick(world.seen, d);
+		trace->FlushIfFull();
+		return (int)d.action;
+	});
+	trace->Close();
+	DeleteFileW(path.c_str());
+}
@@ -0,0 +1,150 @@
+// FlightRecorderTests.cpp
+// Flight recorder: Dump -> Decode round trips before and after the ring wraps, torn slots, and bad files
+
+#include <windows.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+#include "Check.h"
+#include "../FlightRecorder.h"
+
+using FlightRecorder::Action;
+
+// Runs the decoder into a temporary FILE and returns its output, one string per line
+static std::vector<std::string> DecodeLines(const std::wstring& path, bool* ok)
+{
+	std::vector<std::string> lines;
+	FILE* out = tmpfile();
+	if (!CHECK(out != nullptr))
+		return lines;
+	*ok = FlightRecorder::Decode(path.c_str(), out);
+	rewind(out);
+	char line[512];
+	while (fgets(line, sizeof(line), out))
+	{
+		std::string text(line);
+		if (!text.empty() && text.back() == '\n') text.pop_back();
+		lines.push_back(text);
+	}
+	fclose(out);
+	return lines;
+}
+
+// Sequence number of a "#<sequence> ..." line, 0 for anything else
+static unsigned long long Sequence(const std::string& line)
+{
+	return line.size() > 1 && line[0] == '#' ? strtoull(line.c_str() + 1, nullptr, 10) : 0;
+}
+
+template <size_t Capacity>
+static void RecordTicks(FlightRecorder::Ring<Capacity>& ring, uint64_t ticks)
+{
+	for (uint64_t i = 0; i < ticks; i++)
+	{
+		FlightRecorder::TickRecord rec{};
+		rec.qpc = 1000000 + i * 5000;
+		rec.foreground = 0x10010;
+		rec.clip = RECT{ 0, 0, 1920, 1080 };
+		rec.durationQpc = 150;
+		rec.classification = FlightRecorder::Classification::Minecraft;
+		rec.visiblePercent = 100;
+		rec.action = i % 2 ? Action::Held : Action::Applied;
+		ring.Record(rec);
+	}
+}
+
+static std::string ReadAll(const std::wstring& path)
+{
+	std::ifstream in(path.c_str(), std::ios::binary);
+	return std::string((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+}
+
+static void WriteAll(const std::wstring& path, const std::string& data)
+{
+	std::ofstream out(path.c_str(), std::ios::binary | std::ios::trunc);
+	out.write(data.data(), data.size());
+}
+
+TEST(FlightRecorder_RoundTrip)
+{
+	std::wstring path = Check::TempPath(L"SwimMouseCursor.Tests.flight.bin");
+	FlightRecorder::Ring<64> ring;
+	bool ok = false;
+
+	// Before the ring fills: every tick from #1
+	RecordTicks(ring, 10);
+	CHECK(ring.Count() == 10);
+	if (!CHECK(ring.Dump(path.c_str())))
+		return;
+	std::vector<std::string> lines = DecodeLines(path, &ok);
+	CHECK(ok);
+	if (CHECK(lines.size() == 10))
+		CHECK(Sequence(lines.front()) == 1 && Sequence(lines.back()) == 10);
+
+	// After wrapping three times and a bit: the last Capacity ticks, oldest first, in order
+	RecordTicks(ring, 64 * 3 + 5 - 10);
+	CHECK(ring.Count() == 64 * 3 + 5);
+	CHECK(ring.Dump(path.c_str()));
+	lines = DecodeLines(path, &ok);
+	CHECK(ok);
+	if (CHECK(lines.size() == 64))
+	{
+		CHECK(Sequence(lines.front()) == 64 * 2 + 6);
+		CHECK(Sequence(lines.back()) == 64 * 3 + 5);
+		bool ordered = true;
+		for (size_t i = 1; i < lines.size(); i++)
+			ordered = ordered && Sequence(lines[i]) == Sequence(lines[i - 1]) + 1;
+		CHECK(ordered);
+		CHECK(lines.front().find("Applied") != std::string::npos || lines.front().find("Held") != std::string::npos);
+		CHECK(lines.back().find("clip=(0,0)-(1920,1080)") != std::string::npos);
+	}
+
+	// Slots caught mid-write: zeroed, still holding the tick from one lap earlier, or already the next lap's.
+	// Each is skipped rather than shown as a tick it isn't.
+	std::string dump = ReadAll(path);
+	if (CHECK(dump.size() == FlightRecorder::FILE_HEADER_SIZE + 64 * sizeof(FlightRecorder::TickRecord)))
+	{
+		uint64_t stale[] = { 0, 64 * 2 + 10 - 64, 64 * 2 + 20 + 64 };
+		size_t slots[] = { 0, 4, 14 };
+		for (size_t k = 0; k < 3; k++)
+			memcpy(&dump[FlightRecorder::FILE_HEADER_SIZE + slots[k] * sizeof(FlightRecorder::TickRecord)], &stale[k], 8);
+		WriteAll(path, dump);
+		lines = DecodeLines(path, &ok);
+		CHECK(ok);
+		if (CHECK(lines.size() == 64))
+		{
+			CHECK(lines[0] == "(torn record skipped)" && lines[4] == "(torn record skipped)" && lines[14] == "(torn record skipped)");
+			CHECK(Sequence(lines[1]) == 64 * 2 + 7 && Sequence(lines[63]) == 64 * 3 + 5);
+		}
+	}
+	DeleteFileW(path.c_str());
+}
+
+TEST(FlightRecorder_BadFiles)
+{
+	std::wstring path = Check::TempPath(L"SwimMouseCursor.Tests.flight.bin");
+	FlightRecorder::Ring<16> ring;
+	RecordTicks(ring, 20);
+	if (!CHECK(ring.Dump(path.c_str())))
+		return;
+	std::string dump = ReadAll(path);
+	bool ok = true;
+
+	WriteAll(path, dump.substr(0, dump.size() - 1)); // Fewer records than the header says
+	DecodeLines(path, &ok);
+	CHECK(!ok);
+
+	std::string other = dump;
+	other[6] = '1'; // A dump from the previous format
+	WriteAll(path, other);
+	DecodeLines(path, &ok);
+	CHECK(!ok);
+
+	DeleteFileW(path.c_str());
+	DecodeLines(path, &ok);
+	CHECK(!ok);
+}
@@ -0,0 +1,119 @@
+// InputSourceTests.cpp
+// Delivery latency accounting, and a latency comparison of the keyboard backends on injected key events
+
+#include <windows.h>
+#include <algorithm>
+#include <vector>
+#include "Check.h"
+#include "../InputSource.h"
+
+TEST(InputDeliveryStats_Buckets)
+{
+	InputDeliveryStats stats;
+	stats.Record(GetTickCount());
+	stats.Record(GetTickCount() - 7);
+	stats.Record(GetTickCount() - 5000);
+	CHECK(stats.events.load() == 3);
+	CHECK(stats.latencyBuckets[0].load() + stats.latencyBuckets[1].load() == 1); // 0 ms, or 1 if the tick moved
+	CHECK(stats.latencyBuckets[4].load() == 1);                                  // 7-8 ms: the <= 10 ms bucket
+	CHECK(stats.latencyBuckets[InputDeliveryStats::LATENCY_BUCKETS].load() == 1); // Above the last bound
+	CHECK(stats.maxLatencyMs.load() >= 5000);
+	CHECK(stats.totalLatencyMs.load() >= 5007);
+}
+
+// Arrival of the injected key, seen by whichever backend is started
+static uint64_t keyArrivedQpc = 0;
+static bool keyDown = false;
+
+static void OnInjectedKey(const KeyEvent& ev)
+{
+	if (ev.vk != VK_F24)
+		return;
+	keyDown = ev.isDown;
+	keyArrivedQpc = Check::Qpc();
+}
+
+static bool SendF24(bool down)
+{
+	INPUT input = {};
+	input.type = INPUT_KEYBOARD;
+	input.ki.wVk = VK_F24;
+	input.ki.dwFlags = down ? 0 : KEYEVENTF_KEYUP;
+	return SendInput(1, &input, sizeof(input)) == 1;
+}
+
+// Pumps messages, as the program's loop does, until the key reaches the callback. Returns false on timeout.
+static bool WaitForKey(bool down, uint64_t sentQpc)
+{
+	LARGE_INTEGER freq;
+	QueryPerformanceFrequency(&freq);
+	uint64_t timeoutQpc = sentQpc + (uint64_t)freq.QuadPart / 10;
+	while (keyArrivedQpc < sentQpc || keyDown != down)
+	{
+		if (Check::Qpc() > timeoutQpc)
+			return false;
+		MsgWaitForMultipleObjects(0, nullptr, FALSE, 10, QS_ALLINPUT);
+		MSG msg;
+		while (PeekMessageW(&msg, nullptr, 0, 0, PM_REMOVE))
+		{
+			TranslateMessage(&msg);
+			DispatchMessageW(&msg);
+		}
+	}
+	return true;
+}
+
+// Presses F24 (a key no keyboard has, so nothing reacts to it) and times each press from SendInput to the callback
+static void MeasureBackend(InputSource& source, const char* name)
+{
+	const int PRESSES = 200;
+	char label[96];
+	if (!source.Start(OnInjectedKey))
+	{
+		printf("[~] %s: backend didn't start (error %lu), skipped.\n", name, GetLastError());
+		return;
+	}
+
+	std::vector<double> latencies;
+	int lost = 0;
+	for (int i = 0; i < PRESSES; i++)
+	{
+		uint64_t sent = Check::Qpc();
+		if (!SendF24(true))
+		{
+			printf("[~] %s: SendInput failed (error %lu), skipped. Needs an unlocked interactive desktop.\n", name, GetLastError());
+			break;
+		}
+		if (WaitForKey(true, sent))
+			latencies.push_back(Check::QpcToNs(keyArrivedQpc - sent) / 1000);
+		else
+			lost++;
+		sent = Check::Qpc();
+		SendF24(false);
+		WaitForKey(false, sent);
+	}
+	source.Stop();
+
+	if (latencies.empty())
+		return;
+	std::sort(latencies.begin(), latencies.end());
+	double total = 0;
+	for (double us : latencies) total += us;
+	snprintf(label, sizeof(label), "Input %s: injected key latency mean", name);
+	Check::Report(label, total / latencies.size(), "us");
+	snprintf(label, sizeof(label), "Input %s: injected key latency p50", name);
+	Check::Report(label, latencies[latencies.size() / 2], "us");
+	snprintf(label, sizeof(label), "Input %s: injected key latency p99", name);
+	Check::Report(label, latencies[latencies.size() * 99 / 100], "us");
+	if (lost)
+		printf("[!] %s: %d of %d presses never arrived.\n", name, lost, PRESSES);
+}
+
+BENCH(InputBackends)
+{
+	printf("[*] Injecting F24 presses to compare the keyboard backends...\n");
+	LowLevelHookInput hook;
+	MeasureBackend(hook, "hook");
+	RawInputSource rawInput;
+	MeasureBackend(rawInput, "rawinput");
+}
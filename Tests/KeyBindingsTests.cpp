@@ -0,0 +1,168 @@
+// KeyBindingsTests.cpp
+// Key-state tracker and chord matching, plus Match() throughput at 1000 bindings
+
+#include <windows.h>
+#include <algorithm>
+#include <cstring>
+#include "Check.h"
+#include "../KeyBindings.h"
+
+using KeyBindings::Action;
+
+static KeyBindings::BindingTable TableFor(const char* chordText)
+{
+	KeyBindings::BindingTable table;
+	VirtualKeyParser::KeyChord chord;
+	CHECK(VirtualKeyParser::ParseChord(chordText, chord));
+	table.Add(chord, Action::Recenter);
+	return table;
+}
+
+// Feeds key-downs through a tracker and matches the last one, as the input callback does
+static Action Press(const KeyBindings::BindingTable& table, std::initializer_list<WORD> keys)
+{
+	KeyBindings::KeyStateTracker tracker;
+	WORD last = 0;
+	for (WORD vk : keys)
+	{
+		tracker.OnKeyEvent(vk, true);
+		last = vk;
+	}
+	return table.Match(tracker.State(), last);
+}
+
+// Every name GetKeyNameFromVK prints must parse back to its key, or --check-config output won't load
+TEST(VirtualKeyParser_NamesRoundTrip)
+{
+	for (WORD vk = 1; vk < 0xFF; vk++)
+	{
+		const char* name = VirtualKeyParser::GetKeyNameFromVK(vk);
+		if (strcmp(name, "UNKNOWN") != 0)
+			CHECK(VirtualKeyParser::ParseKeyName(name) == vk);
+	}
+
+	VirtualKeyParser::KeyChord chord, parsed;
+	CHECK(VirtualKeyParser::ParseChord("CTRL+SHIFT+NUMPAD5", chord));
+	CHECK(chord.count == 3);
+	CHECK(VirtualKeyParser::ParseChord(VirtualKeyParser::GetChordName(chord).c_str(), parsed));
+	CHECK(parsed.count == chord.count && std::equal(chord.keys, chord.keys + chord.count, parsed.keys));
+	CHECK(!VirtualKeyParser::ParseChord("CTRL+CTRL", parsed));
+	CHECK(!VirtualKeyParser::ParseChord("CTRL+", parsed));
+	CHECK(!VirtualKeyParser::ParseChord("A+B+C+D+E", parsed));
+}
+
+TEST(KeySet_Words)
+{
+	KeyBindings::KeySet set;
+	for (WORD vk : { 0, 63, 64, 127, 128, 255 })
+	{
+		CHECK(!set.Test(vk));
+		set.Set(vk);
+		CHECK(set.Test(vk));
+	}
+	set.Clear(64);
+	CHECK(!set.Test(64));
+	CHECK(set.Test(63) && set.Test(127));
+}
+
+TEST(KeyStateTracker_RepeatsAndGenericModifiers)
+{
+	KeyBindings::KeyStateTracker tracker;
+	CHECK(!tracker.OnKeyEvent('E', true));
+	CHECK(tracker.OnKeyEvent('E', true)); // Auto-repeat
+	CHECK(tracker.OnKeyEvent('E', false)); // Reports it was down
+	CHECK(!tracker.State().Test('E'));
+
+	tracker.OnKeyEvent(VK_LSHIFT, true);
+	tracker.OnKeyEvent(VK_RSHIFT, true);
+	CHECK(tracker.State().Test(VK_SHIFT));
+	tracker.OnKeyEvent(VK_LSHIFT, false);
+	CHECK(tracker.State().Test(VK_SHIFT)); // Right shift still down
+	tracker.OnKeyEvent(VK_RSHIFT, false);
+	CHECK(!tracker.State().Test(VK_SHIFT));
+}
+
+TEST(BindingTable_PlainKeyIgnoresModifiers)
+{
+	KeyBindings::BindingTable table = TableFor("E");
+	CHECK(Press(table, { 'E' }) == Action::Recenter);
+	CHECK(Press(table, { VK_LSHIFT, 'E' }) == Action::Recenter);
+	CHECK(Press(table, { 'R' }) == Action::None);
+}
+
+TEST(BindingTable_ChordNeedsExactModifiers)
+{
+	KeyBindings::BindingTable table = TableFor("CTRL+SHIFT+R");
+	CHECK(Press(table, { VK_LCONTROL, VK_LSHIFT, 'R' }) == Action::Recenter);
+	CHECK(Press(table, { VK_RCONTROL, VK_RSHIFT, 'R' }) == Action::Recenter);
+	CHECK(Press(table, { VK_LCONTROL, 'R' }) == Action::None);
+	CHECK(Press(table, { VK_LCONTROL, VK_LSHIFT, VK_LMENU, 'R' }) == Action::None);
+	CHECK(Press(table, { VK_LCONTROL, VK_LSHIFT, 'E' }) == Action::None);
+}
+
+TEST(BindingTable_SidedModifier)
+{
+	KeyBindings::BindingTable table = TableFor("LALT+F");
+	CHECK(Press(table, { VK_LMENU, 'F' }) == Action::Recenter);
+	CHECK(Press(table, { VK_RMENU, 'F' }) == Action::None);
+}
+
+TEST(BindingTable_AllModifierChord)
+{
+	KeyBindings::BindingTable table = TableFor("CTRL+SHIFT");
+	CHECK(Press(table, { VK_LCONTROL, VK_LSHIFT }) == Action::Recenter);
+	CHECK(Press(table, { VK_LSHIFT }) == Action::None);
+}
+
+TEST(BindingTable_MatchedIndex)
+{
+	KeyBindings::BindingTable table;
+	VirtualKeyParser::KeyChord e, esc;
+	CHECK(VirtualKeyParser::ParseChord("E", e));
+	CHECK(VirtualKeyParser::ParseChord("ESCAPE", esc));
+	table.Add(e, Action::Recenter);
+	table.Add(esc, Action::Recenter);
+	CHECK(table.Size() == 2);
+
+	KeyBindings::KeyStateTracker tracker;
+	tracker.OnKeyEvent(VK_ESCAPE, true);
+	size_t matched = SIZE_MAX;
+	CHECK(table.Match(tracker.State(), VK_ESCAPE, &matched) == Action::Recenter);
+	CHECK(matched == 1);
+
+	table.Clear();
+	CHECK(table.Match(tracker.State(), VK_ESCAPE) == Action::None);
+}
+
+BENCH(BindingTable)
+{
+	// 999 chords of the letters with each combination of modifiers, then the one that matches
+	static const WORD modifiers[] = { VK_LCONTROL, VK_LSHIFT, VK_LMENU };
+	KeyBindings::BindingTable table;
+	for (size_t i = 0; i < 999; i++)
+	{
+		VirtualKeyParser::KeyChord chord;
+		for (size_t m = 0; m < 3; m++)
+		{
+			if ((i >> m) & 1)
+				chord.keys[chord.count++] = modifiers[m];
+		}
+		chord.keys[chord.count++] = (WORD)('A' + (i / 8) % 26);
+		table.Add(chord, Action::Recenter);
+	}
+	VirtualKeyParser::KeyChord last{ { VK_RWIN, VK_F12 }, 2 };
+	table.Add(last, Action::Recenter);
+
+	KeyBindings::KeyStateTracker tracker;
+	tracker.OnKeyEvent(VK_RWIN, true);
+	tracker.OnKeyEvent(VK_F12, true);
+	Check::Measure("BindingTable::Match (1000 bindings, last matches)", [&] { return (int)table.Match(tracker.State(), VK_F12); });
+	Check::Measure("BindingTable::Match (1000 bindings, no trigger)", [&] { return (int)table.Match(tracker.State(), VK_F11); });
+
+	KeyBindings::BindingTable single = TableFor("E");
+	KeyBindings::KeyStateTracker pressed;
+	pressed.OnKeyEvent('E', true);
+	Check::Measure("BindingTable::Match (1 binding)", [&] { return (int)single.Match(pressed.State(), 'E'); });
+	WORD vk = 'A';
+	Check::Measure("KeyStateTracker::OnKeyEvent", [&] { vk = vk == 'Z' ? 'A' : vk + 1; return pressed.OnKeyEvent(vk, (vk & 1) != 0); });
+}
@@ -0,0 +1,158 @@
+// LogFileSinkTests.cpp
+// Rotating log file: numbered files shift and the oldest is dropped, closed files are trimmed to what was
+// written, long lines are cut at MAX_LINE, and text is encoded as UTF-8
+
+#include <windows.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+#include "Check.h"
+#include "../LogFileSink.h"
+
+using LogFileSink::RotatingSink;
+
+static std::string ReadAll(const std::wstring& path, bool* exists = nullptr)
+{
+	std::ifstream in(path.c_str(), std::ios::binary);
+	if (exists) *exists = in.is_open();
+	return std::string((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+}
+
+// The text of each "<timestamp> <text>\r\n" line
+static std::vector<std::string> Lines(const std::string& content)
+{
+	std::vector<std::string> lines;
+	size_t at = 0, end;
+	while ((end = content.find("\r\n", at)) != std::string::npos)
+	{
+		size_t space = content.find(' ', content.find(' ', at) + 1); // After "YYYY-MM-DD HH:MM:SS.mmm"
+		lines.push_back(space < end ? content.substr(space + 1, end - space - 1) : std::string());
+		at = end + 2;
+	}
+	return lines;
+}
+
+static void RemoveAll(const std::wstring& path, unsigned count)
+{
+	LogFileSink::MappedFile::Remove(path);
+	for (unsigned i = 1; i <= count; i++)
+		LogFileSink::MappedFile::Remove(path + L"." + std::to_wstring(i));
+}
+
+TEST(LogFileSink_RotationShiftsAndDrops)
+{
+	std::wstring path = Check::TempPath(L"SwimMouseCursor.Tests.log");
+	RemoveAll(path, 3);
+	RotatingSink sink;
+	if (!CHECK(sink.Open(path, 8192, 3)))
+		return;
+
+	// About 100 bytes a line, so 81 fit in a file; four rotations leave only the last three files
+	wchar_t text[128];
+	int written = 0;
+	while (sink.Rotations() < 4)
+	{
+		swprintf(text, 128, L"line %06d ........................................................................", written++);
+		sink.Write(text);
+	}
+	sink.Close();
+
+	bool exists[4];
+	std::string files[4];
+	for (unsigned i = 0; i < 4; i++)
+		files[i] = ReadAll(i ? path + L"." + std::to_wstring(i) : path, &exists[i]);
+	CHECK(exists[0] && exists[1] && exists[2]);
+	CHECK(!exists[3]);
+
+	// Newest in <path>, older in .1, oldest kept in .2; numbers run on across files without gaps
+	std::vector<std::string> newest = Lines(files[0]), middle = Lines(files[1]), oldest = Lines(files[2]);
+	if (CHECK(!newest.empty() && !middle.empty() && !oldest.empty()))
+	{
+		int first = atoi(oldest.front().c_str() + 5);
+		CHECK(first > 0); // The first file was dropped
+		CHECK(atoi(middle.front().c_str() + 5) == atoi(oldest.back().c_str() + 5) + 1);
+		CHECK(atoi(newest.front().c_str() + 5) == atoi(middle.back().c_str() + 5) + 1);
+		CHECK(atoi(newest.back().c_str() + 5) == written - 1);
+		CHECK((int)(oldest.size() + middle.size() + newest.size()) == written - first);
+	}
+
+	// Rotated and closed files are trimmed to their lines: no preallocated zeros at the end
+	for (unsigned i = 0; i < 3; i++)
+	{
+		CHECK(files[i].size() >= 2 && files[i].compare(files[i].size() - 2, 2, "\r\n") == 0);
+		CHECK(files[i].find('\0') == std::string::npos);
+		CHECK(files[i].size() <= 8192);
+	}
+	RemoveAll(path, 3);
+}
+
+TEST(LogFileSink_LineFormatAndTruncation)
+{
+	std::wstring path = Check::TempPath(L"SwimMouseCursor.Tests.line.log");
+	RemoveAll(path, 1);
+	RotatingSink sink;
+	if (!CHECK(sink.Open(path, 1024 * 1024, 1)))
+		return;
+	sink.Write(L"[*] Started.");
+	std::wstring longText(5000, L'x');
+	sink.Write(longText.c_str());
+	sink.Close();
+
+	std::string content = ReadAll(path);
+	size_t firstEnd = content.find("\r\n");
+	if (!CHECK(firstEnd != std::string::npos))
+		return;
+
+	// "YYYY-MM-DD HH:MM:SS.mmm [*] Started."
+	std::string first = content.substr(0, firstEnd);
+	CHECK(first.size() == 24 + 12);
+	CHECK(first[4] == '-' && first[7] == '-' && first[10] == ' ' && first[13] == ':' && first[16] == ':' && first[19] == '.');
+	CHECK(first.compare(23, std::string::npos, " [*] Started.") == 0);
+
+	// The long line is cut to MAX_LINE, line break included, and nothing spills into a next line
+	std::string second = content.substr(firstEnd + 2);
+	CHECK(second.size() == RotatingSink::MAX_LINE);
+	CHECK(second.compare(second.size() - 2, 2, "\r\n") == 0);
+	CHECK(second.find('x') == 24 && second.find_first_not_of('x', 24) == RotatingSink::MAX_LINE - 2);
+	RemoveAll(path, 1);
+}
+
+TEST(LogFileSink_Utf8)
+{
+	char out[32];
+	size_t n = LogFileSink::EncodeUtf8(L"A\u00E9\u20AC", out, sizeof(out));
+	CHECK(n == 6 && memcmp(out, "A\xC3\xA9\xE2\x82\xAC", 6) == 0);
+
+	// Outside the BMP: a surrogate pair where wchar_t is UTF-16, one code point where it is UTF-32
+	n = LogFileSink::EncodeUtf8(L"\U0001F600!", out, sizeof(out));
+	CHECK(n == 5 && memcmp(out, "\xF0\x9F\x98\x80!", 5) == 0);
+	if (sizeof(wchar_t) == 2)
+	{
+		const wchar_t pair[] = { (wchar_t)0xD83D, (wchar_t)0xDE00, 0 };
+		n = LogFileSink::EncodeUtf8(pair, out, sizeof(out));
+		CHECK(n == 4 && memcmp(out, "\xF0\x9F\x98\x80", 4) == 0);
+	}
+
+	// A character that doesn't fit whole is left out, never cut
+	CHECK(LogFileSink::EncodeUtf8(L"A\U0001F600", out, 4) == 1);
+	CHECK(LogFileSink::EncodeUtf8(L"\u20AC", out, 2) == 0);
+}
+
+BENCH(LogFileSink)
+{
+	std::wstring path = Check::TempPath(L"SwimMouseCursor.Tests.bench.log");
+	RotatingSink sink;
+	if (!sink.Open(path, 4 * 1024 * 1024, 2))
+		return;
+	Check::Measure("RotatingSink::Write (80 character line)", [&]
+	{
+		sink.Write(L"[#] Clipping cursor to Minecraft window (0,0)-(1920,1080). Some more text here.");
+		return 0;
+	});
+	sink.Close();
+	RemoveAll(path, 2);
+}
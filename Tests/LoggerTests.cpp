@@ -0,0 +1,100 @@
+// LoggerTests.cpp
+// Level filtering before formatting, rate-limited lines and their summaries, and what a filtered statement costs
+
+#include <windows.h>
+#include <cwchar>
+#include <string>
+#include <vector>
+#include "Check.h"
+#include "../Logger.h"
+
+static std::vector<std::wstring> captured;
+
+static void CaptureLine(const wchar_t* text)
+{
+	captured.push_back(text);
+}
+
+// Every line goes to `captured` while in scope (and to the console as usual)
+struct CaptureLog
+{
+	LogLevel before = LogConfig::GetLevel();
+	CaptureLog(LogLevel level)
+	{
+		captured.clear();
+		logFileSink = CaptureLine;
+		LogConfig::SetLevel(level);
+	}
+	~CaptureLog()
+	{
+		logFileSink = nullptr;
+		LogConfig::SetLevel(before);
+	}
+};
+
+TEST(Logger_LevelNames)
+{
+	for (uint8_t i = 0; i <= (uint8_t)LogLevel::Trace; i++)
+	{
+		LogLevel parsed = LogLevel::Error;
+		CHECK(LogConfig::ParseLevel(LogConfig::LevelName((LogLevel)i), parsed));
+		CHECK(parsed == (LogLevel)i);
+	}
+	LogLevel parsed = LogLevel::Error;
+	CHECK(LogConfig::ParseLevel("DEBUG", parsed) && parsed == LogLevel::Debug);
+	CHECK(!LogConfig::ParseLevel("verbose", parsed));
+}
+
+TEST(Logger_FilteredStatementsDontEvaluate)
+{
+	CaptureLog capture(LogLevel::Info);
+	int evaluated = 0;
+	LOG_DEBUG(L"[.] Never formatted %d.", ++evaluated);
+	CHECK(evaluated == 0);
+	CHECK(captured.empty());
+
+	LOG_WARN(L"[!] Formatted %d.", ++evaluated);
+	CHECK(evaluated == 1);
+	if (CHECK(captured.size() == 1))
+		CHECK(captured[0] == L"[!] Formatted 1.");
+
+	// Above the compile-time floor the statement isn't there at all, whatever the runtime level
+	LogConfig::SetLevel(LogLevel::Trace);
+	LOG_TRACE(L"[.] Trace %d.", ++evaluated);
+	CHECK(evaluated == (LOG_COMPILE_LEVEL >= (int)LogLevel::Trace ? 2 : 1));
+}
+
+TEST(Logger_LimitedLinesAreSummarised)
+{
+	CaptureLog capture(LogLevel::Info);
+	static const wchar_t* FMT = L"[#] Limited test line %d.";
+	DWORD now = 1000000;
+	int allowed = 0;
+	for (int i = 0; i < 10; i++)
+		allowed += LogLimiter::Allow(FMT, LogCategory::MoveResize, now + i) ? 1 : 0;
+	CHECK(allowed == (int)LogLimiter::MAX_PER_WINDOW);
+	CHECK(LogLimiter::SuppressedLines(LogCategory::MoveResize) >= 10 - LogLimiter::MAX_PER_WINDOW);
+	CHECK(captured.empty()); // Allow() itself only writes summaries
+
+	// Once the window has passed, the next allowed line is preceded by the summary
+	CHECK(LogLimiter::Allow(FMT, LogCategory::MoveResize, now + LogLimiter::WINDOW_MS + 10));
+	if (CHECK(captured.size() == 1))
+	{
+		// "<format up to the first %>... (repeated N times)"
+		const std::wstring& summary = captured[0];
+		CHECK(summary.compare(0, 22, L"[#] Limited test line ") == 0);
+		CHECK(summary.size() > 18 && summary.compare(summary.size() - 18, 18, L"(repeated 7 times)") == 0);
+	}
+}
+
+BENCH(Logger)
+{
+	LogLevel before = LogConfig::GetLevel();
+	LogConfig::SetLevel(LogLevel::Info);
+	int value = 0;
+	Check::Measure("Empty statement (baseline)", [&] { return ++value; });
+	Check::Measure(LOG_COMPILE_LEVEL >= (int)LogLevel::Trace ? "LOG_TRACE (filtered at run time)" : "LOG_TRACE (compiled out)",
+		[&] { LOG_TRACE(L"[.] Tick %d.", value); return ++value; });
+	Check::Measure("LOG_DEBUG (filtered at run time)", [&] { LOG_DEBUG(L"[.] Tick %d.", value); return ++value; });
+	LogConfig::SetLevel(before);
+}
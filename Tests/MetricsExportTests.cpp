@@ -0,0 +1,193 @@
+// MetricsExportTests.cpp
+// Metrics file: the Prometheus text the builder produces (samples with and without labels, cumulative histogram
+// buckets, +Inf equal to _count, HELP and TYPE once per metric) and the exporter's atomic file replace
+
+#include <windows.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <string>
+#include <vector>
+#include "Check.h"
+#include "../MetricsExport.h"
+
+static std::vector<std::string> Lines(const std::string& text)
+{
+	std::vector<std::string> lines;
+	size_t at = 0, end;
+	while ((end = text.find('\n', at)) != std::string::npos)
+	{
+		lines.push_back(text.substr(at, end - at));
+		at = end + 1;
+	}
+	CHECK(at == text.size()); // Every line ends with a line break
+	return lines;
+}
+
+// The metric a sample line belongs to: its name up to the labels or value, without a histogram suffix
+static std::string Family(const std::string& line)
+{
+	std::string name = line.substr(0, line.find_first_of("{ "));
+	for (const char* suffix : { "_bucket", "_sum", "_count" })
+	{
+		size_t n = strlen(suffix);
+		if (name.size() > n && name.compare(name.size() - n, n, suffix) == 0)
+			return name.substr(0, name.size() - n);
+	}
+	return name;
+}
+
+TEST(MetricsText_Samples)
+{
+	MetricsExport::Text text;
+	text.Counter("smc_ticks_total", "Clip loop ticks.", 12345);
+	text.Describe("smc_ticks_by_action_total", "counter", "Clip loop ticks by outcome.");
+	text.Sample("smc_ticks_by_action_total", "action=\"applied\"", (uint64_t)3);
+	text.Sample("smc_ticks_by_action_total", "action=\"held\",reason=\"none\"", (uint64_t)0);
+	text.Describe("smc_escapes_per_hour", "gauge", "Escapes per hour clipped.");
+	text.Sample("smc_escapes_per_hour", "", 0.25);
+	text.Sample("smc_escapes_per_hour", "window=\"last\"", 1.0 / 3);
+
+	std::vector<std::string> lines = Lines(text.Str());
+	const char* expected[] = {
+		"# HELP smc_ticks_total Clip loop ticks.",
+		"# TYPE smc_ticks_total counter",
+		"smc_ticks_total 12345",
+		"# HELP smc_ticks_by_action_total Clip loop ticks by outcome.",
+		"# TYPE smc_ticks_by_action_total counter",
+		"smc_ticks_by_action_total{action=\"applied\"} 3",
+		"smc_ticks_by_action_total{action=\"held\",reason=\"none\"} 0",
+		"# HELP smc_escapes_per_hour Escapes per hour clipped.",
+		"# TYPE smc_escapes_per_hour gauge",
+		"smc_escapes_per_hour 0.25",
+		"smc_escapes_per_hour{window=\"last\"} 0.333333333",
+	};
+	if (CHECK(lines.size() == sizeof(expected) / sizeof(expected[0])))
+		for (size_t i = 0; i < lines.size(); i++)
+			if (!CHECK(lines[i] == expected[i]))
+				fprintf(stderr, "    line %zu: %s\n", i, lines[i].c_str());
+
+	text.Clear();
+	CHECK(text.Str().empty());
+}
+
+TEST(MetricsText_Histogram)
+{
+	MetricsExport::Text text;
+	const double bounds[] = { 0.5, 1, 2.5 };
+	const uint64_t counts[] = { 1, 0, 3, 2 }; // Per bucket; the last is above every bound
+	text.Histogram("smc_key_latency_ms", "Key delivery latency.", bounds, counts, 3, 12.5);
+
+	std::vector<std::string> lines = Lines(text.Str());
+	const char* expected[] = {
+		"# HELP smc_key_latency_ms Key delivery latency.",
+		"# TYPE smc_key_latency_ms histogram",
+		"smc_key_latency_ms_bucket{le=\"0.5\"} 1",
+		"smc_key_latency_ms_bucket{le=\"1\"} 1",
+		"smc_key_latency_ms_bucket{le=\"2.5\"} 4",
+		"smc_key_latency_ms_bucket{le=\"+Inf\"} 6",
+		"smc_key_latency_ms_sum 12.5",
+		"smc_key_latency_ms_count 6",
+	};
+	if (CHECK(lines.size() == sizeof(expected) / sizeof(expected[0])))
+		for (size_t i = 0; i < lines.size(); i++)
+			if (!CHECK(lines[i] == expected[i]))
+				fprintf(stderr, "    line %zu: %s\n", i, lines[i].c_str());
+
+	// Bucket values never decrease and +Inf equals _count, for any counts
+	text.Clear();
+	const double manyBounds[] = { 0.001, 0.01, 0.1, 1, 10, 100, 1000 };
+	uint64_t manyCounts[8];
+	uint64_t total = 0;
+	for (size_t i = 0; i < 8; i++)
+		total += manyCounts[i] = (i * 7919) % 13;
+	text.Histogram("smc_tick_duration_ms", "Tick duration.", manyBounds, manyCounts, 7, 0);
+	uint64_t last = 0, inf = 0, count = 0;
+	bool monotonic = true;
+	for (const std::string& line : Lines(text.Str()))
+	{
+		uint64_t value = strtoull(line.c_str() + line.rfind(' ') + 1, nullptr, 10);
+		if (line.compare(0, 28, "smc_tick_duration_ms_bucket{") == 0)
+		{
+			monotonic = monotonic && value >= last;
+			last = value;
+			if (line.find("le=\"+Inf\"") != std::string::npos)
+				inf = value;
+		}
+		else if (line.compare(0, 27, "smc_tick_duration_ms_count ") == 0)
+			count = value;
+	}
+	CHECK(monotonic);
+	CHECK(inf == total && count == total);
+	CHECK(text.Str().find("le=\"0.001\"") != std::string::npos && text.Str().find("le=\"1000\"") != std::string::npos);
+}
+
+// A full file as the program writes it: each metric is described once, before any of its samples
+TEST(MetricsText_DescribedOnce)
+{
+	MetricsExport::Text text;
+	const double bounds[] = { 1, 10 };
+	const uint64_t counts[] = { 4, 5, 6 };
+	text.Counter("smc_recenters_total", "Recenters.", 7);
+	text.Histogram("smc_tick_duration_us", "Tick duration.", bounds, counts, 2, 99.5);
+	text.Describe("smc_clip_resets_total", "counter", "Clip resets by the event before them.");
+	text.Sample("smc_clip_resets_total", "before=\"activation\"", (uint64_t)1);
+	text.Sample("smc_clip_resets_total", "before=\"none\"", (uint64_t)2);
+
+	std::map<std::string, int> help, type;
+	bool describedFirst = true;
+	for (const std::string& line : Lines(text.Str()))
+	{
+		if (line.compare(0, 7, "# HELP ") == 0)
+			help[line.substr(7, line.find(' ', 7) - 7)]++;
+		else if (line.compare(0, 7, "# TYPE ") == 0)
+			type[line.substr(7, line.find(' ', 7) - 7)]++;
+		else
+			describedFirst = describedFirst && type.count(Family(line)) == 1;
+	}
+	CHECK(describedFirst);
+	CHECK(help.size() == 3 && type.size() == 3);
+	for (const auto& entry : type)
+		CHECK(entry.second == 1 && help[entry.first] == 1);
+}
+
+static void TestCollector(MetricsExport::Text& out)
+{
+	out.Counter("smc_test_total", "Test counter.", 1);
+}
+
+// Stop() writes a last file; the temporary file it renames from is gone
+TEST(MetricsExport_Exporter)
+{
+	std::wstring path = Check::TempPath(L"SwimMouseCursor.Tests.prom");
+	DeleteFileW(path.c_str());
+	MetricsExport::Exporter exporter;
+	if (!CHECK(exporter.Start(path.c_str(), 60000, TestCollector)))
+		return;
+	exporter.Stop();
+	CHECK(exporter.Written() == 1 && exporter.Failed() == 0);
+
+	std::ifstream in(path.c_str(), std::ios::binary);
+	std::string content((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+	in.close();
+	CHECK(content == "# HELP smc_test_total Test counter.\n# TYPE smc_test_total counter\nsmc_test_total 1\n");
+	std::ifstream temp((path + L".tmp").c_str());
+	CHECK(!temp.is_open());
+	DeleteFileW(path.c_str());
+}
+
+BENCH(MetricsExport)
+{
+	MetricsExport::Text text;
+	const double bounds[] = { 0.05, 0.1, 0.25, 0.5, 1, 2.5, 5, 10, 25, 50 };
+	const uint64_t counts[] = { 100, 2000, 30000, 4000, 500, 60, 7, 0, 0, 1, 0 };
+	Check::Measure("MetricsExport::Text::Histogram (10 buckets)", [&]
+	{
+		text.Clear();
+		text.Histogram("smc_tick_duration_ms", "Tick duration.", bounds, counts, 10, 12345.678);
+		return text.Str().size();
+	});
+}
@@ -0,0 +1,28 @@
+// ScriptedWorld.h
+// A world for ClipLogic::Tick that answers from fields the test sets between ticks
+
+#pragma once
+#include <windows.h>
+#include <cstdint>
+#include "../ClipLogic.h"
+
+struct ScriptedWorld
+{
+	bool moving = false;
+	bool enabled = true;
+	HWND foreground = nullptr;
+	bool target = false;
+	bool visible = true;
+	RECT clip{ 0, 0, 1920, 1080 };
+	bool verifyDue = false;
+	RECT currentClip{ 0, 0, 1920, 1080 };
+
+	bool IsMoving() { return moving; }
+	bool Enabled() { return enabled; }
+	HWND Foreground() { return foreground; }
+	bool IsTarget(HWND) { return target; }
+	bool IsVisible(HWND, uint8_t* percent) { *percent = visible ? 100 : 40; return visible; }
+	bool ClipRect(HWND, RECT& rc) { rc = clip; return true; }
+	bool VerifyDue() { return verifyDue; }
+	bool CurrentClip(RECT& rc) { rc = currentClip; return true; }
+};
@@ -0,0 +1,253 @@
+// StatsPageTests.cpp
+// Shared stats page: what a reader sees after each publish, the header checks, no torn reads under a concurrent
+// writer, latency percentiles against the exact values, and what reading and publishing cost
+
+#include <windows.h>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include "Check.h"
+#include "../StatsPage.h"
+
+using FlightRecorder::Action;
+
+// The page as another process would map it, for tests that change the header
+struct RawPage
+{
+	HANDLE mapping = OpenFileMappingW(FILE_MAP_ALL_ACCESS, FALSE, StatsPage::MAPPING_NAME);
+	StatsPage::Page* page = mapping ? static_cast<StatsPage::Page*>(MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, sizeof(StatsPage::Page))) : nullptr;
+	~RawPage()
+	{
+		if (page) UnmapViewOfFile(page);
+		if (mapping) CloseHandle(mapping);
+	}
+};
+
+static uint32_t UsToQpc(uint32_t us)
+{
+	LARGE_INTEGER freq;
+	QueryPerformanceFrequency(&freq);
+	return (uint32_t)(us * (freq.QuadPart / 1000000.0));
+}
+
+TEST(StatsPage_WriterAndReader)
+{
+	StatsPage::Reader reader;
+	CHECK(!reader.Open()); // Nobody publishing yet
+
+	StatsPage::Writer writer;
+	if (!CHECK(writer.Open()))
+		return;
+	StatsPage::Writer second;
+	CHECK(!second.Open());
+	CHECK(GetLastError() == ERROR_ALREADY_EXISTS);
+	CHECK(!second.IsOpen());
+
+	if (!CHECK(reader.Open()))
+		return;
+	StatsPage::Data data;
+	CHECK(reader.Read(data)); // Initialised, nothing published: all zero
+	CHECK(data.flags == 0 && data.publishedQpc == 0);
+
+	HWND game = (HWND)(uintptr_t)0x10010;
+	writer.SetState(StatsPage::ENABLED | StatsPage::CLIPPED | StatsPage::ELIGIBLE | StatsPage::TARGET_FRONT,
+		RECT{ -1920, 0, 0, 1080 }, game, 4242);
+	for (int i = 0; i < 5; i++)
+		writer.Tick(Action::Held, UsToQpc(200));
+	writer.Tick(Action::Applied, UsToQpc(900));
+	writer.Tick(Action::Count, UsToQpc(100)); // Out of range counts as None
+	writer.SetRecenters(3);
+	writer.SetEscapes(2, 45);
+	writer.SetClipResets(1);
+	uint64_t before = Check::Qpc();
+	writer.Publish();
+
+	CHECK(reader.Read(data));
+	CHECK(data.flags == (StatsPage::ENABLED | StatsPage::CLIPPED | StatsPage::ELIGIBLE | StatsPage::TARGET_FRONT));
+	CHECK(data.clipLeft == -1920 && data.clipTop == 0 && data.clipRight == 0 && data.clipBottom == 1080);
+	CHECK(data.targetWindow == 0x10010 && data.targetPid == 4242);
+	CHECK(data.ticks[(size_t)Action::Held] == 5);
+	CHECK(data.ticks[(size_t)Action::Applied] == 1);
+	CHECK(data.ticks[(size_t)Action::None] == 1);
+	CHECK(data.recenters == 3 && data.escapes == 2 && data.escapedMs == 45 && data.clipResets == 1);
+	CHECK(data.publishedQpc >= before);
+	CHECK(data.writerPid == GetCurrentProcessId());
+	CHECK(data.tickP50Us == 0); // Percentiles only after the first complete window
+
+	// Released: the last clip rect stays for readers, and no target means no pid
+	writer.SetState(StatsPage::ENABLED, RECT{ 0, 0, 10, 10 }, nullptr, 4242);
+	writer.UpdatePercentiles(GetTickCount() + StatsPage::PERCENTILE_WINDOW_MS);
+	writer.Publish();
+	CHECK(reader.Read(data));
+	CHECK(data.flags == StatsPage::ENABLED);
+	CHECK(data.clipLeft == -1920 && data.clipRight == 0);
+	CHECK(data.targetWindow == 0 && data.targetPid == 0);
+	CHECK(data.tickP50Us >= 200 && data.tickP50Us <= 250);
+	CHECK(data.tickP99Us >= 900 && data.tickP99Us == data.tickMaxUs);
+
+	// A page with another layout, or one the writer hasn't finished setting up, is refused rather than misread
+	{
+		RawPage raw;
+		if (CHECK(raw.page != nullptr))
+		{
+			raw.page->version = StatsPage::VERSION + 1;
+			CHECK(!reader.Read(data));
+			raw.page->version = StatsPage::VERSION;
+			raw.page->magic = 0;
+			CHECK(!reader.Read(data));
+			raw.page->magic = StatsPage::MAGIC;
+			raw.page->size = sizeof(StatsPage::Data) - 8;
+			CHECK(!reader.Read(data));
+			raw.page->size = sizeof(StatsPage::Data);
+
+			// A writer stalled mid-publish: the reader gives up instead of spinning
+			raw.page->sequence.fetch_add(1);
+			CHECK(!reader.Read(data, 100));
+			raw.page->sequence.fetch_add(1);
+			CHECK(reader.Read(data));
+		}
+	}
+
+	reader.Close();
+	writer.Close();
+	CHECK(!reader.Open()); // The mapping went with the last handle
+}
+
+// The writer publishes states whose fields all derive from one counter; a reader that ever sees fields from two
+// different publishes has read a torn page
+TEST(StatsPage_NoTornReads)
+{
+	const uint32_t PUBLISHES = 1000000;
+	StatsPage::Writer writer;
+	StatsPage::Reader reader;
+	if (!CHECK(writer.Open()) || !CHECK(reader.Open()))
+		return;
+
+	std::atomic<bool> done{ false }, started{ false };
+	uint64_t reads = 0, torn = 0, backwards = 0;
+	std::thread readerThread([&]
+	{
+		StatsPage::Data data;
+		uint32_t last = 0;
+		started.store(true);
+		while (!done.load(std::memory_order_relaxed))
+		{
+			if (!reader.Read(data))
+				continue; // The writer was preempted mid-publish; giving up then is what Read() is for
+			uint32_t i = (uint32_t)data.recenters;
+			if (i && (data.flags != ((i << 5) | StatsPage::CLIPPED) || data.clipLeft != (int32_t)i || data.clipTop != -(int32_t)i ||
+				data.clipRight != (int32_t)i * 2 || data.targetWindow != i || data.escapes != i || data.clipResets != ~i))
+				torn++;
+			if (i < last)
+				backwards++;
+			last = i;
+			reads++;
+		}
+	});
+
+	while (!started.load())
+		std::this_thread::yield();
+	for (uint32_t i = 1; i <= PUBLISHES; i++)
+	{
+		writer.SetState((i << 5) | StatsPage::CLIPPED, RECT{ (LONG)i, -(LONG)i, (LONG)i * 2, 0 }, (HWND)(uintptr_t)i, 1);
+		writer.SetRecenters(i);
+		writer.SetEscapes(i, 0);
+		writer.SetClipResets(~i);
+		writer.Publish();
+	}
+	done.store(true);
+	readerThread.join();
+
+	CHECK(torn == 0);
+	CHECK(backwards == 0);
+	CHECK(reads > 0);
+	StatsPage::Data data;
+	CHECK(reader.Read(data) && data.recenters == PUBLISHES);
+	reader.Close();
+	writer.Close();
+}
+
+// Percentiles report their bucket's upper bound: never below the exact value, at most a quarter above it
+TEST(LatencyHistogram_Percentiles)
+{
+	StatsPage::LatencyHistogram histogram;
+	CHECK(histogram.Percentile(50) == 0 && histogram.Max() == 0);
+
+	for (uint32_t us = 0; us < 4; us++)
+		histogram.Add(us);
+	CHECK(histogram.Percentile(25) == 0); // Exact below 4 us
+	CHECK(histogram.Percentile(50) == 1);
+	CHECK(histogram.Percentile(100) == 3);
+
+	histogram.Reset();
+	histogram.Add(1000);
+	CHECK(histogram.Percentile(50) == 1000 && histogram.Percentile(99) == 1000); // Capped at the maximum seen
+	histogram.Add(UINT32_MAX);
+	CHECK(histogram.Max() == UINT32_MAX && histogram.Percentile(100) == UINT32_MAX);
+
+	// Values over every magnitude, against the exact percentiles
+	uint32_t seed = 0x9E3779B9;
+	std::vector<uint32_t> values;
+	histogram.Reset();
+	for (int i = 0; i < 10000; i++)
+	{
+		seed ^= seed << 13;
+		seed ^= seed >> 17;
+		seed ^= seed << 5;
+		uint32_t us = seed >> (seed % 32);
+		values.push_back(us);
+		histogram.Add(us);
+	}
+	std::sort(values.begin(), values.end());
+	for (unsigned percent : { 1, 10, 50, 90, 99, 100 })
+	{
+		uint32_t exact = values[(values.size() * percent + 99) / 100 - 1];
+		uint32_t reported = histogram.Percentile(percent);
+		if (!CHECK(reported >= exact && reported <= exact + (uint64_t)exact / 4 + 1))
+			fprintf(stderr, "    p%u: %u, exact %u\n", percent, reported, exact);
+	}
+}
+
+BENCH(StatsPage)
+{
+	StatsPage::Writer writer;
+	StatsPage::Reader reader;
+	if (!writer.Open() || !reader.Open())
+		return;
+
+	uint32_t duration = UsToQpc(150);
+	Check::Measure("StatsPage::Writer::Tick", [&] { writer.Tick(Action::Held, duration++); return 0; });
+	Check::Measure("StatsPage::Writer::Publish", [&] { writer.Publish(); return 0; });
+	StatsPage::Data data;
+	Check::Measure("StatsPage::Reader::Read (writer idle)", [&] { return reader.Read(data) ? data.recenters : 0; });
+	DWORD now = GetTickCount();
+	Check::Measure("StatsPage::Writer::UpdatePercentiles (window ends)", [&]
+	{
+		now += StatsPage::PERCENTILE_WINDOW_MS;
+		writer.UpdatePercentiles(now);
+		return 0;
+	});
+
+	// Reads while another thread publishes as fast as it can, the worst case for retries
+	std::atomic<bool> done{ false };
+	std::thread publisher([&]
+	{
+		while (!done.load(std::memory_order_relaxed))
+			writer.Publish();
+	});
+	uint64_t reads = 0, retried = 0;
+	Check::Measure("StatsPage::Reader::Read (writer publishing)", [&]
+	{
+		unsigned retries = 0;
+		bool ok = reader.Read(data, 1000, &retries);
+		reads++;
+		retried += retries ? 1 : 0;
+		return ok ? 1 : 0;
+	});
+	done.store(true);
+	publisher.join();
+	Check::Report("Reads retried while publishing", reads ? retried * 100.0 / reads : 0.0, "%");
+	reader.Close();
+	writer.Close();
+}
@@ -0,0 +1,161 @@
+// TestMain.cpp
+// SwimMouseCursor.Tests: assertions on the header-only modules, and their benchmarks
+//   SwimMouseCursor.Tests.exe                     run every test; exit code 1 if any check failed
+//   SwimMouseCursor.Tests.exe --bench [out.json]  also run the benchmarks, optionally saving the results as JSON
+//   SwimMouseCursor.Tests.exe --compare base.json new.json [percent]
+//                                                 compare two saved runs (of this or SwimMouseCursor.exe --benchmark);
+//                                                 exit code 1 if any result got slower by more than percent (default 10)
+// Tests need no desktop session and change no system state; benchmarks that do say so in their output.
+
+#include <windows.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "Check.h"
+
+static const double DEFAULT_REGRESSION_PERCENT = 10.0;
+
+static bool WriteResults(const char* path)
+{
+	FILE* out = fopen(path, "w");
+	if (!out)
+		return false;
+	fprintf(out, "{\n  \"results\": [");
+	bool first = true;
+	for (const Check::BenchResult& result : Check::Results())
+	{
+		fprintf(out, "%s\n    { \"name\": \"%s\", \"calls\": %llu, \"ns_per_call\": %.1f }", first ? "" : ",", result.name.c_str(),
+			(unsigned long long)result.calls, result.nsPerCall);
+		first = false;
+	}
+	fprintf(out, "\n  ]\n}\n");
+	fclose(out);
+	return true;
+}
+
+// Reads back the "results" list either program writes; anything else in the file is ignored
+static std::vector<Check::BenchResult> ParseResults(const std::string& text)
+{
+	std::vector<Check::BenchResult> results;
+	static const char NAME[] = "\"name\": \"", NS[] = "\"ns_per_call\": ";
+	size_t at = 0;
+	while ((at = text.find(NAME, at)) != std::string::npos)
+	{
+		at += sizeof(NAME) - 1;
+		size_t end = text.find('"', at);
+		size_t ns = text.find(NS, at);
+		size_t next = text.find(NAME, at);
+		if (end == std::string::npos || ns == std::string::npos || (next != std::string::npos && ns > next))
+			continue;
+		results.push_back({ text.substr(at, end - at), 0, strtod(text.c_str() + ns + sizeof(NS) - 1, nullptr) });
+	}
+	return results;
+}
+
+static bool ReadResults(const char* path, std::vector<Check::BenchResult>& results)
+{
+	FILE* in = fopen(path, "rb");
+	if (!in)
+		return false;
+	std::string text;
+	char buffer[4096];
+	size_t read;
+	while ((read = fread(buffer, 1, sizeof(buffer), in)) > 0)
+		text.append(buffer, read);
+	fclose(in);
+	results = ParseResults(text);
+	return !results.empty();
+}
+
+static bool Regressed(double base, double now, double percent)
+{
+	return base > 0 && now > base * (1 + percent / 100);
+}
+
+static int Compare(const char* basePath, const char* newPath, double percent)
+{
+	std::vector<Check::BenchResult> base, now;
+	if (!ReadResults(basePath, base) || !ReadResults(newPath, now))
+	{
+		fprintf(stderr, "[!] Can't read results from %s.\n", base.empty() ? basePath : newPath);
+		return 2;
+	}
+
+	unsigned regressions = 0;
+	for (const Check::BenchResult& result : now)
+	{
+		const Check::BenchResult* before = nullptr;
+		for (const Check::BenchResult& candidate : base)
+		{
+			if (candidate.name == result.name)
+			{
+				before = &candidate;
+				break;
+			}
+		}
+		if (!before)
+		{
+			printf("[~] %-48s %12.1f (new)\n", result.name.c_str(), result.nsPerCall);
+			continue;
+		}
+		bool regressed = Regressed(before->nsPerCall, result.nsPerCall, percent);
+		regressions += regressed ? 1 : 0;
+		printf("%s %-48s %12.1f -> %10.1f (%+.1f%%)\n", regressed ? "[!]" : "[*]", result.name.c_str(), before->nsPerCall,
+			result.nsPerCall, before->nsPerCall > 0 ? (result.nsPerCall / before->nsPerCall - 1) * 100 : 0.0);
+	}
+	printf("[=] %u of %zu results more than %.0f%% slower.\n", regressions, now.size(), percent);
+	return regressions ? 1 : 0;
+}
+
+TEST(Compare_ParseResults)
+{
+	// The shape SwimMouseCursor.exe --benchmark prints, scene first
+	std::vector<Check::BenchResult> results = ParseResults(
+		"{\n  \"scene\": { \"top_level_windows\": 40, \"visible_windows\": 12, \"foreground_is_target\": true },\n"
+		"  \"results\": [\n"
+		"    { \"name\": \"IsMinecraftWindow\", \"calls\": 1000, \"ns_per_call\": 812.5 },\n"
+		"    { \"name\": \"Loop tick\", \"calls\": 10, \"ns_per_call\": 4100.0 }\n  ]\n}\n");
+	if (CHECK(results.size() == 2))
+	{
+		CHECK(results[0].name == "IsMinecraftWindow" && results[0].nsPerCall == 812.5);
+		CHECK(results[1].name == "Loop tick" && results[1].nsPerCall == 4100.0);
+	}
+	CHECK(ParseResults("not json").empty());
+
+	CHECK(!Regressed(100, 110, 10));
+	CHECK(Regressed(100, 110.5, 10));
+	CHECK(!Regressed(100, 50, 10));
+	CHECK(!Regressed(0, 50, 10)); // Too fast to have measured
+}
+
+int main(int argc, char** argv)
+{
+	if (argc >= 4 && strcmp(argv[1], "--compare") == 0)
+		return Compare(argv[2], argv[3], argc >= 5 ? atof(argv[4]) : DEFAULT_REGRESSION_PERCENT);
+
+	bool bench = argc >= 2 && strcmp(argv[1], "--bench") == 0;
+	const char* jsonPath = bench && argc >= 3 ? argv[2] : nullptr;
+
+	for (const Check::Registered& test : Check::Tests())
+	{
+		uint64_t failuresBefore = Check::failures;
+		test.fn();
+		printf("%s %s\n", Check::failures == failuresBefore ? "[+]" : "[-]", test.name);
+	}
+	printf("[=] %zu tests, %llu checks, %llu failed.\n", Check::Tests().size(), (unsigned long long)Check::checks,
+		(unsigned long long)Check::failures);
+
+	if (bench)
+	{
+		for (const Check::Registered& benchmark : Check::Benches())
+			benchmark.fn();
+		if (jsonPath && !WriteResults(jsonPath))
+		{
+			fprintf(stderr, "[!] Can't write %s.\n", jsonPath);
+			return 1;
+		}
+	}
+	return Check::failures ? 1 : 0;
+}
@@ -0,0 +1,76 @@
+// Win32CallsTests.cpp
+// Counting shim: calls land in the tick being run or between ticks, fold into the tick's outcome, and reach the
+// totals other threads read; and what counting a call costs
+
+#include <windows.h>
+#include <cstring>
+#include "Check.h"
+#include "../Win32Calls.h"
+
+using Win32Calls::Api;
+using FlightRecorder::Action;
+
+TEST(Win32Calls_Accounting)
+{
+	Win32Calls::Table& table = Win32Calls::GetTable();
+	table = Win32Calls::Table{};
+
+	W32(GetTickCount)();
+	CHECK(table.byState[Win32Calls::BETWEEN_TICKS][(size_t)Api::GetTickCount].calls == 1);
+
+	// The wrapped function's result comes back unchanged
+	Win32Calls::BeginTick();
+	W32(GetTickCount)();
+	W32(GetTickCount)();
+	CHECK(W32(GetAsyncKeyState)(VK_F24) == GetAsyncKeyState(VK_F24));
+	CHECK(table.tick[(size_t)Api::GetTickCount].calls == 2);
+	CHECK(table.byState[(size_t)Action::Held][(size_t)Api::GetTickCount].calls == 0); // Not until the tick ends
+	Win32Calls::EndTick(Action::Held);
+
+	CHECK(table.byState[(size_t)Action::Held][(size_t)Api::GetTickCount].calls == 2);
+	CHECK(table.byState[(size_t)Action::Held][(size_t)Api::GetAsyncKeyState].calls == 1);
+	CHECK(table.ticks[(size_t)Action::Held] == 1);
+	CHECK(table.maxCallsPerTick == 3);
+	CHECK(table.tick[(size_t)Api::GetTickCount].calls == 0 && table.tick[(size_t)Api::GetTickCount].qpc == 0);
+	CHECK(!table.inTick);
+
+	// A smaller tick leaves the maximum alone; an outcome out of range counts as None
+	Win32Calls::BeginTick();
+	W32(GetTickCount)();
+	Win32Calls::EndTick(Action::Count);
+	CHECK(table.ticks[(size_t)Action::None] == 1);
+	CHECK(table.byState[(size_t)Action::None][(size_t)Api::GetTickCount].calls == 1);
+	CHECK(table.maxCallsPerTick == 3);
+
+	W32(GetTickCount)();
+	CHECK(table.byState[Win32Calls::BETWEEN_TICKS][(size_t)Api::GetTickCount].calls == 2);
+
+	// Totals add up every state, between ticks included, and only change when published
+	Win32Calls::Totals& totals = Win32Calls::GetTotals();
+	Win32Calls::PublishTotals();
+	CHECK(totals.calls[(size_t)Api::GetTickCount].load() == 5);
+	CHECK(totals.calls[(size_t)Api::GetAsyncKeyState].load() == 1);
+	CHECK(totals.calls[(size_t)Api::ClipCursor].load() == 0);
+	uint64_t qpc = 0;
+	for (size_t state = 0; state < Win32Calls::STATE_COUNT; state++)
+		qpc += table.byState[state][(size_t)Api::GetTickCount].qpc;
+	CHECK(totals.qpc[(size_t)Api::GetTickCount].load() == qpc);
+	W32(GetTickCount)();
+	CHECK(totals.calls[(size_t)Api::GetTickCount].load() == 5);
+
+	CHECK(strcmp(Win32Calls::ApiName((size_t)Api::GetAsyncKeyState), "GetAsyncKeyState") == 0);
+	CHECK(strcmp(Win32Calls::ApiName(Win32Calls::API_COUNT), "?") == 0);
+	table = Win32Calls::Table{};
+}
+
+BENCH(Win32Calls)
+{
+	Check::Measure("GetTickCount", [] { return GetTickCount(); });
+	Check::Measure("W32(GetTickCount) (counted)", [] { return W32(GetTickCount)(); });
+	Win32Calls::BeginTick();
+	Check::Measure("W32(GetTickCount) (counted, in a tick)", [] { return W32(GetTickCount)(); });
+	Win32Calls::EndTick(Action::Held);
+	Check::Measure("Win32Calls::EndTick", [] { Win32Calls::BeginTick(); Win32Calls::EndTick(Action::Held); return 0; });
+	Check::Measure("Win32Calls::PublishTotals", [] { Win32Calls::PublishTotals(); return 0; });
+	Win32Calls::GetTable() = Win32Calls::Table{};
+}
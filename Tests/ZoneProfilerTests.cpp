@@ -0,0 +1,64 @@
+// ZoneProfilerTests.cpp
+// Profile zones as a PROFILE_ZONES=1 build records them: nested zones and thread names in the exported trace,
+// and what one zone and an export of a full ring cost
+
+#define PROFILE_ZONES 1 // Only this file; ZoneProfiler.h keeps its symbols apart from the compiled-out copy
+#include <windows.h>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <thread>
+#include "Check.h"
+#include "../ZoneProfiler.h"
+
+static std::string ReadAll(const std::wstring& path)
+{
+	std::ifstream in(path.c_str(), std::ios::binary);
+	return std::string((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+}
+
+TEST(ZoneProfiler_Export)
+{
+	std::wstring path = Check::TempPath(L"SwimMouseCursor.Tests.zones.json");
+	std::thread worker([]
+	{
+		ZoneProfiler::NameThread("zone test");
+		PROFILE_ZONE("outer");
+		{
+			PROFILE_ZONE("inner");
+			Sleep(1);
+		}
+	});
+	worker.join(); // Its buffer outlives it, as at exit
+
+	CHECK(ZoneProfiler::Export(path.c_str()) >= 2);
+	std::string json = ReadAll(path);
+	CHECK(json.compare(0, 40, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n") == 0);
+	CHECK(json.size() >= 4 && json.compare(json.size() - 4, 4, "\n]}\n") == 0);
+	CHECK(json.find("\"ph\":\"M\"") != std::string::npos && json.find("\"args\":{\"name\":\"zone test\"}") != std::string::npos);
+
+	// The inner zone ends first, so it is recorded first, and it lies inside the outer one
+	size_t inner = json.find("{\"name\":\"inner\",\"ph\":\"X\"");
+	size_t outer = json.find("{\"name\":\"outer\",\"ph\":\"X\"");
+	if (CHECK(inner != std::string::npos && outer != std::string::npos && inner < outer))
+	{
+		double innerTs = atof(json.c_str() + json.find("\"ts\":", inner) + 5), innerDur = atof(json.c_str() + json.find("\"dur\":", inner) + 6);
+		double outerTs = atof(json.c_str() + json.find("\"ts\":", outer) + 5), outerDur = atof(json.c_str() + json.find("\"dur\":", outer) + 6);
+		CHECK(innerTs >= outerTs && innerTs + innerDur <= outerTs + outerDur + 0.001);
+		CHECK(innerDur >= 900); // Sleep(1), in microseconds
+	}
+
+	CHECK(ZoneProfiler::Export(L"") == -1);
+	DeleteFileW(path.c_str());
+}
+
+BENCH(ZoneProfiler)
+{
+	Check::Measure("PROFILE_ZONE (PROFILE_ZONES=1)", [] { PROFILE_ZONE("bench"); return 0; });
+
+	// The bench thread's ring is full by now: the most an export ever writes per thread
+	std::wstring path = Check::TempPath(L"SwimMouseCursor.Tests.zones.json");
+	Check::Measure("ZoneProfiler::Export (65536 zones)", [&] { return ZoneProfiler::Export(path.c_str()); });
+	DeleteFileW(path.c_str());
+}
@@ -0,0 +1,401 @@
+// Trace.h
+// Full observation trace of the clip loop, and a replay engine that re-runs ClipLogic::Tick on it
+//  - Writer: every answer the loop got from the system each tick (ClipLogic::Observations), the decision
+//            it took, matched recenter key presses and the events that change loop state between ticks.
+//            Buffered; only the poll loop writes to disk, and a record that finds the buffer full is dropped.
+//  - Replay: feeds the recorded answers back through ClipLogic::Tick (ClipLogic::ReplayWorld standing in
+//            for Win32), as fast as possible or at recorded speed, and reports every tick where the
+//            replayed decision differs from the recorded one
+//
+// File layout:
+//   header:  "SMCTRC3\0" | u64 QPC frequency | u64 QPC at open          (little endian)
+//   records: u8 kind | varint QPC delta since previous record | payload (per kind, below)
+// HWNDs and clip rects are zigzag varints relative to the previous tick's, the cursor's current clip is
+// relative to the tick's own clip rect, so a steady clipped tick costs 13 bytes, 17 when the clip is verified
+// (about 5 MB per hour at the default 10 ms poll). Version 2: ticks ask VerifyDue() instead of always
+// reading the current clip. Version 3: the clip read back after each apply (ClipReadBack records).
+
+#pragma once
+#include <windows.h>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <vector>
+#include "ClipLogic.h"
+
+namespace Trace
+{
+
+	enum class Kind : uint8_t
+	{
+		Tick = 1,    // payload: u8 asked, u8 answers, [hwnd], [u8 visible %], [clip rect], [current clip], u8 decision, [u8 reason]
+		RecenterKey, // payload: u8 vk, varint key time delta, u8 KeyOutcome
+		Disabled,    // payload: u8 a clip was dropped (safety hotkey, between ticks)
+		ForceUpdate, // Config reload: the next usable rect is applied unconditionally
+		ClipReadBack, // payload: rect GetClipCursor reported after an apply, relative to the last tick's clip rect
+		Count
+	};
+
+	// What became of a key-down that matched the recenter binding
+	enum class KeyOutcome : uint8_t
+	{
+		Repeat,
+		Debounced,
+		Ineligible,
+		Executed,
+		Count
+	};
+
+	static const char FILE_MAGIC[8] = { 'S', 'M', 'C', 'T', 'R', 'C', '3', '\0' };
+
+	// Decision byte: action in bits 0-2, ClipOp in bits 3-4, then changed, eligible, released
+	inline uint8_t PackDecision(const ClipLogic::Decision& d)
+	{
+		return (uint8_t)((uint8_t)d.action | ((uint8_t)d.op << 3) | (d.changed ? 0x20 : 0) | (d.eligible ? 0x40 : 0) | (d.released ? 0x80 : 0));
+	}
+
+	// Single-threaded: the poll loop and the input callbacks all run on the main thread
+	class Writer
+	{
+	public:
+		bool Open(const wchar_t* path)
+		{
+			file = CreateFileW(path, GENERIC_WRITE, FILE_SHARE_READ, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+			if (file == INVALID_HANDLE_VALUE)
+			{
+				file = nullptr;
+				return false;
+			}
+
+			LARGE_INTEGER freq, now;
+			QueryPerformanceFrequency(&freq);
+			QueryPerformanceCounter(&now);
+			lastQpc = (uint64_t)now.QuadPart;
+
+			for (char c : FILE_MAGIC) buffer[used++] = (uint8_t)c;
+			PutFixed64((uint64_t)freq.QuadPart);
+			PutFixed64(lastQpc);
+			return true;
+		}
+
+		bool IsOpen() const { return file != nullptr; }
+
+		void Close()
+		{
+			if (!file) return;
+			Flush();
+			CloseHandle(file);
+			file = nullptr;
+		}
+
+		void Flush()
+		{
+			if (!file || used == 0) return;
+			DWORD written = 0;
+			WriteFile(file, buffer, (DWORD)used, &written, nullptr);
+			used = 0;
+		}
+
+		// From the poll loop between its periodic flushes, so the buffer always has room for what the hook adds
+		void FlushIfFull()
+		{
+			if (used >= BUFFER_SIZE / 2)
+				Flush();
+		}
+
+		// Records lost because the buffer was full
+		uint64_t Dropped() const { return dropped; }
+
+		void Tick(const ClipLogic::Observations& seen, const ClipLogic::Decision& d)
+		{
+			if (!Begin(Kind::Tick)) return;
+			buffer[used++] = seen.asked;
+			buffer[used++] = seen.answers;
+			if (seen.asked & ClipLogic::FOREGROUND)
+			{
+				uint64_t value = (uint64_t)(uintptr_t)seen.foreground;
+				PutVarint(EventLog::ZigZag((int64_t)(value - lastHwnd)));
+				lastHwnd = value;
+			}
+			if (seen.asked & ClipLogic::VISIBLE)
+				buffer[used++] = seen.visiblePercent;
+			if (seen.asked & ClipLogic::CLIP_RECT)
+			{
+				PutRect(seen.clip, lastClip);
+				lastClip = seen.clip;
+			}
+			if (seen.asked & ClipLogic::CURRENT_CLIP)
+				PutRect(seen.currentClip, seen.clip);
+			buffer[used++] = PackDecision(d);
+			if (d.released)
+				buffer[used++] = (uint8_t)d.reason;
+		}
+
+		// Only key-downs that matched the recenter binding are recorded, never general typing
+		void RecenterKey(WORD vk, DWORD time, KeyOutcome outcome)
+		{
+			if (!Begin(Kind::RecenterKey)) return;
+			buffer[used++] = (uint8_t)vk;
+			PutVarint((uint32_t)(time - lastKeyTime));
+			buffer[used++] = (uint8_t)outcome;
+			lastKeyTime = time;
+		}
+
+		void Disabled(bool wasClipped)
+		{
+			if (!Begin(Kind::Disabled)) return;
+			buffer[used++] = wasClipped ? 1 : 0;
+		}
+
+		void ForceUpdate() { Begin(Kind::ForceUpdate); }
+
+		void ClipReadBack(const RECT& effective)
+		{
+			if (!Begin(Kind::ClipReadBack)) return;
+			PutRect(effective, lastClip);
+		}
+
+	private:
+		// Largest record: kind + timestamp + 2 flag bytes + hwnd + 8 rect edges + 3 single bytes
+		static const size_t MAX_RECORD = 1 + 10 + 2 + 10 + 10 * 8 + 3;
+		static const size_t BUFFER_SIZE = 64 * 1024;
+
+		bool Begin(Kind kind)
+		{
+			if (!file) return false;
+			if (BUFFER_SIZE - used < MAX_RECORD)
+			{
+				// Never write from here: records also come from the keyboard hook, which must not wait on the disk
+				dropped++;
+				return false;
+			}
+
+			LARGE_INTEGER now;
+			QueryPerformanceCounter(&now);
+			buffer[used++] = (uint8_t)kind;
+			PutVarint((uint64_t)now.QuadPart - lastQpc);
+			lastQpc = (uint64_t)now.QuadPart;
+			return true;
+		}
+
+		void PutVarint(uint64_t v)
+		{
+			while (v >= 0x80)
+			{
+				buffer[used++] = (uint8_t)(v | 0x80);
+				v >>= 7;
+			}
+			buffer[used++] = (uint8_t)v;
+		}
+
+		void PutFixed64(uint64_t v)
+		{
+			for (int i = 0; i < 8; i++)
+				buffer[used++] = (uint8_t)(v >> (i * 8));
+		}
+
+		void PutRect(const RECT& rc, const RECT& base)
+		{
+			PutVarint(EventLog::ZigZag((int64_t)rc.left - base.left));
+			PutVarint(EventLog::ZigZag((int64_t)rc.top - base.top));
+			PutVarint(EventLog::ZigZag((int64_t)rc.right - base.right));
+			PutVarint(EventLog::ZigZag((int64_t)rc.bottom - base.bottom));
+		}
+
+		HANDLE file = nullptr;
+		uint8_t buffer[BUFFER_SIZE];
+		size_t used = 0;
+		uint64_t dropped = 0;
+		uint64_t lastQpc = 0;
+		uint64_t lastHwnd = 0;
+		RECT lastClip{};
+		DWORD lastKeyTime = 0;
+	};
+
+	struct ReplayResult
+	{
+		uint64_t ticks = 0;
+		uint64_t keys = 0;
+		uint64_t divergences = 0;
+		double recordedSeconds = 0;
+		double replaySeconds = 0;
+	};
+
+	// Replays a trace and prints each divergence (up to a limit) to `out`. realtime sleeps between records
+	// to reproduce the recorded pacing. Returns false on a bad or truncated file.
+	inline bool Replay(const wchar_t* path, bool realtime, FILE* out, ReplayResult& result)
+	{
+		std::ifstream in(path, std::ios::binary);
+		if (!in.is_open())
+			return false;
+		std::vector<uint8_t> data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+
+		size_t pos = 0;
+		auto getVarint = [&](uint64_t& v) -> bool
+		{
+			v = 0;
+			for (int shift = 0; shift < 64 && pos < data.size(); shift += 7)
+			{
+				uint8_t b = data[pos++];
+				v |= (uint64_t)(b & 0x7F) << shift;
+				if (!(b & 0x80)) return true;
+			}
+			return false;
+		};
+		auto getFixed64 = [&]() -> uint64_t
+		{
+			uint64_t v = 0;
+			for (int i = 0; i < 8; i++) v |= (uint64_t)data[pos++] << (i * 8);
+			return v;
+		};
+		auto getByte = [&](uint8_t& v) -> bool
+		{
+			if (pos >= data.size()) return false;
+			v = data[pos++];
+			return true;
+		};
+		auto getRect = [&](RECT& rc, const RECT& base) -> bool
+		{
+			LONG* edges[] = { &rc.left, &rc.top, &rc.right, &rc.bottom };
+			const LONG bases[] = { base.left, base.top, base.right, base.bottom };
+			for (int i = 0; i < 4; i++)
+			{
+				uint64_t v;
+				if (!getVarint(v)) return false;
+				*edges[i] = (LONG)(bases[i] + EventLog::UnZigZag(v));
+			}
+			return true;
+		};
+
+		if (data.size() < 24 || memcmp(data.data(), FILE_MAGIC, sizeof(FILE_MAGIC)) != 0)
+			return false;
+		pos = sizeof(FILE_MAGIC);
+		uint64_t freq = getFixed64();
+		getFixed64(); // QPC at open; timestamps below are relative to it
+		if (freq == 0)
+			return false;
+
+		const uint64_t MAX_REPORTED = 20;
+		LARGE_INTEGER replayStart, localFreq;
+		QueryPerformanceCounter(&replayStart);
+		QueryPerformanceFrequency(&localFreq);
+
+		ClipLogic::State state;
+		bool eligible = false; // Verdict the keyboard hook would have seen (last tick's)
+		uint64_t elapsed = 0;
+		uint64_t hwnd = 0;
+		RECT lastClip{};
+		bool ok = true;
+
+		auto diverged = [&](const char* what, uint64_t recorded, uint64_t replayed)
+		{
+			if (result.divergences++ < MAX_REPORTED)
+				fprintf(out, "[%12.3f ms] tick %llu: %s recorded %llu, replayed %llu\n", elapsed * 1000.0 / freq,
+					(unsigned long long)result.ticks, what, (unsigned long long)recorded, (unsigned long long)replayed);
+		};
+
+		while (pos < data.size())
+		{
+			Kind kind = (Kind)data[pos++];
+			uint64_t delta;
+			if (!getVarint(delta)) { ok = false; break; }
+			elapsed += delta;
+
+			if (realtime)
+			{
+				// Sleep to the record's offset from the start, so pacing errors don't accumulate
+				LARGE_INTEGER now;
+				QueryPerformanceCounter(&now);
+				uint64_t due = (uint64_t)replayStart.QuadPart + (uint64_t)((double)elapsed * localFreq.QuadPart / freq);
+				if ((uint64_t)now.QuadPart < due)
+					Sleep((DWORD)((due - (uint64_t)now.QuadPart) * 1000 / localFreq.QuadPart));
+			}
+
+			if (kind == Kind::Tick)
+			{
+				ClipLogic::Observations seen;
+				uint8_t packed = 0, reason = 0;
+				if (!getByte(seen.asked) || !getByte(seen.answers)) { ok = false; break; }
+				if (seen.asked & ClipLogic::FOREGROUND)
+				{
+					uint64_t v;
+					if (!getVarint(v)) { ok = false; break; }
+					hwnd += (uint64_t)EventLog::UnZigZag(v);
+					seen.foreground = (HWND)(uintptr_t)hwnd;
+				}
+				if ((seen.asked & ClipLogic::VISIBLE) && !getByte(seen.visiblePercent)) { ok = false; break; }
+				if (seen.asked & ClipLogic::CLIP_RECT)
+				{
+					if (!getRect(seen.clip, lastClip)) { ok = false; break; }
+					lastClip = seen.clip;
+				}
+				if ((seen.asked & ClipLogic::CURRENT_CLIP) && !getRect(seen.currentClip, seen.clip)) { ok = false; break; }
+				if (!getByte(packed) || ((packed & 0x80) && !getByte(reason))) { ok = false; break; }
+
+				result.ticks++;
+				ClipLogic::ReplayWorld world{ seen };
+				ClipLogic::Decision d = ClipLogic::Tick(state, world);
+				eligible = d.eligible;
+
+				if (world.asked != seen.asked)
+					diverged("questions asked (bits)", seen.asked, world.asked);
+				else if (PackDecision(d) != packed)
+					diverged("decision (action|op<<3|changed|eligible|released)", packed, PackDecision(d));
+				else if (d.released && (uint8_t)d.reason != reason)
+					diverged("release reason", reason, (uint8_t)d.reason);
+			}
+			else if (kind == Kind::RecenterKey)
+			{
+				uint8_t vk, outcome;
+				uint64_t timeDelta;
+				if (!getByte(vk) || !getVarint(timeDelta) || !getByte(outcome)) { ok = false; break; }
+				result.keys++;
+
+				// Repeats and debouncing don't depend on the clip logic; eligibility does
+				if (outcome == (uint8_t)KeyOutcome::Ineligible || outcome == (uint8_t)KeyOutcome::Executed)
+				{
+					bool recordedEligible = outcome == (uint8_t)KeyOutcome::Executed;
+					if (recordedEligible != eligible)
+						diverged("recenter eligibility", recordedEligible, eligible);
+				}
+			}
+			else if (kind == Kind::Disabled)
+			{
+				uint8_t wasClipped;
+				if (!getByte(wasClipped)) { ok = false; break; }
+				bool replayed = ClipLogic::Disable(state);
+				if (replayed != (wasClipped != 0))
+					diverged("clip dropped by safety hotkey", wasClipped, replayed);
+			}
+			else if (kind == Kind::ForceUpdate)
+			{
+				state.needsClipUpdate = true;
+			}
+			else if (kind == Kind::ClipReadBack)
+			{
+				RECT effective;
+				if (!getRect(effective, lastClip)) { ok = false; break; }
+				ClipLogic::ClipReadBack(state, effective);
+			}
+			else
+			{
+				ok = false;
+				break;
+			}
+		}
+
+		LARGE_INTEGER replayEnd;
+		QueryPerformanceCounter(&replayEnd);
+		result.recordedSeconds = (double)elapsed / freq;
+		result.replaySeconds = (double)(replayEnd.QuadPart - replayStart.QuadPart) / localFreq.QuadPart;
+		if (result.divergences > MAX_REPORTED)
+			fprintf(out, "... %llu more divergences not shown\n", (unsigned long long)(result.divergences - MAX_REPORTED));
+
+		if (!ok)
+			fprintf(stderr, "Truncated or corrupt trace at byte %zu.\n", pos);
+		return ok;
+	}
+
+}
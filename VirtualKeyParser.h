@@ -4,7 +4,7 @@
 
 #pragma once
 #include <windows.h>
-#include <string>
+#include <string_view>
 #include <unordered_map>
 #include <algorithm>
 #include <cctype>
@@ -12,19 +12,10 @@
 namespace VirtualKeyParser
 {
 
-	// Convert string to uppercase for case-insensitive comparison
-	inline std::string ToUpper(const std::string& str)
+	// Map of common key name strings to virtual key codes. Keys view string literals, so lookups build no strings.
+	inline const std::unordered_map<std::string_view, WORD>& GetKeyNameMap()
 	{
-		std::string result = str;
-		std::transform(result.begin(), result.end(), result.begin(),
-			[](unsigned char c) { return std::toupper(c); });
-		return result;
-	}
-
-	// Map of common key name strings to virtual key codes
-	inline const std::unordered_map<std::string, WORD>& GetKeyNameMap()
-	{
-		static const std::unordered_map<std::string, WORD> keyMap = {
+		static const std::unordered_map<std::string_view, WORD> keyMap = {
 			// Letter keys (A-Z)
 			{"A", 'A'}, {"B", 'B'}, {"C", 'C'}, {"D", 'D'}, {"E", 'E'},
 			{"F", 'F'}, {"G", 'G'}, {"H", 'H'}, {"I", 'I'}, {"J", 'J'},
@@ -106,23 +97,24 @@ namespace VirtualKeyParser
 
 	// Parse a key name string and return the virtual key code
 	// Returns 0 if the key name is invalid
-	inline WORD ParseKeyName(const std::string& keyName)
+	inline WORD ParseKeyName(std::string_view keyName)
 	{
-		if (keyName.empty())
-			return 0;
-
-		// Convert to uppercase for case-insensitive matching
-		std::string upperKey = ToUpper(keyName);
-
 		// Trim whitespace
-		while (!upperKey.empty() && std::isspace(static_cast<unsigned char>(upperKey.back())))
-			upperKey.pop_back();
-		while (!upperKey.empty() && std::isspace(static_cast<unsigned char>(upperKey.front())))
-			upperKey.erase(0, 1);
+		while (!keyName.empty() && std::isspace(static_cast<unsigned char>(keyName.back())))
+			keyName.remove_suffix(1);
+		while (!keyName.empty() && std::isspace(static_cast<unsigned char>(keyName.front())))
+			keyName.remove_prefix(1);
 
-		if (upperKey.empty())
+		// Longest name in the map is 13 characters, so anything longer is invalid anyway
+		if (keyName.empty() || keyName.size() > 15)
 			return 0;
 
+		// Convert to uppercase for case-insensitive matching, on the stack
+		char upper[16];
+		for (size_t i = 0; i < keyName.size(); i++)
+			upper[i] = static_cast<char>(std::toupper(static_cast<unsigned char>(keyName[i])));
+		std::string_view upperKey(upper, keyName.size());
+
 		// Look up in the key map
 		const auto& keyMap = GetKeyNameMap();
 		auto it = keyMap.find(upperKey);
@@ -145,14 +137,18 @@ namespace VirtualKeyParser
 		return 0;
 	}
 
-	// Get a human-readable name for a virtual key code
-	inline std::string GetKeyNameFromVK(WORD vkCode)
+	// Get a human-readable name for a virtual key code. Always a static string, and one that ParseKeyName
+	// accepts for every key it can return.
+	inline const char* GetKeyNameFromVK(WORD vkCode)
 	{
 		// Check single letters and numbers first
-		if ((vkCode >= 'A' && vkCode <= 'Z') || (vkCode >= '0' && vkCode <= '9'))
-		{
-			return std::string(1, static_cast<char>(vkCode));
-		}
+		static const char letters[26][2] = { "A", "B", "C", "D", "E", "F", "G", "H", "I", "J", "K", "L", "M",
+			"N", "O", "P", "Q", "R", "S", "T", "U", "V", "W", "X", "Y", "Z" };
+		static const char digits[10][2] = { "0", "1", "2", "3", "4", "5", "6", "7", "8", "9" };
+		if (vkCode >= 'A' && vkCode <= 'Z')
+			return letters[vkCode - 'A'];
+		if (vkCode >= '0' && vkCode <= '9')
+			return digits[vkCode - '0'];
 
 		// Special cases for common keys
 		switch (vkCode)
@@ -175,6 +171,12 @@ namespace VirtualKeyParser
 			case VK_SHIFT: return "SHIFT";
 			case VK_CONTROL: return "CTRL";
 			case VK_MENU: return "ALT";
+			case VK_LSHIFT: return "LSHIFT";
+			case VK_RSHIFT: return "RSHIFT";
+			case VK_LCONTROL: return "LCTRL";
+			case VK_RCONTROL: return "RCTRL";
+			case VK_LMENU: return "LALT";
+			case VK_RMENU: return "RALT";
 			case VK_F1: return "F1";
 			case VK_F2: return "F2";
 			case VK_F3: return "F3";
@@ -187,8 +189,89 @@ namespace VirtualKeyParser
 			case VK_F10: return "F10";
 			case VK_F11: return "F11";
 			case VK_F12: return "F12";
+			case VK_NUMPAD0: return "NUMPAD0";
+			case VK_NUMPAD1: return "NUMPAD1";
+			case VK_NUMPAD2: return "NUMPAD2";
+			case VK_NUMPAD3: return "NUMPAD3";
+			case VK_NUMPAD4: return "NUMPAD4";
+			case VK_NUMPAD5: return "NUMPAD5";
+			case VK_NUMPAD6: return "NUMPAD6";
+			case VK_NUMPAD7: return "NUMPAD7";
+			case VK_NUMPAD8: return "NUMPAD8";
+			case VK_NUMPAD9: return "NUMPAD9";
+			case VK_OEM_1: return "SEMICOLON";
+			case VK_OEM_PLUS: return "PLUS";
+			case VK_OEM_COMMA: return "COMMA";
+			case VK_OEM_MINUS: return "MINUS";
+			case VK_OEM_PERIOD: return "PERIOD";
+			case VK_OEM_2: return "SLASH";
+			case VK_OEM_3: return "TILDE";
+			case VK_OEM_4: return "LEFTBRACKET";
+			case VK_OEM_5: return "BACKSLASH";
+			case VK_OEM_6: return "RIGHTBRACKET";
+			case VK_OEM_7: return "QUOTE";
 			default: return "UNKNOWN";
 		}
 	}
 
+
+	// Maximum number of keys in a single chord, e.g. CTRL+SHIFT+ALT+R
+	constexpr size_t MAX_CHORD_KEYS = 4;
+
+	// A key combination in the order it was written, e.g. "CTRL+SHIFT+R" -> { VK_CONTROL, VK_SHIFT, 'R' }
+	struct KeyChord
+	{
+		WORD keys[MAX_CHORD_KEYS] = {};
+		size_t count = 0;
+	};
+
+	// Parse a '+'-separated chord such as "CTRL+SHIFT+R" or "LALT+F". A single key name is a one-key chord.
+	// Returns false (and leaves out.count == 0) if any part is invalid, repeated, or there are too many keys.
+	inline bool ParseChord(std::string_view chordText, KeyChord& out)
+	{
+		out = KeyChord{};
+
+		size_t start = 0;
+		while (start <= chordText.size())
+		{
+			size_t end = chordText.find('+', start);
+			if (end == std::string_view::npos)
+				end = chordText.size();
+
+			WORD vk = ParseKeyName(chordText.substr(start, end - start));
+			if (vk == 0 || out.count == MAX_CHORD_KEYS ||
+				std::find(out.keys, out.keys + out.count, vk) != out.keys + out.count)
+			{
+				out = KeyChord{};
+				return false;
+			}
+			out.keys[out.count++] = vk;
+			start = end + 1;
+		}
+
+		return out.count > 0;
+	}
+
+	// Fixed-capacity chord name: at most MAX_CHORD_KEYS names of up to 12 characters (RIGHTBRACKET), plus separators
+	struct ChordName
+	{
+		char text[MAX_CHORD_KEYS * 13 + 1] = {};
+
+		const char* c_str() const { return text; }
+	};
+
+	// Get a human-readable name for a chord, e.g. "CTRL+SHIFT+R"
+	inline ChordName GetChordName(const KeyChord& chord)
+	{
+		ChordName name;
+		size_t used = 0;
+		for (size_t i = 0; i < chord.count && i < MAX_CHORD_KEYS; i++)
+		{
+			if (i) name.text[used++] = '+';
+			for (const char* p = GetKeyNameFromVK(chord.keys[i]); *p && used < sizeof(name.text) - 1; p++)
+				name.text[used++] = *p;
+		}
+		return name;
+	}
+
 }
\ No newline at end of file
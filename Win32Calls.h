@@ -0,0 +1,218 @@
+// Win32Calls.h
+// Counting shim for the Win32 calls of the main thread: per-API call counts and time, per poll tick and
+// per tick outcome (FlightRecorder::Action), plus a bucket for everything between ticks
+//  - W32(Fn)(args...): calls ::Fn and accounts for it, e.g. W32(GetForegroundWindow)()
+//  - BeginTick()/EndTick(action): bracket one poll tick
+//  - Dump(): table through Log(), on the diagnostics hotkey and at exit
+//  - PublishTotals(): per-API totals into atomics, for readers on other threads (metrics export)
+// Main thread only (poll loop, message pump, hooks); other threads call Win32 directly.
+// Build with /DWIN32_CALL_STATS=0 to compile the shim out entirely.
+
+#pragma once
+#include <windows.h>
+#include <cstdint>
+#include "FlightRecorder.h"
+#include "Logger.h"
+
+#ifndef WIN32_CALL_STATS
+#define WIN32_CALL_STATS 1
+#endif
+
+#define WIN32_CALL_LIST(X) \
+	X(GetForegroundWindow) X(IsWindow) X(IsWindowVisible) X(IsIconic) X(GetWindowRect) X(GetClientRect) \
+	X(ClientToScreen) X(GetWindowThreadProcessId) X(GetGUIThreadInfo) X(GetAncestor) X(WindowFromPoint) \
+	X(GetCapture) X(GetAsyncKeyState) X(GetCursorPos) X(SendMessageW) X(GetClassNameW) X(GetWindowTextW) \
+	X(OpenProcess) X(QueryFullProcessImageNameW) X(CloseHandle) X(ClipCursor) X(GetClipCursor) \
+	X(SetCursorPos) X(GetSystemMetrics) X(PeekMessageW) X(TranslateMessage) X(DispatchMessageW) X(GetTickCount) X(Sleep)
+
+namespace Win32Calls
+{
+
+	enum class Api : uint8_t
+	{
+#define WIN32_CALL_ENUM(name) name,
+		WIN32_CALL_LIST(WIN32_CALL_ENUM)
+#undef WIN32_CALL_ENUM
+		Count
+	};
+
+	inline const char* ApiName(size_t api)
+	{
+#define WIN32_CALL_NAME(name) #name,
+		static const char* names[] = { WIN32_CALL_LIST(WIN32_CALL_NAME) };
+#undef WIN32_CALL_NAME
+		return api < (size_t)Api::Count ? names[api] : "?";
+	}
+
+	constexpr size_t API_COUNT = (size_t)Api::Count;
+	constexpr size_t BETWEEN_TICKS = (size_t)FlightRecorder::Action::Count; // Extra state after the tick outcomes
+	constexpr size_t STATE_COUNT = BETWEEN_TICKS + 1;
+
+	struct Counter
+	{
+		uint64_t calls = 0;
+		uint64_t qpc = 0;
+	};
+
+	struct Table
+	{
+		Counter tick[API_COUNT];                 // Current tick, folded into byState by EndTick()
+		Counter byState[STATE_COUNT][API_COUNT];
+		uint64_t ticks[STATE_COUNT] = {};
+		uint64_t maxCallsPerTick = 0;
+		bool inTick = false;
+	};
+
+	inline Table& GetTable()
+	{
+		static Table table;
+		return table;
+	}
+
+	// Per-API totals over all states as of the last PublishTotals(); readable from any thread
+	struct Totals
+	{
+		std::atomic<uint64_t> calls[API_COUNT] = {};
+		std::atomic<uint64_t> qpc[API_COUNT] = {};
+	};
+
+	inline Totals& GetTotals()
+	{
+		static Totals totals;
+		return totals;
+	}
+
+	// Main thread, about once a second: a few hundred adds, nothing per call
+	inline void PublishTotals()
+	{
+		const Table& table = GetTable();
+		Totals& totals = GetTotals();
+		for (size_t api = 0; api < API_COUNT; api++)
+		{
+			uint64_t calls = 0, qpc = 0;
+			for (size_t state = 0; state < STATE_COUNT; state++)
+			{
+				calls += table.byState[state][api].calls;
+				qpc += table.byState[state][api].qpc;
+			}
+			totals.calls[api].store(calls, std::memory_order_relaxed);
+			totals.qpc[api].store(qpc, std::memory_order_relaxed);
+		}
+	}
+
+	inline uint64_t Now()
+	{
+		LARGE_INTEGER now;
+		QueryPerformanceCounter(&now);
+		return (uint64_t)now.QuadPart;
+	}
+
+	inline void Record(Api api, uint64_t elapsed)
+	{
+		Table& table = GetTable();
+		Counter& counter = table.inTick ? table.tick[(size_t)api] : table.byState[BETWEEN_TICKS][(size_t)api];
+		counter.calls++;
+		counter.qpc += elapsed;
+	}
+
+	inline void BeginTick()
+	{
+		GetTable().inTick = true;
+	}
+
+	inline void EndTick(FlightRecorder::Action action)
+	{
+		Table& table = GetTable();
+		size_t state = (size_t)action < BETWEEN_TICKS ? (size_t)action : 0;
+		uint64_t calls = 0;
+		for (size_t api = 0; api < API_COUNT; api++)
+		{
+			Counter& counter = table.tick[api];
+			table.byState[state][api].calls += counter.calls;
+			table.byState[state][api].qpc += counter.qpc;
+			calls += counter.calls;
+			counter = Counter{};
+		}
+		table.ticks[state]++;
+		if (calls > table.maxCallsPerTick)
+			table.maxCallsPerTick = calls;
+		table.inTick = false;
+	}
+
+	// Wraps one function; the call is timed from just before to just after, arguments already evaluated
+	template <Api api, class Fn>
+	struct Counted
+	{
+		Fn fn;
+
+		template <class... Args>
+		auto operator()(Args&&... args) const
+		{
+			struct Timer
+			{
+				uint64_t start = Now();
+				~Timer() { Record(api, Now() - start); }
+			} timer;
+			return fn(static_cast<Args&&>(args)...);
+		}
+	};
+
+	inline void Dump()
+	{
+#if WIN32_CALL_STATS
+		const Table& table = GetTable();
+		LARGE_INTEGER freq;
+		QueryPerformanceFrequency(&freq);
+		double usPerQpc = 1000000.0 / freq.QuadPart;
+
+		uint64_t allTicks = 0, allCalls = 0, allQpc = 0;
+		for (size_t state = 0; state < BETWEEN_TICKS; state++)
+		{
+			allTicks += table.ticks[state];
+			for (const Counter& counter : table.byState[state])
+			{
+				allCalls += counter.calls;
+				allQpc += counter.qpc;
+			}
+		}
+		Log(L"[*] Win32 calls: %llu ticks, %.1f calls and %.1f us per tick on average, %llu calls at most.", allTicks,
+			allTicks ? (double)allCalls / allTicks : 0.0, allTicks ? allQpc * usPerQpc / allTicks : 0.0, table.maxCallsPerTick);
+
+		for (size_t state = 0; state < STATE_COUNT; state++)
+		{
+			uint64_t calls = 0, qpc = 0;
+			for (const Counter& counter : table.byState[state])
+			{
+				calls += counter.calls;
+				qpc += counter.qpc;
+			}
+			if (!calls)
+				continue;
+
+			// Per-tick figures for tick outcomes, totals for the time between ticks
+			uint64_t ticks = state < BETWEEN_TICKS ? table.ticks[state] : 0;
+			if (ticks)
+				Log(L"[*]   %S: %llu ticks, %.1f calls and %.1f us per tick.", FlightRecorder::ActionName((uint8_t)state), ticks,
+					(double)calls / ticks, qpc * usPerQpc / ticks);
+			else
+				Log(L"[*]   Between ticks: %llu calls, %.1f ms.", calls, qpc * usPerQpc / 1000);
+
+			for (size_t api = 0; api < API_COUNT; api++)
+			{
+				const Counter& counter = table.byState[state][api];
+				if (!counter.calls)
+					continue;
+				Log(L"[*]     %-28S %10llu calls %8.2f/tick %10.2f ms %8.0f ns/call", ApiName(api), counter.calls,
+					ticks ? (double)counter.calls / ticks : 0.0, counter.qpc * usPerQpc / 1000, counter.qpc * usPerQpc * 1000 / counter.calls);
+			}
+		}
+#endif
+	}
+
+}
+
+#if WIN32_CALL_STATS
+#define W32(fn) (Win32Calls::Counted<Win32Calls::Api::fn, decltype(&::fn)>{ &::fn })
+#else
+#define W32(fn) ::fn
+#endif
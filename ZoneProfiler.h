@@ -0,0 +1,201 @@
+// ZoneProfiler.h
+// Scoped timing zones for timeline profiling, exported as a Chrome trace-event JSON file
+// (load it in chrome://tracing or ui.perfetto.dev)
+//  - PROFILE_ZONE("name"): times the rest of the enclosing scope. The name must be a string literal.
+//  - NameThread("name"): label for the calling thread's row in the timeline
+//  - Export(path): writes every thread's buffered zones. Exact for threads that are idle or gone; a thread
+//    still recording may overwrite its oldest zones while they are being written out.
+// Each thread records into its own ring of the last EVENTS_PER_THREAD zones, so recording takes no lock.
+// Compiled out unless built with /DPROFILE_ZONES=1; --benchmark reports the cost of one zone, and so does
+// SwimMouseCursor.Tests.exe --bench in any build.
+
+#pragma once
+#include <windows.h>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <vector>
+
+#ifndef PROFILE_ZONES
+#define PROFILE_ZONES 0
+#endif
+
+namespace ZoneProfiler
+{
+
+	struct Event
+	{
+		const char* name;
+		uint64_t begin; // QPC
+		uint64_t end;
+	};
+
+	constexpr size_t EVENTS_PER_THREAD = 1 << 16;
+
+	struct Buffer
+	{
+		DWORD threadId = 0;
+		const char* threadName = nullptr;
+		std::atomic<uint64_t> head{ 0 }; // Zones ever recorded; the ring holds the last EVENTS_PER_THREAD
+		Event events[EVENTS_PER_THREAD];
+	};
+
+	// Buffers outlive their threads so an export at exit still sees them
+	struct Registry
+	{
+		std::mutex lock;
+		std::vector<Buffer*> buffers;
+	};
+
+	inline Registry& GetRegistry()
+	{
+		static Registry registry;
+		return registry;
+	}
+
+	inline Buffer* RegisterThread()
+	{
+		Buffer* buffer = new Buffer();
+		buffer->threadId = GetCurrentThreadId();
+		Registry& registry = GetRegistry();
+		std::lock_guard<std::mutex> guard(registry.lock);
+		registry.buffers.push_back(buffer);
+		return buffer;
+	}
+
+	inline Buffer& ThreadBuffer()
+	{
+		thread_local Buffer* buffer = RegisterThread();
+		return *buffer;
+	}
+
+	inline uint64_t Now()
+	{
+		LARGE_INTEGER now;
+		QueryPerformanceCounter(&now);
+		return (uint64_t)now.QuadPart;
+	}
+
+	inline void Record(const char* name, uint64_t begin, uint64_t end)
+	{
+		Buffer& buffer = ThreadBuffer();
+		uint64_t head = buffer.head.load(std::memory_order_relaxed);
+		buffer.events[head % EVENTS_PER_THREAD] = Event{ name, begin, end };
+		buffer.head.store(head + 1, std::memory_order_release);
+	}
+
+	struct Zone
+	{
+		const char* name;
+		uint64_t begin;
+
+		explicit Zone(const char* n) : name(n), begin(Now()) {}
+		~Zone() { Record(name, begin, Now()); }
+		Zone(const Zone&) = delete;
+		Zone& operator=(const Zone&) = delete;
+	};
+
+	// The two builds get their own symbols, so a file built with PROFILE_ZONES=1 (the zone benchmark in the
+	// tests) links with files built without it
+#if PROFILE_ZONES
+	inline namespace Enabled
+#else
+	inline namespace CompiledOut
+#endif
+	{
+		inline void NameThread(const char* name)
+		{
+#if PROFILE_ZONES
+			ThreadBuffer().threadName = name;
+#else
+			(void)name;
+#endif
+		}
+
+		// Returns the number of zones written, or -1 if the file couldn't be written
+		inline int64_t Export(const wchar_t* path)
+		{
+#if PROFILE_ZONES
+			HANDLE file = CreateFileW(path, GENERIC_WRITE, FILE_SHARE_READ, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+			if (file == INVALID_HANDLE_VALUE)
+				return -1;
+
+			// Formatted into a buffer that is written out whenever it runs low
+			static char text[64 * 1024];
+			size_t used = 0;
+			bool ok = true;
+			auto flush = [&] {
+				DWORD transferred = 0;
+				ok = ok && WriteFile(file, text, (DWORD)used, &transferred, nullptr) && transferred == used;
+				used = 0;
+			};
+			auto append = [&](const char* fmt, auto... args) {
+				if (sizeof(text) - used < 512)
+					flush();
+				int n = snprintf(text + used, sizeof(text) - used, fmt, args...);
+				if (n > 0)
+					used += (size_t)n < sizeof(text) - used ? (size_t)n : sizeof(text) - used - 1;
+			};
+
+			LARGE_INTEGER freq;
+			QueryPerformanceFrequency(&freq);
+			double usPerQpc = 1000000.0 / freq.QuadPart;
+			DWORD pid = GetCurrentProcessId();
+
+			Registry& registry = GetRegistry();
+			std::lock_guard<std::mutex> guard(registry.lock);
+
+			// Timestamps relative to the oldest zone still buffered, so they stay short
+			uint64_t origin = UINT64_MAX;
+			for (Buffer* buffer : registry.buffers)
+			{
+				uint64_t head = buffer->head.load(std::memory_order_acquire);
+				uint64_t first = head > EVENTS_PER_THREAD ? head - EVENTS_PER_THREAD : 0;
+				for (uint64_t i = first; i < head; i++)
+					if (buffer->events[i % EVENTS_PER_THREAD].begin < origin)
+						origin = buffer->events[i % EVENTS_PER_THREAD].begin;
+			}
+
+			int64_t written = 0;
+			append("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+			bool first = true;
+			for (Buffer* buffer : registry.buffers)
+			{
+				if (buffer->threadName)
+				{
+					append("%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%lu,\"tid\":%lu,\"args\":{\"name\":\"%s\"}}",
+						first ? "" : ",\n", (unsigned long)pid, (unsigned long)buffer->threadId, buffer->threadName);
+					first = false;
+				}
+
+				uint64_t head = buffer->head.load(std::memory_order_acquire);
+				for (uint64_t i = head > EVENTS_PER_THREAD ? head - EVENTS_PER_THREAD : 0; i < head; i++)
+				{
+					const Event& e = buffer->events[i % EVENTS_PER_THREAD];
+					append("%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":%lu,\"tid\":%lu,\"ts\":%.3f,\"dur\":%.3f}", first ? "" : ",\n",
+						e.name, (unsigned long)pid, (unsigned long)buffer->threadId, (e.begin - origin) * usPerQpc, (e.end - e.begin) * usPerQpc);
+					first = false;
+					written++;
+				}
+			}
+			append("\n]}\n");
+			flush();
+			CloseHandle(file);
+			return ok ? written : -1;
+#else
+			(void)path;
+			return 0;
+#endif
+		}
+	}
+
+}
+
+#if PROFILE_ZONES
+#define PROFILE_ZONE_CONCAT_(a, b) a##b
+#define PROFILE_ZONE_CONCAT(a, b) PROFILE_ZONE_CONCAT_(a, b)
+#define PROFILE_ZONE(name) ZoneProfiler::Zone PROFILE_ZONE_CONCAT(profileZone, __LINE__)(name)
+#else
+#define PROFILE_ZONE(name) ((void)0)
+#endif